@@ -0,0 +1,52 @@
+//***************************************************************************************
+// AllocationCounter.cpp
+//***************************************************************************************
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<long long> gAllocations(0);
+}
+
+long long bench::AllocationCount()
+{
+	return gAllocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	gAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
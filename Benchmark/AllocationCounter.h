@@ -0,0 +1,15 @@
+//***************************************************************************************
+// AllocationCounter.h
+//
+// Linking AllocationCounter.cpp into a program replaces the global operator
+// new and delete with versions that count every allocation.  Kept in its
+// own translation unit so the replacements are never inlined into callers.
+//***************************************************************************************
+
+#pragma once
+
+namespace bench
+{
+	// Heap allocations made through operator new so far, on any thread.
+	long long AllocationCount();
+}
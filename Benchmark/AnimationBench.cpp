@@ -0,0 +1,236 @@
+//***************************************************************************************
+// AnimationBench.cpp
+//
+// Playback of baked skeletal animation at a display rate above the bake
+// rate.  A synthetic clip, known in closed form, is baked at each rate the
+// way Graphics::Fetch_bone_animations bakes FBX clips, then played back
+// three ways:
+//
+//   snap        the baked frame at or before t, as UpdateSkinnedCBs did
+//   baked       BakedClip::Sample, blending the two frames around t
+//   compressed  CompressedClip::Sample
+//
+// For each it reports sampling cost per bone and the worst distance a point
+// 10 cm from a bone lands from the exact pose, in centimetres.  Stepping
+// shows as snap's error growing with the frame interval; interpolation
+// should let the bake rate drop several-fold for the same error.
+//
+//   animation_bench [--bones <n>] [--rates <hz,...>] [--playback <hz>]
+//                   [--seconds <s>]
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../DirectX12/BakedAnimation.h"
+#include "../DirectX12/AnimationCompression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bench;
+using namespace DirectX;
+
+namespace
+{
+	const float kVertexDistance = 10.0f;
+
+	struct Options
+	{
+		int bones = 64;
+		std::vector<int> rates = { 60, 30, 15, 10 };
+		int playback = 144;
+		float seconds = 10.0f;
+	};
+
+	// Each bone swings about its own axis and bobs, at 0.3 to 2 Hz, like
+	// the joints of a dance clip in centimetres.
+	struct Motion
+	{
+		std::vector<float> frequency, phase, amplitude, height;
+
+		explicit Motion(int bones)
+		{
+			unsigned state = 7;
+			for (int b = 0; b < bones; ++b)
+			{
+				frequency.push_back(RandF(state, 0.3f, 2.0f));
+				phase.push_back(RandF(state, 0.0f, 6.28f));
+				amplitude.push_back(RandF(state, 0.2f, 1.2f));
+				height.push_back(RandF(state, 0.0f, 170.0f));
+			}
+		}
+
+		void Pose(float t, XMFLOAT4X4* pose)const
+		{
+			for (size_t b = 0; b < frequency.size(); ++b)
+			{
+				float w = 6.2831853f * frequency[b] * t + phase[b];
+				float a = amplitude[b] * std::sin(w);
+				XMVECTOR q = XMQuaternionRotationRollPitchYaw(a, 0.7f * a + b, 0.3f * a);
+				XMVECTOR p = XMVectorSet(5.0f * std::cos(w), height[b] + 10.0f * std::sin(w), 0.0f, 0.0f);
+				XMStoreFloat4x4(&pose[b], XMMatrixAffineTransformation(XMVectorSplatOne(),
+					XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), q, p));
+			}
+		}
+	};
+
+	// How far a bone's origin and points kVertexDistance along its axes
+	// land from where the exact matrix puts them.
+	float PoseError(const XMFLOAT4X4* pose, const XMFLOAT4X4* exact, int bones)
+	{
+		float error = 0.0f;
+		for (int b = 0; b < bones; ++b)
+		{
+			XMMATRIX m = XMLoadFloat4x4(&pose[b]);
+			XMMATRIX e = XMLoadFloat4x4(&exact[b]);
+			XMVECTOR origin = XMVectorSubtract(m.r[3], e.r[3]);
+			error = std::max(error, XMVectorGetX(XMVector3Length(origin)));
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				XMVECTOR d = XMVectorMultiplyAdd(XMVectorSubtract(m.r[axis], e.r[axis]),
+					XMVectorReplicate(kVertexDistance), origin);
+				error = std::max(error, XMVectorGetX(XMVector3Length(d)));
+			}
+		}
+		return error;
+	}
+
+	struct Playback
+	{
+		double nsPerBone;
+		float maxError;
+	};
+
+	// Plays 'duration' seconds back at opt.playback Hz through 'sample',
+	// which writes a pose for time t; times it over several passes and
+	// checks every pose against the exact one.
+	template<typename SampleFn>
+	Playback Play(const Options& opt, const Motion& motion, float duration, SampleFn sample)
+	{
+		const int Passes = 20;
+
+		int samples = (int)(duration * opt.playback) + 1;
+		std::vector<XMFLOAT4X4> pose(opt.bones), exact(opt.bones);
+
+		Playback r;
+		r.maxError = 0.0f;
+		for (int i = 0; i < samples; ++i)
+		{
+			float t = (float)i / opt.playback;
+			sample(t, pose.data());
+			motion.Pose(t, exact.data());
+			r.maxError = std::max(r.maxError, PoseError(pose.data(), exact.data(), opt.bones));
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < Passes; ++pass)
+		{
+			for (int i = 0; i < samples; ++i)
+			{
+				sample((float)i / opt.playback, pose.data());
+				DoNotOptimize(pose[0]);
+			}
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		r.nsPerBone = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+			((double)Passes * samples * opt.bones);
+		return r;
+	}
+
+	std::vector<int> ParseList(const char* s)
+	{
+		std::vector<int> v;
+		std::stringstream ss(s);
+		std::string item;
+		while (std::getline(ss, item, ','))
+		{
+			int x = atoi(item.c_str());
+			if (x > 0)
+				v.push_back(x);
+		}
+		return v;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			bool hasValue = i + 1 < argc;
+			bool ok = true;
+			if (!strcmp(a, "--bones") && hasValue)
+				ok = (opt.bones = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--rates") && hasValue)
+				ok = !(opt.rates = ParseList(argv[++i])).empty();
+			else if (!strcmp(a, "--playback") && hasValue)
+				ok = (opt.playback = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--seconds") && hasValue)
+				ok = (opt.seconds = (float)atof(argv[++i])) > 0.0f;
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				fprintf(stderr, "usage: %s [--bones <n>] [--rates <hz,...>] [--playback <hz>] [--seconds <s>]\n",
+					argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+		return 2;
+
+	Motion motion(opt.bones);
+
+	printf("%d bones, %.1f s played back at %d Hz; cost in ns/bone, error in cm at %.0f cm\n",
+		opt.bones, opt.seconds, opt.playback, kVertexDistance);
+	printf("%5s %9s %9s %9s | %7s %7s %7s | %8s %8s %8s\n", "Hz", "raw KB", "trs KB", "comp KB",
+		"snap", "baked", "comp", "snap", "baked", "comp");
+
+	for (int rate : opt.rates)
+	{
+		// Bake as Fetch_bone_animations does: frames from 0 while before the end.
+		float sampleTime = 1.0f / rate;
+		int frameCount = 0;
+		while (frameCount * sampleTime < opt.seconds)
+			++frameCount;
+		std::vector<XMFLOAT4X4> frames((size_t)frameCount * opt.bones);
+		for (int f = 0; f < frameCount; ++f)
+			motion.Pose(f * sampleTime, &frames[(size_t)f * opt.bones]);
+
+		BakedClip baked(frames.data(), frameCount, opt.bones, sampleTime);
+		CompressedClip::Settings settings;
+		settings.Tolerance = 0.01f;
+		settings.VertexDistance = kVertexDistance;
+		CompressedClip compressed(frames.data(), frameCount, opt.bones, sampleTime, settings);
+
+		// Up to the last frame; past it every sampler holds the last pose.
+		float duration = (frameCount - 1) * sampleTime;
+		Playback snap = Play(opt, motion, duration, [&](float t, XMFLOAT4X4* pose)
+		{
+			int frame = std::min((int)(t / sampleTime), frameCount - 1);
+			std::copy_n(&frames[(size_t)frame * opt.bones], opt.bones, pose);
+		});
+		Playback lerp = Play(opt, motion, duration, [&](float t, XMFLOAT4X4* pose) { baked.Sample(t, pose); });
+		Playback comp = Play(opt, motion, duration, [&](float t, XMFLOAT4X4* pose) { compressed.Sample(t, pose); });
+
+		printf("%5d %9.1f %9.1f %9.1f | %7.2f %7.2f %7.2f | %8.4f %8.4f %8.4f\n", rate,
+			frames.size() * sizeof(XMFLOAT4X4) / 1024.0, baked.Bytes() / 1024.0,
+			compressed.Stats().CompressedBytes / 1024.0,
+			snap.nsPerBone, lerp.nsPerBone, comp.nsPerBone,
+			snap.maxError, lerp.maxError, comp.maxError);
+	}
+	return 0;
+}
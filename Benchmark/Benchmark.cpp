@@ -0,0 +1,184 @@
+//***************************************************************************************
+// Benchmark.cpp
+//
+// Runner and entry point.
+//
+//   math_bench [--filter <substring>] [--min-time <ms>] [--repetitions <n>]
+//              [--json <file>] [--list]
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Math/Simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace bench;
+
+namespace
+{
+	struct Options
+	{
+		std::string filter;
+		std::string jsonPath;
+		double minTimeMs = 100.0;
+		int repetitions = 5;
+		bool list = false;
+	};
+
+	double TimeCalls(const Body& body, size_t calls)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		body(calls);
+		auto t1 = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(t1 - t0).count();
+	}
+
+	Result Run(const Case& c, const Options& opt)
+	{
+		// Grow the call count until one repetition takes at least a tenth of
+		// the minimum time, then scale it up to the full minimum time.
+		const double target = opt.minTimeMs * 1e6;
+		size_t calls = 1;
+		double ns = TimeCalls(c.body, calls);
+		while (ns < target * 0.1 && calls < (size_t(1) << 40))
+		{
+			calls *= 2;
+			ns = TimeCalls(c.body, calls);
+		}
+		calls = std::max<size_t>(1, (size_t)(calls * (target / std::max(ns, 1.0))));
+
+		std::vector<double> perOp;
+		for (int i = 0; i < opt.repetitions; ++i)
+		{
+			double t = TimeCalls(c.body, calls);
+			perOp.push_back(t / ((double)calls * c.itemsPerCall));
+		}
+		std::sort(perOp.begin(), perOp.end());
+
+		Result r;
+		r.name = c.name;
+		r.itemsPerCall = c.itemsPerCall;
+		r.calls = calls;
+		r.nsPerOp = perOp[perOp.size() / 2];
+		r.nsPerOpMin = perOp.front();
+		r.opsPerSec = r.nsPerOp > 0.0 ? 1e9 / r.nsPerOp : 0.0;
+		return r;
+	}
+
+	const char* CompilerName()
+	{
+#if defined(__clang__)
+		return "clang " __clang_version__;
+#elif defined(__GNUC__)
+		return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+		return "msvc";
+#else
+		return "unknown";
+#endif
+	}
+
+	bool WriteJson(const std::string& path, const std::vector<Result>& results, const Options& opt)
+	{
+		FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+		if (!f)
+			return false;
+
+		fprintf(f, "{\n");
+		fprintf(f, "  \"backend\": \"%s\",\n", MATH_SIMD_BACKEND_NAME);
+		fprintf(f, "  \"compiler\": \"%s\",\n", CompilerName());
+		fprintf(f, "  \"min_time_ms\": %g,\n", opt.minTimeMs);
+		fprintf(f, "  \"repetitions\": %d,\n", opt.repetitions);
+		fprintf(f, "  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			fprintf(f, "    {\"name\": \"%s\", \"items_per_call\": %d, \"calls\": %zu, "
+				"\"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, \"ops_per_sec\": %.1f}%s\n",
+				r.name.c_str(), r.itemsPerCall, r.calls,
+				r.nsPerOp, r.nsPerOpMin, r.opsPerSec, i + 1 < results.size() ? "," : "");
+		}
+		fprintf(f, "  ]\n}\n");
+
+		if (f != stdout)
+			fclose(f);
+		return true;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (!strcmp(a, "--filter") && hasValue)
+				opt.filter = argv[++i];
+			else if (!strcmp(a, "--json") && hasValue)
+				opt.jsonPath = argv[++i];
+			else if (!strcmp(a, "--min-time") && hasValue)
+				opt.minTimeMs = atof(argv[++i]);
+			else if (!strcmp(a, "--repetitions") && hasValue)
+				opt.repetitions = std::max(1, atoi(argv[++i]));
+			else if (!strcmp(a, "--list"))
+				opt.list = true;
+			else
+			{
+				fprintf(stderr, "usage: %s [--filter <substring>] [--min-time <ms>] "
+					"[--repetitions <n>] [--json <file|->] [--list]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+		return 2;
+
+	Registry registry;
+	RegisterMatrix(registry);
+	RegisterVector3(registry);
+	RegisterQuaternion(registry);
+	RegisterJobSystem(registry);
+#if defined(BENCH_HAS_DIRECTXMATH)
+	RegisterMathHelper(registry);
+	RegisterSampling(registry);
+	RegisterWaves(registry);
+#endif
+
+	// Human-readable output goes to stderr when JSON is written to stdout.
+	FILE* log = opt.jsonPath == "-" ? stderr : stdout;
+
+	std::vector<Result> results;
+	fprintf(log, "backend: %s\n", MATH_SIMD_BACKEND_NAME);
+	fprintf(log, "%-40s %12s %12s %16s\n", "benchmark", "ns/op", "min ns/op", "ops/s");
+	for (const Case& c : registry.Cases())
+	{
+		if (!opt.filter.empty() && c.name.find(opt.filter) == std::string::npos)
+			continue;
+		if (opt.list)
+		{
+			fprintf(log, "%s\n", c.name.c_str());
+			continue;
+		}
+
+		Result r = Run(c, opt);
+		fprintf(log, "%-40s %12.3f %12.3f %16.0f\n", r.name.c_str(), r.nsPerOp, r.nsPerOpMin, r.opsPerSec);
+		fflush(log);
+		results.push_back(r);
+	}
+
+	if (!opt.jsonPath.empty() && !opt.list && !WriteJson(opt.jsonPath, results, opt))
+	{
+		fprintf(stderr, "cannot write %s\n", opt.jsonPath.c_str());
+		return 1;
+	}
+	return 0;
+}
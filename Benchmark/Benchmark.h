@@ -0,0 +1,94 @@
+//***************************************************************************************
+// Benchmark.h
+//
+// Minimal microbenchmark harness: cases register a callable that performs a
+// number of calls, the runner calibrates the call count to a minimum time and
+// reports ns/op and throughput, optionally as JSON.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+namespace bench
+{
+	// Runs 'calls' iterations of the operation under test.
+	typedef std::function<void(size_t calls)> Body;
+
+	struct Case
+	{
+		std::string name;
+		int itemsPerCall;	// e.g. 1024 for a batch call over 1024 elements
+		Body body;
+	};
+
+	struct Result
+	{
+		std::string name;
+		int itemsPerCall;
+		size_t calls;			// calls per repetition after calibration
+		double nsPerOp;			// median over repetitions, per item
+		double nsPerOpMin;
+		double opsPerSec;		// items per second at the median
+	};
+
+	class Registry
+	{
+	public:
+		void Add(const std::string& name, int itemsPerCall, Body body)
+		{
+			Case c = { name, itemsPerCall, body };
+			mCases.push_back(c);
+		}
+
+		const std::vector<Case>& Cases() const { return mCases; }
+
+	private:
+		std::vector<Case> mCases;
+	};
+
+	// Keeps the compiler from discarding a value that is otherwise unused.
+	template<class T>
+	inline void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile char sink;
+		sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+	}
+
+	// Deterministic pseudo-random float in [lo, hi) for building inputs.
+	inline float RandF(unsigned& state, float lo, float hi)
+	{
+		state = state * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((state >> 8) * (1.0f / 16777216.0f));
+	}
+
+	// Element count for batch cases; small enough to stay cache resident.
+	const int kBatch = 1024;
+
+	// Job system with 'threads' threads in total (the caller included),
+	// shared by all cases; see JobSystemBench.cpp.
+	JobSystem& Pool(int threads);
+
+	// Thread counts for scaling cases: 1, 2, 4, ... and the hardware count.
+	std::vector<int> ThreadCounts();
+
+	// Per-area registration, one per source file.
+	void RegisterMatrix(Registry& r);
+	void RegisterVector3(Registry& r);
+	void RegisterQuaternion(Registry& r);
+	void RegisterJobSystem(Registry& r);
+#if defined(BENCH_HAS_DIRECTXMATH)
+	void RegisterMathHelper(Registry& r);
+	void RegisterSampling(Registry& r);
+	void RegisterWaves(Registry& r);
+#endif
+}
@@ -0,0 +1,381 @@
+//***************************************************************************************
+// BlendBench.cpp
+//
+// Layered animation blending for a crowd.  Every character runs a stack of
+// AnimationPlayer layers: two clips crossfading, which restart as soon as
+// one has faded in, then alternately an upper-body masked override and an
+// additive layer.  Each frame advances and evaluates every character two
+// ways:
+//
+//   blend     AnimationPlayer::Evaluate: all layers in one pass, four bones
+//             at a time, from BakedClip or CompressedClip
+//   matrices  each layer sampled to a pose of matrices, which are then
+//             decomposed, blended bone by bone and rebuilt
+//
+// It reports ms per frame for the crowd and ns per bone per layer, and the
+// largest difference between the two ways' matrices.
+//
+//   blend_bench [--characters <n>] [--layers <n>] [--bones <n>]
+//               [--frames <n>] [--threads <n>]
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Common/JobSystem.h"
+#include "../DirectX12/AnimationBlend.h"
+#include "../DirectX12/AnimationCompression.h"
+#include "../DirectX12/BakedAnimation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace bench;
+using namespace DirectX;
+
+namespace
+{
+	const int ClipCount = 8;
+	const float ClipRate = 30.0f;
+	const float ClipSeconds = 4.0f;
+	const float FrameTime = 1.0f / 60.0f;
+	const float FadeTime = 0.5f;
+
+	struct Options
+	{
+		int characters = 500;
+		int layers = 8;
+		int bones = 64;
+		int frames = 300;
+		int threads = 1;
+	};
+
+	// A clip of bones swinging about their own axes and bobbing, differently
+	// per seed.
+	std::vector<XMFLOAT4X4> MakeFrames(int bones, int frameCount, unsigned seed)
+	{
+		std::vector<XMFLOAT4X4> frames((size_t)frameCount * bones);
+		unsigned state = seed;
+		for (int b = 0; b < bones; ++b)
+		{
+			float frequency = RandF(state, 0.5f, 2.0f);
+			float phase = RandF(state, 0.0f, 6.28f);
+			float amplitude = RandF(state, 0.2f, 1.2f);
+			float height = RandF(state, 0.0f, 170.0f);
+			for (int f = 0; f < frameCount; ++f)
+			{
+				float w = 6.2831853f * frequency * f / ClipRate + phase;
+				float a = amplitude * std::sin(w);
+				XMVECTOR q = XMQuaternionRotationRollPitchYaw(a, 0.7f * a + b, 0.3f * a);
+				XMVECTOR s = XMVectorReplicate(1.0f + 0.05f * std::cos(w));
+				XMVECTOR p = XMVectorSet(5.0f * std::cos(w), height + 10.0f * std::sin(w), 0.0f, 0.0f);
+				XMStoreFloat4x4(&frames[(size_t)f * bones + b],
+					XMMatrixAffineTransformation(s, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), q, p));
+			}
+		}
+		return frames;
+	}
+
+	struct Clips
+	{
+		std::vector<BakedClip> Baked;
+		std::vector<CompressedClip> Compressed;
+		BoneMask UpperBody;
+
+		explicit Clips(int bones)
+			: UpperBody(bones)
+		{
+			int frameCount = (int)(ClipSeconds * ClipRate) + 1;
+			CompressedClip::Settings settings;
+			settings.Tolerance = 0.01f;
+			settings.VertexDistance = 10.0f;
+			for (int c = 0; c < ClipCount; ++c)
+			{
+				std::vector<XMFLOAT4X4> frames = MakeFrames(bones, frameCount, 11u + 97u * c);
+				Baked.emplace_back(frames.data(), frameCount, bones, 1.0f / ClipRate);
+				Compressed.emplace_back(frames.data(), frameCount, bones, 1.0f / ClipRate, settings);
+			}
+			for (int b = bones / 2; b < bones; ++b)
+				UpperBody.Set(b, 1.0f);
+		}
+	};
+
+	// One character's player and the clip it crossfades to next.
+	struct Character
+	{
+		AnimationPlayer Player;
+		int Next = 0;
+	};
+
+	void SetClip(AnimationLayer& layer, const BakedClip& clip) { layer.Baked = &clip; }
+	void SetClip(AnimationLayer& layer, const CompressedClip& clip) { layer.Compressed = &clip; }
+
+	template<typename Clip>
+	std::vector<Character> MakeCrowd(const Options& opt, const Clips& clips, const std::vector<Clip>& source)
+	{
+		std::vector<Character> crowd(opt.characters);
+		for (int i = 0; i < opt.characters; ++i)
+		{
+			Character& c = crowd[i];
+			c.Player.Play(source[i % ClipCount], 0.0f);
+			c.Next = (i + 1) % ClipCount;
+			for (int l = 2; l < opt.layers; ++l)
+			{
+				AnimationLayer layer;
+				SetClip(layer, source[(i + l) % ClipCount]);
+				layer.Time = 0.37f * l;
+				if (l % 2 == 0)
+				{
+					layer.Weight = 0.8f;
+					layer.Mask = &clips.UpperBody;
+				}
+				else
+				{
+					layer.Weight = 0.5f;
+					layer.Blend = AnimationLayer::Mode::Additive;
+				}
+				c.Player.AddOverlay(layer);
+			}
+			// Stagger the characters.
+			c.Player.Advance(0.01f * i);
+		}
+		return crowd;
+	}
+
+	// Keeps a crossfade running on every character, then advances it a frame.
+	template<typename Clip>
+	void Step(const Options& opt, Character& c, const std::vector<Clip>& source)
+	{
+		if (opt.layers >= 2 && c.Player.LayerCount() < opt.layers)
+		{
+			c.Player.Play(source[c.Next], FadeTime);
+			c.Next = (c.Next + 1) % ClipCount;
+		}
+		c.Player.Advance(FrameTime);
+	}
+
+	void SamplePose(const AnimationLayer& layer, float t, XMFLOAT4X4* pose)
+	{
+		if (layer.Baked)
+			layer.Baked->Sample(t, pose);
+		else
+			layer.Compressed->Sample(t, pose);
+	}
+
+	struct Trs
+	{
+		XMVECTOR T, Q, S;
+	};
+
+	// The same blend as BlendLayers, from a pose of matrices per layer.
+	struct MatrixBlender
+	{
+		std::vector<XMFLOAT4X4> Sample, Reference;
+		std::vector<Trs> Blended;
+
+		explicit MatrixBlender(int bones)
+			: Sample(bones), Reference(bones), Blended(bones) {}
+
+		void Blend(const AnimationLayer* layers, int count, int bones, XMFLOAT4X4* pose)
+		{
+			for (int b = 0; b < bones; ++b)
+				Blended[b] = { g_XMZero, XMQuaternionIdentity(), g_XMOne };
+
+			for (int i = 0; i < count; ++i)
+			{
+				const AnimationLayer& layer = layers[i];
+				if (layer.Weight <= 0.0f)
+					continue;
+				bool additive = layer.Blend == AnimationLayer::Mode::Additive;
+				SamplePose(layer, layer.Time, Sample.data());
+				if (additive)
+					SamplePose(layer, layer.ReferenceTime, Reference.data());
+
+				for (int b = 0; b < bones; ++b)
+				{
+					float w = std::min(layer.Weight, 1.0f) * (layer.Mask ? layer.Mask->Weight(b) : 1.0f);
+					XMVECTOR weight = XMVectorReplicate(w);
+					Trs& r = Blended[b];
+
+					XMVECTOR s, q, t;
+					XMMatrixDecompose(&s, &q, &t, XMLoadFloat4x4(&Sample[b]));
+					if (!additive)
+					{
+						if (XMVectorGetX(XMQuaternionDot(r.Q, q)) < 0.0f)
+							q = XMVectorNegate(q);
+						r.T = XMVectorLerpV(r.T, t, weight);
+						r.Q = XMQuaternionNormalize(XMVectorLerpV(r.Q, q, weight));
+						r.S = XMVectorLerpV(r.S, s, weight);
+						continue;
+					}
+
+					XMVECTOR rs, rq, rt;
+					XMMatrixDecompose(&rs, &rq, &rt, XMLoadFloat4x4(&Reference[b]));
+					r.T = XMVectorMultiplyAdd(XMVectorSubtract(t, rt), weight, r.T);
+					r.S = XMVectorMultiply(r.S, XMVectorLerpV(g_XMOne, XMVectorDivide(s, rs), weight));
+					XMVECTOR delta = XMQuaternionMultiply(XMQuaternionConjugate(rq), q);
+					if (XMVectorGetW(delta) < 0.0f)
+						delta = XMVectorNegate(delta);
+					delta = XMVectorLerpV(XMQuaternionIdentity(), delta, weight);
+					r.Q = XMQuaternionNormalize(XMQuaternionMultiply(r.Q, delta));
+				}
+			}
+
+			for (int b = 0; b < bones; ++b)
+			{
+				const Trs& r = Blended[b];
+				XMStoreFloat4x4(&pose[b], XMMatrixAffineTransformation(r.S,
+					XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), r.Q, r.T));
+			}
+		}
+	};
+
+	float MaxDifference(const XMFLOAT4X4* a, const XMFLOAT4X4* b, int count)
+	{
+		float d = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+					d = std::max(d, std::fabs(a[i].m[r][c] - b[i].m[r][c]));
+			}
+		}
+		return d;
+	}
+
+	// Runs opt.frames frames of the crowd through 'evaluate', which writes
+	// the pose of character i with the scratch of worker 'slot'; returns
+	// ms per frame.
+	template<typename Clip, typename EvaluateFn>
+	double Run(const Options& opt, const Clips& clips, const std::vector<Clip>& source,
+		JobSystem* jobs, EvaluateFn evaluate)
+	{
+		std::vector<Character> crowd = MakeCrowd(opt, clips, source);
+		std::vector<XMFLOAT4X4> poses((size_t)opt.characters * opt.bones);
+
+		auto frame = [&]
+		{
+			auto body = [&](int i)
+			{
+				Step(opt, crowd[i], source);
+				int slot = jobs ? jobs->WorkerIndex() + 1 : 0;
+				evaluate(crowd[i].Player, slot, &poses[(size_t)i * opt.bones]);
+			};
+			if (jobs)
+				jobs->ParallelFor(0, opt.characters, body);
+			else
+			{
+				for (int i = 0; i < opt.characters; ++i)
+					body(i);
+			}
+			DoNotOptimize(poses[0]);
+		};
+
+		// Warm up, then time.
+		for (int f = 0; f < 10; ++f)
+			frame();
+		auto t0 = std::chrono::steady_clock::now();
+		for (int f = 0; f < opt.frames; ++f)
+			frame();
+		auto t1 = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(t1 - t0).count() / opt.frames;
+	}
+
+	// Steps one crowd and evaluates it both ways every frame.
+	float Compare(const Options& opt, const Clips& clips)
+	{
+		Options small = opt;
+		small.characters = std::min(opt.characters, 50);
+		std::vector<Character> crowd = MakeCrowd(small, clips, clips.Baked);
+		MatrixBlender blender(opt.bones);
+		std::vector<XMFLOAT4X4> a(opt.bones), b(opt.bones);
+
+		float d = 0.0f;
+		for (int f = 0; f < 120; ++f)
+		{
+			for (Character& c : crowd)
+			{
+				Step(small, c, clips.Baked);
+				c.Player.Evaluate(a.data());
+				blender.Blend(c.Player.Layers(), c.Player.LayerCount(), opt.bones, b.data());
+				d = std::max(d, MaxDifference(a.data(), b.data(), opt.bones));
+			}
+		}
+		return d;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			bool hasValue = i + 1 < argc;
+			bool ok = true;
+			if (!strcmp(a, "--characters") && hasValue)
+				ok = (opt.characters = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--layers") && hasValue)
+				ok = (opt.layers = atoi(argv[++i])) > 0 && opt.layers <= MaxBlendLayers;
+			else if (!strcmp(a, "--bones") && hasValue)
+				ok = (opt.bones = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--frames") && hasValue)
+				ok = (opt.frames = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--threads") && hasValue)
+				ok = (opt.threads = atoi(argv[++i])) > 0;
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				fprintf(stderr, "usage: %s [--characters <n>] [--layers <1-%d>] [--bones <n>] "
+					"[--frames <n>] [--threads <n>]\n", argv[0], MaxBlendLayers);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+		return 2;
+
+	Clips clips(opt.bones);
+
+	std::unique_ptr<JobSystem> jobs;
+	int slots = 1;
+	if (opt.threads > 1)
+	{
+		jobs.reset(new JobSystem(opt.threads - 1));	// the caller is the last thread
+		slots = jobs->Concurrency() + 1;
+	}
+	std::vector<MatrixBlender> blenders(slots, MatrixBlender(opt.bones));
+
+	printf("%d characters x %d layers x %d bones, %d thread(s), %d frames\n",
+		opt.characters, opt.layers, opt.bones, opt.threads, opt.frames);
+
+	double boneLayers = (double)opt.characters * opt.layers * opt.bones;
+	auto report = [&](const char* name, double ms)
+	{
+		printf("%-20s %8.3f ms/frame %8.2f ns/bone-layer\n", name, ms, ms * 1e6 / boneLayers);
+	};
+
+	report("blend", Run(opt, clips, clips.Baked, jobs.get(),
+		[](const AnimationPlayer& p, int, XMFLOAT4X4* pose) { p.Evaluate(pose); }));
+	report("blend compressed", Run(opt, clips, clips.Compressed, jobs.get(),
+		[](const AnimationPlayer& p, int, XMFLOAT4X4* pose) { p.Evaluate(pose); }));
+	report("matrices", Run(opt, clips, clips.Baked, jobs.get(),
+		[&](const AnimationPlayer& p, int slot, XMFLOAT4X4* pose)
+		{
+			blenders[slot].Blend(p.Layers(), p.LayerCount(), opt.bones, pose);
+		}));
+
+	printf("largest difference, blend vs matrices: %g\n", Compare(opt, clips));
+	return 0;
+}
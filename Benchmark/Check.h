@@ -0,0 +1,72 @@
+//***************************************************************************************
+// Check.h
+//
+// Minimal support for the correctness checks CTest runs (the *_check
+// targets in CMakeLists.txt).  Each expectation prints what was measured
+// against its limit; a check's main returns Result(), which is non-zero if
+// any expectation failed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace check
+{
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline bool Expect(const char* what, bool ok)
+	{
+		printf("%-4s %s\n", ok ? "ok" : "FAIL", what);
+		if (!ok)
+			++Failures();
+		return ok;
+	}
+
+	// value <= limit, printing both.
+	inline bool ExpectAtMost(const char* what, double value, double limit)
+	{
+		bool ok = value <= limit;
+		printf("%-4s %-52s %12.6g (limit %g)\n", ok ? "ok" : "FAIL", what, value, limit);
+		if (!ok)
+			++Failures();
+		return ok;
+	}
+
+	// value >= limit, printing both.
+	inline bool ExpectAtLeast(const char* what, double value, double limit)
+	{
+		bool ok = value >= limit;
+		printf("%-4s %-52s %12.6g (limit %g)\n", ok ? "ok" : "FAIL", what, value, limit);
+		if (!ok)
+			++Failures();
+		return ok;
+	}
+
+	inline int Result()
+	{
+		if (Failures() > 0)
+			printf("%d expectation(s) failed\n", Failures());
+		return Failures() > 0 ? 1 : 0;
+	}
+
+	// Floats between a and b, counting +0 and -0 as one.
+	inline uint32_t UlpDistance(float a, float b)
+	{
+		int32_t ia, ib;
+		memcpy(&ia, &a, sizeof(float));
+		memcpy(&ib, &b, sizeof(float));
+		if (ia < 0)
+			ia = INT32_MIN - ia;
+		if (ib < 0)
+			ib = INT32_MIN - ib;
+		return ia > ib ? (uint32_t)((int64_t)ia - ib) : (uint32_t)((int64_t)ib - ia);
+	}
+}
@@ -0,0 +1,46 @@
+# Compiles SOURCE to assembly and requires each of FUNCTIONS (comma-separated,
+# unmangled names) to be a single fused loop or straight-line code: no
+# calls (tail calls included) and no stack temporaries.  Branches to the
+# function's own local labels are allowed.  x86-64 ELF output from GCC or
+# Clang.
+#
+#   cmake -DCXX=<compiler> -DSOURCE=<file.cpp> -DOUTPUT=<file.s>
+#         -DFUNCTIONS=<a,b> -P CheckCodegen.cmake
+execute_process(
+  COMMAND ${CXX} -std=c++14 -O2 -S -fno-asynchronous-unwind-tables -o ${OUTPUT} ${SOURCE}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "cannot compile ${SOURCE}")
+endif()
+
+string(REPLACE "," ";" FUNCTIONS "${FUNCTIONS}")
+file(READ ${OUTPUT} assembly)
+set(failed FALSE)
+foreach(function ${FUNCTIONS})
+  string(FIND "${assembly}" "\n${function}:" begin)
+  string(FIND "${assembly}" ".size\t${function}," end)
+  if(begin EQUAL -1 OR end EQUAL -1)
+    message(SEND_ERROR "${function} not found in ${OUTPUT}")
+    set(failed TRUE)
+    continue()
+  endif()
+  math(EXPR length "${end} - ${begin}")
+  string(SUBSTRING "${assembly}" ${begin} ${length} body)
+
+  string(REGEX MATCHALL "\n\t[a-z][a-z0-9]*" instructions "${body}")
+  list(LENGTH instructions count)
+  string(REGEX MATCHALL "\n\t(call|j[a-z]+)[ \t]+[^.\n][^\n]*" calls "${body}")
+  string(REGEX MATCHALL "[^\n]*%[re]sp\\)[^\n]*" stack "${body}")
+  string(REGEX MATCHALL "\n\tj[a-z]+[ \t]+\\.L" loops "${body}")
+  list(LENGTH loops branches)
+  if(calls OR stack)
+    message(SEND_ERROR "${function}: calls or stack temporaries:${calls}${stack}")
+    set(failed TRUE)
+  else()
+    message(STATUS "${function}: ${count} instructions, ${branches} local branch(es), no calls or stack temporaries")
+  endif()
+endforeach()
+
+if(failed)
+  message(FATAL_ERROR "generated code check failed")
+endif()
@@ -0,0 +1,100 @@
+//***************************************************************************************
+// JobSystemBench.cpp
+//
+// Common/JobSystem: scheduling overhead and scaling from one thread to all
+// hardware threads.  Scaling cases report the cost per item, so ops/s
+// should grow with the thread count until memory bandwidth runs out.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Common/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace bench;
+
+namespace
+{
+	std::mutex gPoolLock;
+	std::map<int, std::unique_ptr<JobSystem>> gPools;
+}
+
+JobSystem& bench::Pool(int threads)
+{
+	std::lock_guard<std::mutex> lock(gPoolLock);
+	std::unique_ptr<JobSystem>& pool = gPools[threads];
+	if (!pool)
+		pool.reset(new JobSystem(threads - 1));	// the caller is the last thread
+	return *pool;
+}
+
+std::vector<int> bench::ThreadCounts()
+{
+	int n = std::max((int)std::thread::hardware_concurrency(), 1);
+	std::vector<int> counts;
+	for (int t = 1; t < n; t *= 2)
+		counts.push_back(t);
+	counts.push_back(n);
+	return counts;
+}
+
+void bench::RegisterJobSystem(Registry& r)
+{
+	const int kItems = 1 << 20;
+	auto data = std::make_shared<std::vector<float>>(kItems, 1.5f);
+
+	for (int t : ThreadCounts())
+	{
+		std::string suffix = "_t" + std::to_string(t);
+
+		// Compute-bound: a few dozen flops per item.
+		r.Add("JobSystem/ParallelFor_compute" + suffix, kItems, [data, t](size_t calls)
+		{
+			JobSystem& jobs = Pool(t);
+			float* v = data->data();
+			for (size_t c = 0; c < calls; ++c)
+			{
+				jobs.ParallelForRange(0, kItems, [v](int first, int last)
+				{
+					for (int i = first; i < last; ++i)
+					{
+						float x = v[i];
+						for (int k = 0; k < 8; ++k)
+							x = sqrtf(x * x + 0.25f);
+						v[i] = x * 0.5f + 0.75f;
+					}
+				});
+				DoNotOptimize(v[0]);
+			}
+		});
+
+		// Scheduling overhead: one trivial item per task.
+		r.Add("JobSystem/ParallelFor_grain1" + suffix, 4096, [t](size_t calls)
+		{
+			JobSystem& jobs = Pool(t);
+			std::atomic<int> sum(0);
+			for (size_t c = 0; c < calls; ++c)
+				jobs.ParallelFor(0, 4096, [&sum](int i) { sum.fetch_add(i, std::memory_order_relaxed); }, 1);
+			DoNotOptimize(sum);
+		});
+
+		r.Add("JobSystem/TaskGroup" + suffix, 1024, [t](size_t calls)
+		{
+			JobSystem& jobs = Pool(t);
+			std::atomic<int> sum(0);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				TaskGroup group(jobs);
+				for (int i = 0; i < 1024; ++i)
+					group.Run([&sum, i] { sum.fetch_add(i, std::memory_order_relaxed); });
+				group.Wait();
+			}
+			DoNotOptimize(sum);
+		});
+	}
+}
@@ -0,0 +1,138 @@
+//***************************************************************************************
+// MathHelperBench.cpp
+//
+// Common/MathHelper and Common/Random (DirectXMath).  Only built when
+// DirectXMath is found.  Matrices are kept as XMFLOAT4X4 and loaded per
+// call, as the app does.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Common/MathHelper.h"
+
+#include <memory>
+
+using namespace bench;
+using namespace DirectX;
+
+namespace
+{
+	struct MathHelperData
+	{
+		std::vector<XMFLOAT4X4> world, out;
+		std::vector<XMFLOAT4> vec;
+		std::vector<float> theta, phi;
+		std::vector<float> rnd;
+		Random rng;
+	};
+}
+
+void bench::RegisterMathHelper(Registry& r)
+{
+	auto d = std::make_shared<MathHelperData>();
+	unsigned s = 11;
+	for (int i = 0; i < kBatch; ++i)
+	{
+		XMMATRIX S = XMMatrixScaling(RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f));
+		XMMATRIX R = XMMatrixRotationRollPitchYaw(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		XMMATRIX T = XMMatrixTranslation(RandF(s, -10.0f, 10.0f), RandF(s, -10.0f, 10.0f), RandF(s, -10.0f, 10.0f));
+		XMFLOAT4X4 w;
+		XMStoreFloat4x4(&w, S * R * T);
+		d->world.push_back(w);
+		d->theta.push_back(RandF(s, 0.0f, 2.0f * MathHelper::Pi));
+		d->phi.push_back(RandF(s, 0.0f, MathHelper::Pi));
+	}
+	d->out.resize(kBatch);
+	d->vec.resize(kBatch);
+	d->rnd.resize(kBatch * 3);
+
+	r.Add("MathHelper/InverseTranspose", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				XMStoreFloat4x4(&d->out[i], MathHelper::InverseTranspose(XMLoadFloat4x4(&d->world[i])));
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("MathHelper/XMMatrixInverse", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				XMMATRIX M = XMLoadFloat4x4(&d->world[i]);
+				XMVECTOR det = XMMatrixDeterminant(M);
+				XMStoreFloat4x4(&d->out[i], XMMatrixInverse(&det, M));
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("MathHelper/AffineInverse", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				XMStoreFloat4x4(&d->out[i], MathHelper::AffineInverse(XMLoadFloat4x4(&d->world[i])));
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("MathHelper/RandUnitVec3", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				XMStoreFloat4(&d->vec[i], MathHelper::RandUnitVec3());
+			DoNotOptimize(d->vec[0]);
+		}
+	});
+
+	r.Add("Random/NextFloat", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->rnd[i] = d->rng.NextFloat();
+			DoNotOptimize(d->rnd[0]);
+		}
+	});
+
+	r.Add("Random/FillUniform", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			d->rng.FillUniform(d->rnd.data(), kBatch, -1.0f, 1.0f);
+			DoNotOptimize(d->rnd[0]);
+		}
+	});
+
+	r.Add("Random/FillNormal", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			d->rng.FillNormal(d->rnd.data(), kBatch);
+			DoNotOptimize(d->rnd[0]);
+		}
+	});
+
+	r.Add("Random/FillUnitVec3", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			d->rng.FillUnitVec3(d->rnd.data(), kBatch);
+			DoNotOptimize(d->rnd[0]);
+		}
+	});
+
+	r.Add("MathHelper/SphericalToCartesian", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				XMStoreFloat4(&d->vec[i], MathHelper::SphericalToCartesian(1.0f, d->theta[i], d->phi[i]));
+			DoNotOptimize(d->vec[0]);
+		}
+	});
+}
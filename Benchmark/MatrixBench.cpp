@@ -0,0 +1,210 @@
+//***************************************************************************************
+// MatrixBench.cpp
+//
+// Math/Matrix: products, the general and affine inverses, interpolation,
+// TRS compose/decompose.
+// Every case reports the cost per matrix over a batch of kBatch matrices.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Math/Quaternion.h"
+
+#include <memory>
+
+using namespace bench;
+
+namespace
+{
+	struct MatrixData
+	{
+		std::vector<Matrix> a, b, out;
+		std::vector<float> trs[10];
+
+		TRSSoA Pose()
+		{
+			TRSSoA s = { trs[0].data(), trs[1].data(), trs[2].data(), trs[3].data(), trs[4].data(),
+				trs[5].data(), trs[6].data(), trs[7].data(), trs[8].data(), trs[9].data() };
+			return s;
+		}
+	};
+
+	Matrix RandomTRS(unsigned& s)
+	{
+		Vector3 T(RandF(s, -10.0f, 10.0f), RandF(s, -10.0f, 10.0f), RandF(s, -10.0f, 10.0f));
+		Vector3 R(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		Vector3 S(RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f));
+		Matrix m;
+		m.identity();
+		m.TRS(T, R, S);
+		return m;
+	}
+}
+
+void bench::RegisterMatrix(Registry& r)
+{
+	auto d = std::make_shared<MatrixData>();
+	unsigned s = 1;
+	for (int i = 0; i < kBatch; ++i)
+	{
+		d->a.push_back(RandomTRS(s));
+		d->b.push_back(RandomTRS(s));
+	}
+	d->out.resize(kBatch);
+	for (auto& v : d->trs)
+		v.resize(kBatch);
+	Matrix::DecomposeArray(d->Pose(), d->a.data(), kBatch);
+
+	r.Add("Matrix/multiply", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i].multiply(d->a[i], d->b[i]);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/multiply_float", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				d->out[i] = d->a[i];
+				d->out[i].multiply(0.5f);
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/inverse", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				d->out[i] = d->a[i];
+				d->out[i].inverse();
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/inverseAffine", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				d->out[i] = d->a[i];
+				d->out[i].inverseAffine();
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/inverseOrthogonal", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				d->out[i] = d->a[i];
+				d->out[i].inverseOrthogonal();
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/InverseArray", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Matrix::InverseArray(d->out.data(), d->a.data(), kBatch);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/Interporate", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				d->out[i] = d->a[i];
+				d->out[i].Interporate(d->b[i], 0.25f);
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/value_lerp", kBatch, [d](size_t calls)
+	{
+		const float t = 0.25f;
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i] = d->a[i] * (1.0f - t) + d->b[i] * t;
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/expr_lerp", kBatch, [d](size_t calls)
+	{
+		const float t = 0.25f;
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i] = expr::lerp(d->a[i], d->b[i], t);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/TRS", kBatch, [d](size_t calls)
+	{
+		Vector3 T(1.0f, 2.0f, 3.0f), S(1.0f, 2.0f, 0.5f);
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				Vector3 R(d->a[i]._41, d->a[i]._42, d->a[i]._43);
+				d->out[i].identity();
+				d->out[i].TRS(T, R, S);
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/Compose", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+			{
+				Vector3 T(d->trs[0][i], d->trs[1][i], d->trs[2][i]);
+				Quaternion R(d->trs[3][i], d->trs[4][i], d->trs[5][i], d->trs[6][i]);
+				Vector3 S(d->trs[7][i], d->trs[8][i], d->trs[9][i]);
+				d->out[i].Compose(T, R, S);
+			}
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/ComposeArray", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Matrix::ComposeArray(d->out.data(), d->Pose(), kBatch);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Matrix/Decompose", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Matrix::DecomposeArray(d->Pose(), d->a.data(), kBatch);
+			DoNotOptimize(d->trs[0][0]);
+		}
+	});
+}
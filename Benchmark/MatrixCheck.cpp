@@ -0,0 +1,477 @@
+//***************************************************************************************
+// MatrixCheck.cpp
+//
+// Parity of the Math/Matrix SIMD kernels (multiply, multiply(float),
+// inverse, Interporate) with the scalar code.  Built once per backend; the
+// MATH_SIMD_SCALAR build writes its results for a fixed set of inputs and
+// the SSE and AVX builds compare theirs against that file:
+//
+//   matrix_check --write <file>
+//   matrix_check --compare <file>
+//
+// Errors are in ULPs of the largest element of the reference matrix, so an
+// element that cancels to near zero is not held to its own tiny ULP.  The
+// SIMD products and lerps use the scalar code's operation order with no
+// fused multiply-add and must match it exactly; the SSE inverse takes a
+// different (Cramer's rule) route to the same adjugate.
+//
+// Every build also checks, on its own, inverseAffine, inverseOrthogonal,
+// inverseFast and InverseArray against its inverse(), and Compose/Decompose:
+// the round trip, mirrored matrices, degenerate axes and the batch versions.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "Check.h"
+#include "../Math/Quaternion.h"
+#include "../Math/Simd.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+	const int CaseCount = 512;
+
+	const float MultiplyUlps = 0.0f;
+	const float ScaleUlps = 0.0f;
+	const float InterporateUlps = 0.0f;
+	const float InverseUlps = 16.0f;
+
+	Matrix RandomTRS(unsigned& s)
+	{
+		Vector3 T(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+		Vector3 R(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		Vector3 S(RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f));
+		Matrix m;
+		m.identity();
+		m.TRS(T, R, S);
+		return m;
+	}
+
+	// A general (non-affine) matrix that stays well conditioned.
+	Matrix RandomGeneral(unsigned& s)
+	{
+		Matrix m;
+		for (int i = 0; i < 16; ++i)
+			m.m[i] = RandF(s, -1.0f, 1.0f) + (i % 5 == 0 ? 4.0f : 0.0f);
+		return m;
+	}
+
+	Matrix RandomPerspective(unsigned& s)
+	{
+		Matrix m;
+		m.PerspectiveFov(RandF(s, 0.5f, 1.5f), RandF(s, 0.5f, 2.0f), RandF(s, 0.1f, 1.0f), RandF(s, 100.0f, 1000.0f));
+		return m;
+	}
+
+	struct Inputs
+	{
+		std::vector<Matrix> a, b;
+		std::vector<float> rate;
+
+		Inputs()
+		{
+			unsigned s = 17;
+			for (int i = 0; i < CaseCount; ++i)
+			{
+				switch (i % 3)
+				{
+				case 0: a.push_back(RandomTRS(s)); b.push_back(RandomTRS(s)); break;
+				case 1: a.push_back(RandomGeneral(s)); b.push_back(RandomGeneral(s)); break;
+				default: a.push_back(RandomPerspective(s)); b.push_back(RandomTRS(s)); break;
+				}
+				rate.push_back(RandF(s, 0.0f, 1.0f));
+			}
+		}
+	};
+
+	enum Operation { Multiply, Scale, Inverse, Interporate, OperationCount };
+	const char* const OperationNames[OperationCount] = { "multiply", "multiply(float)", "inverse", "Interporate" };
+	const float Tolerances[OperationCount] = { MultiplyUlps, ScaleUlps, InverseUlps, InterporateUlps };
+
+	// Results, operation by operation, CaseCount matrices each.
+	std::vector<Matrix> Compute(const Inputs& in)
+	{
+		std::vector<Matrix> out((size_t)OperationCount * CaseCount);
+		for (int i = 0; i < CaseCount; ++i)
+		{
+			out[Multiply * CaseCount + i].multiply(in.a[i], in.b[i]);
+
+			Matrix scaled = in.a[i];
+			scaled.multiply(in.rate[i] * 8.0f - 4.0f);
+			out[Scale * CaseCount + i] = scaled;
+
+			Matrix inverse = in.a[i];
+			inverse.inverse();
+			out[Inverse * CaseCount + i] = inverse;
+
+			Matrix lerp = in.a[i];
+			Matrix target = in.b[i];
+			lerp.Interporate(target, in.rate[i]);
+			out[Interporate * CaseCount + i] = lerp;
+		}
+		return out;
+	}
+
+	float MatrixUlps(const Matrix& value, const Matrix& reference)
+	{
+		float largest = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			largest = std::max(largest, std::fabs(reference.m[i]));
+		float ulp = std::max(largest, FLT_MIN) * FLT_EPSILON;
+
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			error = std::max(error, std::fabs(value.m[i] - reference.m[i]) / ulp);
+		return error;
+	}
+
+	// multiply() may alias either operand.
+	void CheckAliasing(const Inputs& in)
+	{
+		bool same = true;
+		for (int i = 0; i < CaseCount; ++i)
+		{
+			Matrix expected;
+			expected.multiply(in.a[i], in.b[i]);
+			Matrix left = in.a[i];
+			left.multiply(left, in.b[i]);
+			Matrix right = in.b[i];
+			right.multiply(in.a[i], right);
+			same = same && !memcmp(&left, &expected, sizeof(Matrix)) && !memcmp(&right, &expected, sizeof(Matrix));
+		}
+		check::Expect("multiply with the result aliasing an operand", same);
+	}
+
+	// An affine matrix with a sheared, non-orthogonal upper 3x3.
+	Matrix RandomAffine(unsigned& s)
+	{
+		Matrix m = RandomGeneral(s);
+		m._14 = m._24 = m._34 = 0.0f;
+		m._44 = 1.0f;
+		m._41 *= 100.0f;	m._42 *= 100.0f;	m._43 *= 100.0f;
+		return m;
+	}
+
+	// A rigid transform: unit scale, orthonormal rows.
+	Matrix RandomRigid(unsigned& s)
+	{
+		Vector3 T(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+		Vector3 R(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		Vector3 S(1.0f, 1.0f, 1.0f);
+		Matrix m;
+		m.identity();
+		m.TRS(T, R, S);
+		return m;
+	}
+
+	template<class Invert>
+	float WorstInverse(const std::vector<Matrix>& in, Invert invert)
+	{
+		float worst = 0.0f;
+		for (const Matrix& m : in)
+		{
+			Matrix expected = m, value = m;
+			expected.inverse();
+			invert(value);
+			worst = std::max(worst, MatrixUlps(value, expected));
+		}
+		return worst;
+	}
+
+	// Whether two inverses give bit-identical results on every input.
+	template<class A, class B>
+	bool SameInverse(const std::vector<Matrix>& in, A a, B b)
+	{
+		bool same = true;
+		for (const Matrix& m : in)
+		{
+			Matrix x = m, y = m;
+			a(x);
+			b(y);
+			same = same && !memcmp(&x, &y, sizeof(Matrix));
+		}
+		return same;
+	}
+
+	// The cheaper inverses against inverse() in the same build, on the
+	// inputs each one accepts, within InverseUlps.
+	void CheckInverses()
+	{
+		unsigned s = 23;
+		std::vector<Matrix> affine, orthogonal, projective;
+		for (int i = 0; i < CaseCount / 4; ++i)
+		{
+			affine.push_back(RandomAffine(s));
+			orthogonal.push_back(RandomRigid(s));
+			orthogonal.push_back(RandomTRS(s));
+			projective.push_back(RandomPerspective(s));
+			projective.push_back(RandomGeneral(s));
+		}
+
+		auto affineInverse = [](Matrix& m){ m.inverseAffine(); };
+		auto orthogonalInverse = [](Matrix& m){ m.inverseOrthogonal(); };
+		auto fastInverse = [](Matrix& m){ m.inverseFast(); };
+		check::ExpectAtMost("inverseAffine, affine", WorstInverse(affine, affineInverse), InverseUlps);
+		check::ExpectAtMost("inverseAffine, orthogonal", WorstInverse(orthogonal, affineInverse), InverseUlps);
+		check::ExpectAtMost("inverseOrthogonal, orthogonal", WorstInverse(orthogonal, orthogonalInverse), InverseUlps);
+		check::ExpectAtMost("inverseFast, affine", WorstInverse(affine, fastInverse), InverseUlps);
+		check::ExpectAtMost("inverseFast, orthogonal", WorstInverse(orthogonal, fastInverse), InverseUlps);
+
+		// inverseFast must pick the path for each kind of input, bit for bit.
+		auto generalInverse = [](Matrix& m){ m.inverse(); };
+		check::Expect("inverseFast of a projective matrix is inverse()",
+			SameInverse(projective, fastInverse, generalInverse));
+		check::Expect("inverseFast of a sheared affine matrix is inverseAffine()",
+			SameInverse(affine, fastInverse, affineInverse));
+		check::Expect("inverseFast of orthogonal rows is inverseOrthogonal()",
+			SameInverse(orthogonal, fastInverse, orthogonalInverse));
+
+		// InverseArray over all three kinds, in place, against inverseFast().
+		std::vector<Matrix> mixed;
+		for (size_t i = 0; i < affine.size(); ++i)
+		{
+			mixed.push_back(affine[i]);
+			mixed.push_back(orthogonal[i]);
+			mixed.push_back(projective[i]);
+		}
+		std::vector<Matrix> batch = mixed;
+		Matrix::InverseArray(batch.data(), batch.data(), (int)batch.size());
+		float worst = 0.0f;
+		bool same = true;
+		for (size_t i = 0; i < mixed.size(); ++i)
+		{
+			Matrix expected = mixed[i], fast = mixed[i];
+			expected.inverse();
+			fast.inverseFast();
+			worst = std::max(worst, MatrixUlps(batch[i], expected));
+			same = same && !memcmp(&batch[i], &fast, sizeof(Matrix));
+		}
+		check::ExpectAtMost("InverseArray, mixed, in place", worst, InverseUlps);
+		check::Expect("InverseArray matches inverseFast", same);
+	}
+
+	const int PoseCount = 256;
+
+	// Compose/Decompose error limits: relative to the largest scale for S,
+	// per component for R and in ULPs of the largest element for a
+	// recomposed matrix.
+	const float DecomposeScaleError = 2e-6f;
+	const float DecomposeRotationError = 2e-6f;
+	const float RecomposeUlps = 16.0f;
+
+	struct Pose
+	{
+		Vector3 T, S;
+		Quaternion R;
+	};
+
+	// Odd poses are mirrored: one scale axis, chosen at random, is negative.
+	Pose RandomPose(unsigned& s, bool mirrored)
+	{
+		Pose p;
+		p.T = Vector3(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+		p.R = Quaternion(RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f));
+		p.R.normalize();
+		p.S = Vector3(RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f));
+		if (mirrored)
+		{
+			float* axis[3] = { &p.S.x, &p.S.y, &p.S.z };
+			*axis[(int)RandF(s, 0.0f, 2.999f)] *= -1.0f;
+		}
+		return p;
+	}
+
+	// Decompose() of Compose(), and Compose() of that again.  An unmirrored
+	// pose comes back as itself (R up to sign); a mirrored one comes back
+	// with the reflection on S.z and must recompose to the same matrix.
+	void CheckDecompose()
+	{
+		unsigned s = 29;
+		bool ok = true, mirroredZ = true;
+		float scaleError = 0.0f, rotationError = 0.0f, recomposeError = 0.0f;
+		for (int i = 0; i < PoseCount; ++i)
+		{
+			bool mirrored = (i & 1) != 0;
+			Pose p = RandomPose(s, mirrored);
+			Matrix m;
+			m.Compose(p.T, p.R, p.S);
+
+			Pose d;
+			ok = ok && m.Decompose(d.T, d.R, d.S);
+			ok = ok && d.T == p.T;
+
+			// Without T, so the error is in ULPs of the rotation and scale.
+			Vector3 none(0, 0, 0);
+			Matrix again, origin;
+			again.Compose(none, d.R, d.S);
+			origin.Compose(none, p.R, p.S);
+			recomposeError = std::max(recomposeError, MatrixUlps(again, origin));
+
+			if (mirrored)
+			{
+				mirroredZ = mirroredZ && d.S.x > 0.0f && d.S.y > 0.0f && d.S.z < 0.0f;
+				continue;
+			}
+			float largest = std::max(p.S.x, std::max(p.S.y, p.S.z));
+			scaleError = std::max(scaleError, std::fabs(d.S.x - p.S.x) / largest);
+			scaleError = std::max(scaleError, std::fabs(d.S.y - p.S.y) / largest);
+			scaleError = std::max(scaleError, std::fabs(d.S.z - p.S.z) / largest);
+
+			float sign = d.R.x*p.R.x + d.R.y*p.R.y + d.R.z*p.R.z + d.R.w*p.R.w < 0.0f ? -1.0f : 1.0f;
+			rotationError = std::max(rotationError, std::fabs(d.R.x * sign - p.R.x));
+			rotationError = std::max(rotationError, std::fabs(d.R.y * sign - p.R.y));
+			rotationError = std::max(rotationError, std::fabs(d.R.z * sign - p.R.z));
+			rotationError = std::max(rotationError, std::fabs(d.R.w * sign - p.R.w));
+		}
+		check::Expect("Decompose of Compose succeeds with T unchanged", ok);
+		check::Expect("Decompose of a mirrored matrix gives a negative S.z", mirroredZ);
+		check::ExpectAtMost("Decompose scale error", scaleError, DecomposeScaleError);
+		check::ExpectAtMost("Decompose rotation error", rotationError, DecomposeRotationError);
+		check::ExpectAtMost("Compose of Decompose, ULPs", recomposeError, RecomposeUlps);
+	}
+
+	// Rows that leave no basis: Decompose() and DecomposeArray() return false.
+	void CheckDegenerate()
+	{
+		const Matrix degenerate[] =
+		{
+			Matrix(0, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  1, 2, 3, 1),	// zero row 0
+			Matrix(1, 2, 3, 0,  2, 4, 6, 0,  0, 0, 1, 0,  1, 2, 3, 1),	// row 1 parallel to row 0
+			Matrix(1, 0, 0, 0,  0, 2, 0, 0,  3, 4, 0, 0,  1, 2, 3, 1),	// row 2 in their plane
+		};
+		const int count = sizeof(degenerate) / sizeof(degenerate[0]);
+
+		bool rejected = true;
+		for (int i = 0; i < count; ++i)
+		{
+			Vector3 T, S;
+			Quaternion R;
+			rejected = rejected && !degenerate[i].Decompose(T, R, S);
+		}
+		check::Expect("Decompose returns false for degenerate axes", rejected);
+
+		unsigned s = 31;
+		Matrix batch[5];
+		for (int i = 0; i < 5; ++i)
+		{
+			Pose p = RandomPose(s, false);
+			batch[i].Compose(p.T, p.R, p.S);
+		}
+		batch[3] = degenerate[1];
+		std::vector<float> lanes(10 * 5);
+		TRSSoA out = { &lanes[0], &lanes[5], &lanes[10], &lanes[15], &lanes[20],
+			&lanes[25], &lanes[30], &lanes[35], &lanes[40], &lanes[45] };
+		check::Expect("DecomposeArray returns false if any axis is degenerate",
+			!Matrix::DecomposeArray(out, batch, 5));
+	}
+
+	// ComposeArray() and DecomposeArray() against the single-pose calls,
+	// for counts that leave every remainder of the 4-wide kernel.
+	void CheckPoseArrays()
+	{
+		const int MaxCount = 11;
+		unsigned s = 37;
+		bool composeSame = true, decomposeSame = true;
+		for (int count = 1; count <= MaxCount; ++count)
+		{
+			std::vector<float> lanes(10 * count), back(10 * count);
+			TRSSoA in = { &lanes[0], &lanes[count], &lanes[2 * count], &lanes[3 * count], &lanes[4 * count],
+				&lanes[5 * count], &lanes[6 * count], &lanes[7 * count], &lanes[8 * count], &lanes[9 * count] };
+			TRSSoA out = { &back[0], &back[count], &back[2 * count], &back[3 * count], &back[4 * count],
+				&back[5 * count], &back[6 * count], &back[7 * count], &back[8 * count], &back[9 * count] };
+
+			std::vector<Matrix> expected(count), batch(count);
+			for (int i = 0; i < count; ++i)
+			{
+				Pose p = RandomPose(s, (i & 1) != 0);
+				in.tx[i] = p.T.x;	in.ty[i] = p.T.y;	in.tz[i] = p.T.z;
+				in.qx[i] = p.R.x;	in.qy[i] = p.R.y;	in.qz[i] = p.R.z;	in.qw[i] = p.R.w;
+				in.sx[i] = p.S.x;	in.sy[i] = p.S.y;	in.sz[i] = p.S.z;
+				expected[i].Compose(p.T, p.R, p.S);
+			}
+			Matrix::ComposeArray(batch.data(), in, count);
+			composeSame = composeSame && !memcmp(batch.data(), expected.data(), sizeof(Matrix) * count);
+
+			decomposeSame = decomposeSame && Matrix::DecomposeArray(out, batch.data(), count);
+			for (int i = 0; i < count; ++i)
+			{
+				Vector3 T, S;
+				Quaternion R;
+				batch[i].Decompose(T, R, S);
+				decomposeSame = decomposeSame &&
+					out.tx[i] == T.x && out.ty[i] == T.y && out.tz[i] == T.z &&
+					out.qx[i] == R.x && out.qy[i] == R.y && out.qz[i] == R.z && out.qw[i] == R.w &&
+					out.sx[i] == S.x && out.sy[i] == S.y && out.sz[i] == S.z;
+			}
+		}
+		check::Expect("ComposeArray matches Compose, counts 1-11", composeSame);
+		check::Expect("DecomposeArray matches Decompose, counts 1-11", decomposeSame);
+	}
+
+	int Write(const char* path, const std::vector<Matrix>& results)
+	{
+		FILE* f = fopen(path, "wb");
+		if (!f || fwrite(results.data(), sizeof(Matrix), results.size(), f) != results.size())
+		{
+			fprintf(stderr, "cannot write %s\n", path);
+			if (f)
+				fclose(f);
+			return 2;
+		}
+		fclose(f);
+		printf("wrote %d %s reference results to %s\n", (int)results.size(), MATH_SIMD_BACKEND_NAME, path);
+		return 0;
+	}
+
+	int Compare(const char* path, const std::vector<Matrix>& results)
+	{
+		std::vector<Matrix> reference(results.size());
+		FILE* f = fopen(path, "rb");
+		if (!f || fread(reference.data(), sizeof(Matrix), reference.size(), f) != reference.size())
+		{
+			fprintf(stderr, "cannot read %s\n", path);
+			if (f)
+				fclose(f);
+			return 2;
+		}
+		fclose(f);
+
+		printf("%s against the scalar reference, error in ULPs of each matrix's largest element\n",
+			MATH_SIMD_BACKEND_NAME);
+		for (int op = 0; op < OperationCount; ++op)
+		{
+			float worst = 0.0f;
+			for (int i = 0; i < CaseCount; ++i)
+			{
+				size_t k = (size_t)op * CaseCount + i;
+				worst = std::max(worst, MatrixUlps(results[k], reference[k]));
+			}
+			check::ExpectAtMost(OperationNames[op], worst, Tolerances[op]);
+		}
+		return check::Result();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Inputs in;
+	std::vector<Matrix> results = Compute(in);
+	CheckAliasing(in);
+	CheckInverses();
+	CheckDecompose();
+	CheckDegenerate();
+	CheckPoseArrays();
+
+	if (argc == 3 && !strcmp(argv[1], "--write"))
+		return Write(argv[2], results) ? 2 : check::Result();
+	if (argc == 3 && !strcmp(argv[1], "--compare"))
+		return Compare(argv[2], results);
+
+	fprintf(stderr, "usage: %s --write <file> | --compare <file>\n", argv[0]);
+	return 2;
+}
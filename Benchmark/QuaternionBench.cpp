@@ -0,0 +1,147 @@
+//***************************************************************************************
+// QuaternionBench.cpp
+//
+// Math/Quaternion: scalar slerp and product against the batched SoA
+// interpolators, plus DualQuaternion conversion and skin blending.
+// Every case reports the cost per quaternion (or vertex) over kBatch.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Math/DualQuaternion.h"
+
+#include <memory>
+
+using namespace bench;
+
+namespace
+{
+	struct QuaternionData
+	{
+		std::vector<Quaternion> q, r, out;
+		std::vector<float> t;
+		std::vector<float> qx, qy, qz, qw, rx, ry, rz, rw, ox, oy, oz, ow;
+
+		std::vector<Matrix> bones;
+		std::vector<DualQuaternion> palette, blended;
+		std::vector<int> indices;
+		std::vector<float> weights;
+
+		QuaternionSoA Q() { QuaternionSoA s = { qx.data(), qy.data(), qz.data(), qw.data() }; return s; }
+		QuaternionSoA R() { QuaternionSoA s = { rx.data(), ry.data(), rz.data(), rw.data() }; return s; }
+		QuaternionSoA O() { QuaternionSoA s = { ox.data(), oy.data(), oz.data(), ow.data() }; return s; }
+	};
+
+	Quaternion RandomRotation(unsigned& s)
+	{
+		Quaternion q(RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f));
+		q.normalize();
+		return q;
+	}
+}
+
+void bench::RegisterQuaternion(Registry& r)
+{
+	auto d = std::make_shared<QuaternionData>();
+	unsigned s = 3;
+	for (int i = 0; i < kBatch; ++i)
+	{
+		Quaternion a = RandomRotation(s);
+		Quaternion b = RandomRotation(s);
+		d->q.push_back(a);
+		d->r.push_back(b);
+		d->t.push_back(RandF(s, 0.0f, 1.0f));
+		d->qx.push_back(a.x); d->qy.push_back(a.y); d->qz.push_back(a.z); d->qw.push_back(a.w);
+		d->rx.push_back(b.x); d->ry.push_back(b.y); d->rz.push_back(b.z); d->rw.push_back(b.w);
+	}
+	d->out.resize(kBatch);
+	d->ox.resize(kBatch); d->oy.resize(kBatch); d->oz.resize(kBatch); d->ow.resize(kBatch);
+
+	// 128 bones, four influences per vertex.
+	const int boneCount = 128;
+	for (int i = 0; i < boneCount; ++i)
+	{
+		Vector3 T(RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f));
+		Vector3 R(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		Vector3 S(1.0f, 1.0f, 1.0f);
+		Matrix m;
+		m.identity();
+		m.TRS(T, R, S);
+		DualQuaternion dq;
+		dq.fromMatrix(m);
+		d->bones.push_back(m);
+		d->palette.push_back(dq);
+	}
+	for (int i = 0; i < kBatch * 4; ++i)
+	{
+		d->indices.push_back((int)RandF(s, 0.0f, (float)boneCount));
+		d->weights.push_back(0.25f);
+	}
+	d->blended.resize(kBatch);
+
+	r.Add("Quaternion/multiply", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i] = d->q[i] * d->r[i];
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Quaternion/slerp", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i].slerp(d->q[i], d->r[i], d->t[i]);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Quaternion/SlerpSoA", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Quaternion::SlerpSoA(d->O(), d->Q(), d->R(), d->t.data(), kBatch);
+			DoNotOptimize(d->ox[0]);
+		}
+	});
+
+	r.Add("Quaternion/NlerpSoA", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Quaternion::NlerpSoA(d->O(), d->Q(), d->R(), d->t.data(), kBatch);
+			DoNotOptimize(d->ox[0]);
+		}
+	});
+
+	r.Add("Quaternion/FastSlerpSoA", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Quaternion::FastSlerpSoA(d->O(), d->Q(), d->R(), d->t.data(), kBatch);
+			DoNotOptimize(d->ox[0]);
+		}
+	});
+
+	r.Add("DualQuaternion/fromMatrix", boneCount, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < boneCount; ++i)
+				d->palette[i].fromMatrix(d->bones[i]);
+			DoNotOptimize(d->palette[0]);
+		}
+	});
+
+	r.Add("DualQuaternion/BlendArray4", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			DualQuaternion::BlendArray(d->blended.data(), d->palette.data(),
+				d->indices.data(), d->weights.data(), 4, kBatch);
+			DoNotOptimize(d->blended[0]);
+		}
+	});
+}
@@ -0,0 +1,162 @@
+//***************************************************************************************
+// QuaternionCheck.cpp
+//
+// Accuracy of Quaternion::SlerpSoA, NlerpSoA and FastSlerpSoA against slerp.
+// Errors are rotation angles, in radians, from the scalar slerp formula
+// evaluated in double, over random pairs from every direction, nearly
+// parallel pairs and pairs on opposite hemispheres (the shortest-path flip).
+// The count is not a multiple of the SIMD width, so the padded tail is
+// covered too.
+//
+// The reference is double because the float Quaternion::slerp is itself off
+// by 3.4e-5 rad on nearly parallel pairs, where 1 - dot^2 rounds to zero and
+// it returns q; it is checked alongside.  Nlerp's limit is its own error,
+// not the kernel's: for pairs up to 180 degrees of rotation apart it drifts
+// from slerp by up to 0.142 rad.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "Check.h"
+#include "../Math/Quaternion.h"
+#include "../Math/Simd.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+	const int PairCount = 100003;
+
+	const double ScalarSlerpLimit = 5e-5;
+	const double SlerpLimit = 2e-6;
+	const double FastSlerpLimit = 2e-3;
+	const double NlerpLimit = 0.15;
+
+	Quaternion RandomUnit(unsigned& s)
+	{
+		Quaternion q;
+		float length;
+		do
+		{
+			q = Quaternion(RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f), RandF(s, -1.0f, 1.0f));
+			length = q.getLength();
+		} while (length < 0.1f || length > 1.0f);
+		q.normalize();
+		return q;
+	}
+
+	// Rotation angle between two unit quaternions, either sign.
+	double RotationAngle(const Quaternion& a, const Quaternion& b)
+	{
+		double dot = (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z + (double)a.w*b.w;
+		double s = dot < 0.0 ? -1.0 : 1.0;
+		double dx = a.x - s*b.x, dy = a.y - s*b.y, dz = a.z - s*b.z, dw = a.w - s*b.w;
+		double px = a.x + s*b.x, py = a.y + s*b.y, pz = a.z + s*b.z, pw = a.w + s*b.w;
+		double half = atan2(sqrt(dx*dx + dy*dy + dz*dz + dw*dw), sqrt(px*px + py*py + pz*pz + pw*pw));
+		return 4.0 * half;
+	}
+
+	// Quaternion::slerp, in double and without the t clamps and the
+	// parallel-pair early out.
+	Quaternion ReferenceSlerp(const Quaternion& q, const Quaternion& r, double t)
+	{
+		double dot = (double)q.x*r.x + (double)q.y*r.y + (double)q.z*r.z + (double)q.w*r.w;
+		double sign = dot < 0.0 ? -1.0 : 1.0;
+		double angle = acos(std::min(1.0, dot * sign));
+		double k0 = 1.0 - t, k1 = t;
+		if (angle > 1e-12)
+		{
+			k0 = sin((1.0 - t) * angle) / sin(angle);
+			k1 = sin(t * angle) / sin(angle);
+		}
+		k1 *= sign;
+		return Quaternion((float)(k0*q.x + k1*r.x), (float)(k0*q.y + k1*r.y),
+			(float)(k0*q.z + k1*r.z), (float)(k0*q.w + k1*r.w));
+	}
+
+	struct Batch
+	{
+		std::vector<float> v[4];
+
+		explicit Batch(int count)
+		{
+			for (auto& c : v)
+				c.resize(count);
+		}
+
+		QuaternionSoA View() { QuaternionSoA s = { v[0].data(), v[1].data(), v[2].data(), v[3].data() }; return s; }
+		void Set(int i, const Quaternion& q) { v[0][i] = q.x; v[1][i] = q.y; v[2][i] = q.z; v[3][i] = q.w; }
+		Quaternion Get(int i) const { return Quaternion(v[0][i], v[1][i], v[2][i], v[3][i]); }
+	};
+
+	typedef void (*BatchFn)(const QuaternionSoA&, const QuaternionSoA&, const QuaternionSoA&, const float*, int);
+}
+
+int main()
+{
+	Batch q(PairCount), r(PairCount), out(PairCount);
+	std::vector<float> t(PairCount);
+	std::vector<Quaternion> expected(PairCount), scalar(PairCount);
+
+	unsigned s = 5;
+	for (int i = 0; i < PairCount; ++i)
+	{
+		Quaternion a = RandomUnit(s);
+		Quaternion b = RandomUnit(s);
+		if (i % 4 == 1)
+		{
+			// Nearly parallel.
+			b = Quaternion(a.x + RandF(s, -1e-5f, 1e-5f), a.y + RandF(s, -1e-5f, 1e-5f),
+				a.z + RandF(s, -1e-5f, 1e-5f), a.w + RandF(s, -1e-5f, 1e-5f));
+			b.normalize();
+		}
+		else if (i % 4 == 2)
+		{
+			// Opposite hemisphere: slerp must take the short way.
+			float d = a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
+			if (d > 0.0f)
+				b = -b;
+		}
+		q.Set(i, a);
+		r.Set(i, b);
+		t[i] = RandF(s, 0.0f, 1.0f);
+		expected[i] = ReferenceSlerp(a, b, t[i]);
+		scalar[i].slerp(a, b, t[i]);
+	}
+
+	printf("%s, %d pairs\n", MATH_SIMD_BACKEND_NAME, PairCount);
+	double worstScalar = 0.0;
+	for (int i = 0; i < PairCount; ++i)
+		worstScalar = std::max(worstScalar, RotationAngle(scalar[i], expected[i]));
+	check::ExpectAtMost("slerp max angle from reference (rad)", worstScalar, ScalarSlerpLimit);
+
+	struct Variant
+	{
+		const char* name;
+		BatchFn fn;
+		double limit;
+	};
+	const Variant variants[] =
+	{
+		{ "SlerpSoA max angle from reference (rad)", &Quaternion::SlerpSoA, SlerpLimit },
+		{ "FastSlerpSoA max angle from reference (rad)", &Quaternion::FastSlerpSoA, FastSlerpLimit },
+		{ "NlerpSoA max angle from reference (rad)", &Quaternion::NlerpSoA, NlerpLimit },
+	};
+
+	for (const Variant& v : variants)
+	{
+		v.fn(out.View(), q.View(), r.View(), t.data(), PairCount);
+		double worst = 0.0, worstLength = 0.0;
+		for (int i = 0; i < PairCount; ++i)
+		{
+			Quaternion o = out.Get(i);
+			worst = std::max(worst, RotationAngle(o, expected[i]));
+			worstLength = std::max(worstLength, (double)std::fabs(o.getLength() - 1.0f));
+		}
+		check::ExpectAtMost(v.name, worst, v.limit);
+		check::ExpectAtMost("  ...and largest |length - 1|", worstLength, 1e-5);
+	}
+	return check::Result();
+}
@@ -0,0 +1,141 @@
+//***************************************************************************************
+// SamplingBench.cpp
+//
+// Common/Sampling: 2D point sets and the sphere/hemisphere/disk warps, against
+// the one-at-a-time MathHelper::RandHemisphereUnitVec3.  Every case reports
+// the cost per sample over kBatch samples.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Common/MathHelper.h"
+#include "../Common/Sampling.h"
+
+#include <memory>
+
+using namespace bench;
+using namespace DirectX;
+
+namespace
+{
+	struct SamplingData
+	{
+		std::vector<XMFLOAT2> uv, disk;
+		std::vector<XMFLOAT3> dir;
+		std::vector<XMFLOAT4> kernel;
+		Random rng;
+	};
+}
+
+void bench::RegisterSampling(Registry& r)
+{
+	auto d = std::make_shared<SamplingData>();
+	d->uv.resize(kBatch);
+	d->disk.resize(kBatch);
+	d->dir.resize(kBatch);
+	d->kernel.resize(kBatch);
+	Sampling::Sobol2D(d->uv.data(), kBatch);
+
+	r.Add("Sampling/Random2D", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::Random2D(d->disk.data(), kBatch, d->rng);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	r.Add("Sampling/Stratified2D", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::Stratified2D(d->disk.data(), 32, kBatch / 32, d->rng);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	r.Add("Sampling/Hammersley2D", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::Hammersley2D(d->disk.data(), kBatch, (uint32_t)c);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	r.Add("Sampling/Sobol2D", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::Sobol2D(d->disk.data(), kBatch, (uint32_t)c, (uint32_t)c);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	// Quadratic in the point count; 64 points is a typical kernel.
+	r.Add("Sampling/BlueNoise2D_64", 64, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::BlueNoise2D(d->disk.data(), 64, d->rng);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	r.Add("Sampling/ToSphere", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::ToSphere(d->dir.data(), d->uv.data(), kBatch);
+			DoNotOptimize(d->dir[0]);
+		}
+	});
+
+	r.Add("Sampling/ToCosineHemisphere", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::ToCosineHemisphere(d->dir.data(), d->uv.data(), kBatch);
+			DoNotOptimize(d->dir[0]);
+		}
+	});
+
+	r.Add("Sampling/ToDisk", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::ToDisk(d->disk.data(), d->uv.data(), kBatch);
+			DoNotOptimize(d->disk[0]);
+		}
+	});
+
+	r.Add("Sampling/Hemisphere+Orient", kBatch, [d](size_t calls)
+	{
+		XMVECTOR n = XMVector3Normalize(XMVectorSet(0.3f, 0.9f, -0.2f, 0.0f));
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::ToHemisphere(d->dir.data(), d->uv.data(), kBatch);
+			Sampling::OrientHemisphere(d->dir.data(), kBatch, n);
+			DoNotOptimize(d->dir[0]);
+		}
+	});
+
+	r.Add("MathHelper/RandHemisphereUnitVec3", kBatch, [d](size_t calls)
+	{
+		XMVECTOR n = XMVector3Normalize(XMVectorSet(0.3f, 0.9f, -0.2f, 0.0f));
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				XMStoreFloat3(&d->dir[i], MathHelper::RandHemisphereUnitVec3(n));
+			DoNotOptimize(d->dir[0]);
+		}
+	});
+
+	r.Add("Sampling/SsaoKernel", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Sampling::SsaoKernel(d->kernel.data(), kBatch, d->rng);
+			DoNotOptimize(d->kernel[0]);
+		}
+	});
+}
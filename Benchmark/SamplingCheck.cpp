@@ -0,0 +1,196 @@
+//***************************************************************************************
+// SamplingCheck.cpp
+//
+// Distribution properties of Common/Sampling, which a speed-up of the warps
+// or generators must keep:
+//
+//   - sphere and hemisphere samples have unit length (hemispheres z >= 0),
+//     and the mean z is 0 on the sphere, 1/2 on the hemisphere and 2/3 for
+//     the cosine-weighted hemisphere;
+//   - disk samples lie in the unit disk with r^2 uniform on [0, 1]
+//     (Kolmogorov-Smirnov distance under the 1% critical value);
+//   - every power-of-two prefix of Sobol2D, and Hammersley2D of a
+//     power-of-two count, is a (0, m, 2)-net: each 2^a x 2^(m-a) cell
+//     holds exactly one point, with and without scrambling;
+//   - BlueNoise2D's minimum spacing is several times that of white noise.
+//
+// Counts that are not multiples of four cover the batch tails.
+//***************************************************************************************
+
+#include "Check.h"
+#include "../Common/Sampling.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t WarpCount = 65535;
+	const uint32_t DiskCount = 16383;
+	const uint32_t NetLog2 = 12;
+	const uint32_t NoiseCount = 255;
+
+	const double LengthLimit = 1e-5;
+	const double RandomMeanLimit = 0.01;	// about 4 standard errors
+	const double SobolMeanLimit = 1e-3;
+	const double NoiseSpacingRatio = 4.0;
+
+	struct Moments
+	{
+		double length = 0.0;	// largest |length - 1|
+		double minZ = 1.0;
+		double meanZ = 0.0;
+	};
+
+	Moments Measure(const std::vector<XMFLOAT3>& v)
+	{
+		Moments m;
+		for (const XMFLOAT3& p : v)
+		{
+			double length = std::sqrt((double)p.x*p.x + (double)p.y*p.y + (double)p.z*p.z);
+			m.length = std::max(m.length, std::fabs(length - 1.0));
+			m.minZ = std::min(m.minZ, (double)p.z);
+			m.meanZ += p.z;
+		}
+		m.meanZ /= v.size();
+		return m;
+	}
+
+	void CheckWarps(const char* input, const std::vector<XMFLOAT2>& u, double meanLimit)
+	{
+		std::vector<XMFLOAT3> v(u.size());
+		char what[96];
+
+		Sampling::ToSphere(v.data(), u.data(), (uint32_t)u.size());
+		Moments sphere = Measure(v);
+		snprintf(what, sizeof(what), "%s sphere |length - 1|", input);
+		check::ExpectAtMost(what, sphere.length, LengthLimit);
+		snprintf(what, sizeof(what), "%s sphere |mean z|", input);
+		check::ExpectAtMost(what, std::fabs(sphere.meanZ), meanLimit);
+
+		Sampling::ToHemisphere(v.data(), u.data(), (uint32_t)u.size());
+		Moments hemisphere = Measure(v);
+		snprintf(what, sizeof(what), "%s hemisphere |length - 1|", input);
+		check::ExpectAtMost(what, hemisphere.length, LengthLimit);
+		snprintf(what, sizeof(what), "%s hemisphere min z", input);
+		check::ExpectAtLeast(what, hemisphere.minZ, 0.0);
+		snprintf(what, sizeof(what), "%s hemisphere |mean z - 1/2|", input);
+		check::ExpectAtMost(what, std::fabs(hemisphere.meanZ - 0.5), meanLimit);
+
+		Sampling::ToCosineHemisphere(v.data(), u.data(), (uint32_t)u.size());
+		Moments cosine = Measure(v);
+		snprintf(what, sizeof(what), "%s cosine hemisphere |length - 1|", input);
+		check::ExpectAtMost(what, cosine.length, LengthLimit);
+		snprintf(what, sizeof(what), "%s cosine hemisphere min z", input);
+		check::ExpectAtLeast(what, cosine.minZ, 0.0);
+		snprintf(what, sizeof(what), "%s cosine hemisphere |mean z - 2/3|", input);
+		check::ExpectAtMost(what, std::fabs(cosine.meanZ - 2.0 / 3.0), meanLimit);
+	}
+
+	void CheckDisk(Random& rng)
+	{
+		std::vector<XMFLOAT2> u(DiskCount), d(DiskCount);
+		Sampling::Random2D(u.data(), DiskCount, rng);
+		Sampling::ToDisk(d.data(), u.data(), DiskCount);
+
+		std::vector<double> r2(DiskCount);
+		for (uint32_t i = 0; i < DiskCount; ++i)
+			r2[i] = (double)d[i].x*d[i].x + (double)d[i].y*d[i].y;
+		std::sort(r2.begin(), r2.end());
+
+		double ks = 0.0;
+		for (uint32_t i = 0; i < DiskCount; ++i)
+			ks = std::max(ks, std::max((i + 1.0) / DiskCount - r2[i], r2[i] - (double)i / DiskCount));
+		check::ExpectAtMost("disk max r^2", r2.back(), 1.0 + 1e-6);
+		check::ExpectAtMost("disk r^2 Kolmogorov-Smirnov distance", ks, 1.63 / std::sqrt((double)DiskCount));
+	}
+
+	// Each 2^a x 2^(m - a) cell of [0, 1)^2 holds exactly one of the 2^m points.
+	bool IsNet(const XMFLOAT2* p, uint32_t m)
+	{
+		uint32_t n = 1u << m;
+		std::vector<uint8_t> seen(n);
+		for (uint32_t a = 0; a <= m; ++a)
+		{
+			std::fill(seen.begin(), seen.end(), 0);
+			for (uint32_t i = 0; i < n; ++i)
+			{
+				uint32_t cx = (uint32_t)(p[i].x * (float)(1u << a));
+				uint32_t cy = (uint32_t)(p[i].y * (float)(1u << (m - a)));
+				if (cx >= (1u << a) || cy >= (1u << (m - a)))
+					return false;
+				uint8_t& cell = seen[(cy << a) | cx];
+				if (cell++)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void CheckNets(Random& rng)
+	{
+		std::vector<XMFLOAT2> p(1u << NetLog2);
+		const uint32_t scrambles[][2] = { { 0, 0 }, { rng.NextU32(), rng.NextU32() } };
+		for (const auto& s : scrambles)
+		{
+			bool sobol = true, hammersley = true;
+			Sampling::Sobol2D(p.data(), 1u << NetLog2, s[0], s[1]);
+			for (uint32_t m = 0; m <= NetLog2; ++m)
+				sobol = sobol && IsNet(p.data(), m);
+			for (uint32_t m = 0; m <= NetLog2; ++m)
+			{
+				Sampling::Hammersley2D(p.data(), 1u << m, s[1]);
+				hammersley = hammersley && IsNet(p.data(), m);
+			}
+			check::Expect(s[0] ? "scrambled Sobol2D prefixes of 2^0..2^12 are (0,m,2)-nets"
+				: "Sobol2D prefixes of 2^0..2^12 are (0,m,2)-nets", sobol);
+			check::Expect(s[0] ? "scrambled Hammersley2D of 2^0..2^12 points are (0,m,2)-nets"
+				: "Hammersley2D of 2^0..2^12 points are (0,m,2)-nets", hammersley);
+		}
+	}
+
+	// Smallest toroidal distance between two points of the set.
+	double MinSpacing(const std::vector<XMFLOAT2>& p)
+	{
+		double best = 2.0;
+		for (size_t i = 0; i < p.size(); ++i)
+		{
+			for (size_t j = i + 1; j < p.size(); ++j)
+			{
+				double dx = std::fabs(p[i].x - p[j].x), dy = std::fabs(p[i].y - p[j].y);
+				dx = std::min(dx, 1.0 - dx);
+				dy = std::min(dy, 1.0 - dy);
+				best = std::min(best, dx*dx + dy*dy);
+			}
+		}
+		return std::sqrt(best);
+	}
+
+	void CheckBlueNoise(Random& rng)
+	{
+		std::vector<XMFLOAT2> white(NoiseCount), blue(NoiseCount);
+		Sampling::Random2D(white.data(), NoiseCount, rng);
+		Sampling::BlueNoise2D(blue.data(), NoiseCount, rng);
+		double w = MinSpacing(white), b = MinSpacing(blue);
+		printf("     min spacing of %u points: white %.5f, blue %.5f\n", NoiseCount, w, b);
+		check::ExpectAtLeast("blue noise / white noise min spacing", b / w, NoiseSpacingRatio);
+	}
+}
+
+int main()
+{
+	Random rng(7);
+
+	std::vector<XMFLOAT2> u(WarpCount);
+	Sampling::Random2D(u.data(), WarpCount, rng);
+	CheckWarps("Random2D", u, RandomMeanLimit);
+	Sampling::Sobol2D(u.data(), WarpCount, rng.NextU32(), rng.NextU32());
+	CheckWarps("Sobol2D", u, SobolMeanLimit);
+
+	CheckDisk(rng);
+	CheckNets(rng);
+	CheckBlueNoise(rng);
+	return check::Result();
+}
@@ -0,0 +1,281 @@
+//***************************************************************************************
+// SkinningBench.cpp
+//
+// DirectX12/SkinnedData pose evaluation for a crowd: every frame, every
+// instance evaluates the final bone transforms of a synthetic skeleton.
+// Heap allocations are counted (see AllocationCounter.h), so the run shows
+// what each variant allocates per frame once warmed up:
+//
+//   legacy   the original GetFinalTransforms, which built two temporary
+//            vectors (local and to-root transforms) per call and scanned
+//            each bone's keyframes from the first
+//   by_name  GetFinalTransforms(clipName, ...), per-thread scratch
+//   scratch  GetFinalTransforms(clip, ..., PoseScratch&, out)
+//   arena    the same with PoseScratch over caller memory
+//   cursor   the same with a per-instance AnimationCursor
+//
+// --keys sets the average number of keyframes per bone; long clips show
+// the cost of searching for the keyframes without a cursor.
+//
+//   skinning_bench [--bones <n>] [--keys <n>] [--instances <n>] [--frames <n>]
+//
+// Exits with 1 if any variant but legacy allocates after the first frame.
+//***************************************************************************************
+
+#include "AllocationCounter.h"
+#include "Benchmark.h"
+#include "../DirectX12/SkinnedData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace bench;
+using namespace DirectX;
+
+namespace
+{
+	struct Options
+	{
+		int bones = 64;
+		int keys = 16;
+		int instances = 256;
+		int frames = 200;
+	};
+
+	// A skeleton whose bones each hang off a random earlier bone, with
+	// keys / 2 to keys * 3 / 2 keyframes per bone over four seconds.
+	struct Rig
+	{
+		std::vector<int> hierarchy;
+		std::vector<XMFLOAT4X4> offsets;
+		AnimationClip clip;
+		SkinnedData data;
+
+		Rig(int bones, int averageKeys)
+		{
+			unsigned state = 1;
+			hierarchy.resize(bones);
+			offsets.resize(bones);
+			clip.BoneAnimations.resize(bones);
+			for (int i = 0; i < bones; ++i)
+			{
+				hierarchy[i] = i == 0 ? 0 : (int)RandF(state, 0.0f, (float)i);
+				XMStoreFloat4x4(&offsets[i], XMMatrixTranslation(RandF(state, -1.0f, 1.0f),
+					RandF(state, -1.0f, 1.0f), RandF(state, -1.0f, 1.0f)));
+
+				int keys = std::max(averageKeys / 2 + (int)RandF(state, 0.0f, averageKeys + 1.0f), 2);
+				for (int k = 0; k < keys; ++k)
+				{
+					Keyframe key;
+					key.TimePos = 4.0f * k / (keys - 1);
+					key.Translation = XMFLOAT3(RandF(state, -0.1f, 0.1f), RandF(state, 0.0f, 0.5f), 0.0f);
+					XMVECTOR q = XMQuaternionRotationRollPitchYaw(RandF(state, -1.0f, 1.0f),
+						RandF(state, -1.0f, 1.0f), RandF(state, -1.0f, 1.0f));
+					XMStoreFloat4(&key.RotationQuat, q);
+					clip.BoneAnimations[i].Keyframes.push_back(key);
+				}
+			}
+
+			std::unordered_map<std::string, AnimationClip> clips;
+			clips["Walk"] = clip;
+			XMFLOAT4X4 identity;
+			XMStoreFloat4x4(&identity, XMMatrixIdentity());
+			data.Set(hierarchy, offsets, clips, identity);
+		}
+
+		// The original BoneAnimation::Interpolate, for comparison.
+		static XMMATRIX LegacyInterpolate(const BoneAnimation& anim, float t)
+		{
+			const std::vector<Keyframe>& keys = anim.Keyframes;
+			size_t i = 0;
+			if (t <= keys.front().TimePos)
+				i = 0;
+			else if (t >= keys.back().TimePos)
+				i = keys.size() - 2;
+			else
+			{
+				while (!(t >= keys[i].TimePos && t <= keys[i + 1].TimePos))
+					++i;
+			}
+
+			float s = (t - keys[i].TimePos) / (keys[i + 1].TimePos - keys[i].TimePos);
+			s = std::min(std::max(s, 0.0f), 1.0f);
+			XMVECTOR S = XMVectorLerp(XMLoadFloat3(&keys[i].Scale), XMLoadFloat3(&keys[i + 1].Scale), s);
+			XMVECTOR P = XMVectorLerp(XMLoadFloat3(&keys[i].Translation), XMLoadFloat3(&keys[i + 1].Translation), s);
+			XMVECTOR Q = XMQuaternionSlerp(XMLoadFloat4(&keys[i].RotationQuat), XMLoadFloat4(&keys[i + 1].RotationQuat), s);
+			return XMMatrixAffineTransformation(S, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), Q, P);
+		}
+
+		// The original SkinnedData::GetFinalTransforms, for comparison.
+		void LegacyFinalTransforms(float timePos, std::vector<XMFLOAT4X4>& finalTransforms)const
+		{
+			size_t numBones = offsets.size();
+
+			std::vector<XMFLOAT4X4> toParentTransforms(numBones);
+			for (size_t i = 0; i < numBones; ++i)
+				XMStoreFloat4x4(&toParentTransforms[i], LegacyInterpolate(clip.BoneAnimations[i], timePos));
+
+			std::vector<XMFLOAT4X4> toRootTransforms(numBones);
+			for (size_t i = 0; i < numBones; ++i)
+			{
+				XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
+				int parentIndex = hierarchy[i];
+				if (parentIndex == (int)i)
+					XMStoreFloat4x4(&toRootTransforms[i], toParent);
+				else
+					XMStoreFloat4x4(&toRootTransforms[i],
+						XMMatrixMultiply(toParent, XMLoadFloat4x4(&toRootTransforms[parentIndex])));
+			}
+
+			for (size_t i = 0; i < numBones; ++i)
+			{
+				XMMATRIX offset = XMLoadFloat4x4(&offsets[i]);
+				XMMATRIX toRoot = XMLoadFloat4x4(&toRootTransforms[i]);
+				XMStoreFloat4x4(&finalTransforms[i], XMMatrixTranspose(XMMatrixMultiply(offset, toRoot)));
+			}
+		}
+	};
+
+	struct Instance
+	{
+		float timePos;
+		std::vector<XMFLOAT4X4> finalTransforms;
+		AnimationCursor cursor;
+	};
+
+	struct Measurement
+	{
+		double nsPerInstance;
+		double allocationsPerFrame;		// after the first frame
+	};
+
+	template<typename EvaluateFn>
+	Measurement Measure(std::vector<Instance>& crowd, int frames, EvaluateFn evaluate)
+	{
+		const float dt = 1.0f / 60.0f;
+
+		long long allocations = 0;
+		double ns = 0.0;
+		for (int f = 0; f < frames; ++f)
+		{
+			long long before = AllocationCount();
+			auto t0 = std::chrono::steady_clock::now();
+			for (Instance& inst : crowd)
+			{
+				inst.timePos += dt;
+				if (inst.timePos > 4.0f)
+					inst.timePos = 0.0f;
+				evaluate(inst);
+			}
+			auto t1 = std::chrono::steady_clock::now();
+
+			// The first frame warms up caches and scratch buffers.
+			if (f == 0)
+				continue;
+			allocations += AllocationCount() - before;
+			ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+		}
+
+		Measurement m;
+		int steady = std::max(frames - 1, 1);
+		m.nsPerInstance = ns / ((double)steady * crowd.size());
+		m.allocationsPerFrame = (double)allocations / steady;
+		return m;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			bool hasValue = i + 1 < argc;
+			bool ok = true;
+			if (!strcmp(a, "--bones") && hasValue)
+				ok = (opt.bones = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--keys") && hasValue)
+				ok = (opt.keys = atoi(argv[++i])) > 1;
+			else if (!strcmp(a, "--instances") && hasValue)
+				ok = (opt.instances = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--frames") && hasValue)
+				ok = (opt.frames = atoi(argv[++i])) > 1;
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				fprintf(stderr, "usage: %s [--bones <n>] [--keys <n>] [--instances <n>] [--frames <n>]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+		return 2;
+
+	Rig rig(opt.bones, opt.keys);
+	const AnimationClip& clip = *rig.data.FindClip("Walk");
+
+	std::vector<Instance> crowd(opt.instances);
+	for (int i = 0; i < opt.instances; ++i)
+	{
+		crowd[i].timePos = 4.0f * i / opt.instances;
+		crowd[i].finalTransforms.resize(opt.bones);
+	}
+
+	PoseScratch scratch;
+	std::vector<XMFLOAT4X4> arenaMemory(opt.bones);
+	PoseScratch arena(arenaMemory.data(), arenaMemory.size());
+
+	struct Variant
+	{
+		const char* name;
+		Measurement m;
+	};
+	Variant variants[] =
+	{
+		{ "legacy", Measure(crowd, opt.frames, [&](Instance& inst)
+			{
+				rig.LegacyFinalTransforms(inst.timePos, inst.finalTransforms);
+			}) },
+		{ "by_name", Measure(crowd, opt.frames, [&](Instance& inst)
+			{
+				rig.data.GetFinalTransforms("Walk", inst.timePos, inst.finalTransforms);
+			}) },
+		{ "scratch", Measure(crowd, opt.frames, [&](Instance& inst)
+			{
+				rig.data.GetFinalTransforms(clip, inst.timePos, scratch, inst.finalTransforms.data());
+			}) },
+		{ "arena", Measure(crowd, opt.frames, [&](Instance& inst)
+			{
+				rig.data.GetFinalTransforms(clip, inst.timePos, arena, inst.finalTransforms.data());
+			}) },
+		{ "cursor", Measure(crowd, opt.frames, [&](Instance& inst)
+			{
+				rig.data.GetFinalTransforms(clip, inst.timePos, inst.cursor, scratch, inst.finalTransforms.data());
+			}) },
+	};
+
+	printf("%d bones, %d keys, %d instances, %d frames\n", opt.bones, opt.keys, opt.instances, opt.frames);
+	printf("%-10s %14s %14s\n", "variant", "ns/instance", "allocs/frame");
+	int status = 0;
+	for (const Variant& v : variants)
+	{
+		printf("%-10s %14.1f %14.1f\n", v.name, v.m.nsPerInstance, v.m.allocationsPerFrame);
+		if (strcmp(v.name, "legacy") && v.m.allocationsPerFrame > 0.0)
+		{
+			fprintf(stderr, "%s allocates in steady state\n", v.name);
+			status = 1;
+		}
+	}
+	return status;
+}
@@ -0,0 +1,253 @@
+//***************************************************************************************
+// Vector3Bench.cpp
+//
+// Math/Vector3: single-point transforms against the batched AoS/SoA paths.
+// The plain cases report the cost per point over kBatch points, which stay
+// in L1.  The size sweep cases (name/1K to name/10M) run the same
+// transforms over growing streams, out to sizes where memory bandwidth
+// rather than arithmetic sets the points/s.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../Math/Matrix.h"
+
+#include <memory>
+#include <string>
+
+using namespace bench;
+
+namespace
+{
+	struct Vector3Data
+	{
+		Matrix mat;
+		std::vector<Vector3> in, out;
+		std::vector<float> x, y, z, ox, oy, oz;
+	};
+
+	const int kSweepSizes[] = { 1 << 10, 1 << 16, 1 << 20, 10 * 1000 * 1000 };
+	const char* const kSweepNames[] = { "1K", "64K", "1M", "10M" };
+	const int kSweepMax = 10 * 1000 * 1000;
+
+	// kSweepMax points for the size sweep; each case uses the first n.  The
+	// buffers (about 240 MB per layout) are built on a case's first call, so
+	// they are only allocated when a sweep case runs.
+	struct StreamData
+	{
+		Matrix mat;
+		std::vector<Vector3> in, out;
+		std::vector<float> x, y, z, ox, oy, oz;
+
+		void PrepareArray()
+		{
+			if (!in.empty())
+				return;
+			unsigned s = 11;
+			in.resize(kSweepMax);
+			for (Vector3& v : in)
+				v = Vector3(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+			out.resize(kSweepMax);
+		}
+
+		void PrepareSoA()
+		{
+			if (!x.empty())
+				return;
+			unsigned s = 11;
+			for (std::vector<float>* v : { &x, &y, &z, &ox, &oy, &oz })
+				v->resize(kSweepMax);
+			for (int i = 0; i < kSweepMax; ++i)
+			{
+				x[i] = RandF(s, -100.0f, 100.0f);
+				y[i] = RandF(s, -100.0f, 100.0f);
+				z[i] = RandF(s, -100.0f, 100.0f);
+			}
+		}
+	};
+
+	void RegisterSweep(Registry& r, const Matrix& mat)
+	{
+		auto d = std::make_shared<StreamData>();
+		d->mat = mat;
+		for (int k = 0; k < 4; ++k)
+		{
+			const int n = kSweepSizes[k];
+			const std::string size = std::string("/") + kSweepNames[k];
+
+			r.Add("Vector3/Transform" + size, n, [d, n](size_t calls)
+			{
+				d->PrepareArray();
+				for (size_t c = 0; c < calls; ++c)
+				{
+					for (int i = 0; i < n; ++i)
+						d->out[i].Transform(d->in[i], d->mat);
+					DoNotOptimize(d->out[0]);
+				}
+			});
+
+			r.Add("Vector3/TransformArray" + size, n, [d, n](size_t calls)
+			{
+				d->PrepareArray();
+				for (size_t c = 0; c < calls; ++c)
+				{
+					Vector3::TransformArray(d->out.data(), d->in.data(), n, d->mat);
+					DoNotOptimize(d->out[0]);
+				}
+			});
+
+			r.Add("Vector3/TransformCoordArray" + size, n, [d, n](size_t calls)
+			{
+				d->PrepareArray();
+				for (size_t c = 0; c < calls; ++c)
+				{
+					Vector3::TransformCoordArray(d->out.data(), d->in.data(), n, d->mat);
+					DoNotOptimize(d->out[0]);
+				}
+			});
+
+			r.Add("Vector3/TransformSoA" + size, n, [d, n](size_t calls)
+			{
+				d->PrepareSoA();
+				for (size_t c = 0; c < calls; ++c)
+				{
+					Vector3::TransformSoA(d->ox.data(), d->oy.data(), d->oz.data(),
+						d->x.data(), d->y.data(), d->z.data(), n, d->mat);
+					DoNotOptimize(d->ox[0]);
+				}
+			});
+
+			r.Add("Vector3/TransformCoordSoA" + size, n, [d, n](size_t calls)
+			{
+				d->PrepareSoA();
+				for (size_t c = 0; c < calls; ++c)
+				{
+					Vector3::TransformCoordSoA(d->ox.data(), d->oy.data(), d->oz.data(),
+						d->x.data(), d->y.data(), d->z.data(), n, d->mat);
+					DoNotOptimize(d->ox[0]);
+				}
+			});
+		}
+	}
+}
+
+void bench::RegisterVector3(Registry& r)
+{
+	auto d = std::make_shared<Vector3Data>();
+	unsigned s = 7;
+	Vector3 T(1.0f, -2.0f, 3.0f), R(0.3f, 1.1f, -0.7f), S(1.5f, 1.5f, 1.5f);
+	d->mat.identity();
+	d->mat.TRS(T, R, S);
+	for (int i = 0; i < kBatch; ++i)
+	{
+		Vector3 v(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+		d->in.push_back(v);
+		d->x.push_back(v.x);
+		d->y.push_back(v.y);
+		d->z.push_back(v.z);
+	}
+	d->out.resize(kBatch);
+	d->ox.resize(kBatch);
+	d->oy.resize(kBatch);
+	d->oz.resize(kBatch);
+
+	r.Add("Vector3/Transform", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i].Transform(d->in[i], d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/TransformCoord", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i].TransformCoord(d->in[i], d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/Transform3x3", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i].Transform3x3(d->in[i], d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/TransformArray", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Vector3::TransformArray(d->out.data(), d->in.data(), kBatch, d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/TransformCoordArray", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Vector3::TransformCoordArray(d->out.data(), d->in.data(), kBatch, d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/Transform3x3Array", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Vector3::Transform3x3Array(d->out.data(), d->in.data(), kBatch, d->mat);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/TransformSoA", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Vector3::TransformSoA(d->ox.data(), d->oy.data(), d->oz.data(),
+				d->x.data(), d->y.data(), d->z.data(), kBatch, d->mat);
+			DoNotOptimize(d->ox[0]);
+		}
+	});
+
+	r.Add("Vector3/TransformCoordSoA", kBatch, [d](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			Vector3::TransformCoordSoA(d->ox.data(), d->oy.data(), d->oz.data(),
+				d->x.data(), d->y.data(), d->z.data(), kBatch, d->mat);
+			DoNotOptimize(d->ox[0]);
+		}
+	});
+
+	r.Add("Vector3/value_lerp", kBatch, [d](size_t calls)
+	{
+		const float t = 0.25f;
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i] = d->in[i] * (1.0f - t) + d->in[kBatch - 1 - i] * t;
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	r.Add("Vector3/expr_lerp", kBatch, [d](size_t calls)
+	{
+		const float t = 0.25f;
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int i = 0; i < kBatch; ++i)
+				d->out[i] = expr::lerp(d->in[i], d->in[kBatch - 1 - i], t);
+			DoNotOptimize(d->out[0]);
+		}
+	});
+
+	RegisterSweep(r, d->mat);
+}
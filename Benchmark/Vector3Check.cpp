@@ -0,0 +1,148 @@
+//***************************************************************************************
+// Vector3Check.cpp
+//
+// The Vector3 batch transforms (TransformArray, TransformCoordArray,
+// Transform3x3Array and their SoA versions) against Transform,
+// TransformCoord and Transform3x3 on each point.  They keep the single-point
+// operation order, so every point must match bit for bit.  The exception
+// is the Coord variants on ARMv7 NEON, whose divide is a refined estimate
+// (see simd::div).
+//
+// Lengths run from 0 to 17, plus 1001, so the scalar tail after the 4-wide
+// kernel runs with every remainder.  Arrays start one float into their
+// allocation, and every transform is also run in place.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "Check.h"
+#include "../Math/Matrix.h"
+#include "../Math/Simd.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+#if defined(MATH_SIMD_NEON) && !defined(__aarch64__) && !defined(_M_ARM64)
+	const double CoordUlps = 4.0;
+#else
+	const double CoordUlps = 0.0;
+#endif
+
+	const int Lengths[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 1001 };
+
+	enum Mode { Point, Coord, Normal, ModeCount };
+	const char* const ArrayNames[ModeCount] = { "TransformArray", "TransformCoordArray", "Transform3x3Array" };
+	const char* const SoANames[ModeCount] = { "TransformSoA", "TransformCoordSoA", "Transform3x3SoA" };
+	const double Limits[ModeCount] = { 0.0, CoordUlps, 0.0 };
+
+	void TransformOne(Vector3& out, const Vector3& in, const Matrix& m, Mode mode)
+	{
+		if (mode == Point) out.Transform(in, m);
+		else if (mode == Coord) out.TransformCoord(in, m);
+		else out.Transform3x3(in, m);
+	}
+
+	void TransformArray(Vector3* out, const Vector3* in, int count, const Matrix& m, Mode mode)
+	{
+		if (mode == Point) Vector3::TransformArray(out, in, count, m);
+		else if (mode == Coord) Vector3::TransformCoordArray(out, in, count, m);
+		else Vector3::Transform3x3Array(out, in, count, m);
+	}
+
+	void TransformSoA(float* ox, float* oy, float* oz, const float* x, const float* y, const float* z,
+		int count, const Matrix& m, Mode mode)
+	{
+		if (mode == Point) Vector3::TransformSoA(ox, oy, oz, x, y, z, count, m);
+		else if (mode == Coord) Vector3::TransformCoordSoA(ox, oy, oz, x, y, z, count, m);
+		else Vector3::Transform3x3SoA(ox, oy, oz, x, y, z, count, m);
+	}
+
+	uint32_t Ulps(const Vector3& a, const Vector3& b)
+	{
+		return std::max(check::UlpDistance(a.x, b.x),
+			std::max(check::UlpDistance(a.y, b.y), check::UlpDistance(a.z, b.z)));
+	}
+
+	// Worst ULP distance from the single-point results, over the Array and
+	// SoA versions, out of place and in place.
+	void Measure(const Matrix& m, Mode mode, unsigned& s, uint32_t& worstArray, uint32_t& worstSoA)
+	{
+		for (int count : Lengths)
+		{
+			// One float of offset, so the data does not start 16-byte aligned.
+			std::vector<float> storage(1 + 3 * count + 1);
+			Vector3* in = reinterpret_cast<Vector3*>(&storage[1]);
+			std::vector<Vector3> expected(count);
+			for (int i = 0; i < count; ++i)
+			{
+				in[i] = Vector3(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+				TransformOne(expected[i], in[i], m, mode);
+			}
+
+			std::vector<Vector3> out(count);
+			TransformArray(out.data(), in, count, m, mode);
+			for (int i = 0; i < count; ++i)
+				worstArray = std::max(worstArray, Ulps(out[i], expected[i]));
+			TransformArray(in, in, count, m, mode);
+			for (int i = 0; i < count; ++i)
+				worstArray = std::max(worstArray, Ulps(in[i], expected[i]));
+
+			std::vector<float> soa(1 + 6 * count);
+			float* x = &soa[1];
+			float* y = x + count;
+			float* z = y + count;
+			float* ox = z + count;
+			float* oy = ox + count;
+			float* oz = oy + count;
+			std::vector<Vector3> points(count);
+			for (int i = 0; i < count; ++i)
+			{
+				points[i] = Vector3(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+				x[i] = points[i].x;	y[i] = points[i].y;	z[i] = points[i].z;
+				TransformOne(expected[i], points[i], m, mode);
+			}
+			TransformSoA(ox, oy, oz, x, y, z, count, m, mode);
+			for (int i = 0; i < count; ++i)
+				worstSoA = std::max(worstSoA, Ulps(Vector3(ox[i], oy[i], oz[i]), expected[i]));
+			TransformSoA(x, y, z, x, y, z, count, m, mode);
+			for (int i = 0; i < count; ++i)
+				worstSoA = std::max(worstSoA, Ulps(Vector3(x[i], y[i], z[i]), expected[i]));
+		}
+	}
+}
+
+int main()
+{
+	unsigned s = 41;
+	std::vector<Matrix> matrices;
+	for (int i = 0; i < 8; ++i)
+	{
+		Vector3 T(RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f), RandF(s, -100.0f, 100.0f));
+		Vector3 R(RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f), RandF(s, -3.0f, 3.0f));
+		Vector3 S(RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f), RandF(s, 0.5f, 2.0f));
+		Matrix trs;
+		trs.identity();
+		trs.TRS(T, R, S);
+		matrices.push_back(trs);
+
+		// A projection, so the Coord divide is by something other than 1.
+		Matrix view = trs, projection, viewProjection;
+		projection.PerspectiveFov(RandF(s, 0.5f, 1.5f), RandF(s, 0.5f, 2.0f), 0.1f, 1000.0f);
+		viewProjection.multiply(view, projection);
+		matrices.push_back(viewProjection);
+	}
+
+	printf("%s batch transforms against the single-point ones, error in ULPs\n", MATH_SIMD_BACKEND_NAME);
+	for (int mode = 0; mode < ModeCount; ++mode)
+	{
+		uint32_t worstArray = 0, worstSoA = 0;
+		for (const Matrix& m : matrices)
+			Measure(m, (Mode)mode, s, worstArray, worstSoA);
+		check::ExpectAtMost(ArrayNames[mode], worstArray, Limits[mode]);
+		check::ExpectAtMost(SoANames[mode], worstSoA, Limits[mode]);
+	}
+	return check::Result();
+}
@@ -0,0 +1,295 @@
+//***************************************************************************************
+// WavesBench.cpp
+//
+// DirectX12/Waves: one solver step (stencil plus normals) and a four-step
+// catch-up (Step(4), one tiled sweep) against four single steps, on square
+// grids from 256^2 to 4096^2, and the scaling of Step(4) on 2048^2 from one
+// thread to all hardware threads.  WaveWorld cases update a mixed scene of
+// grids in one pass against updating each grid on its own.  Cases report
+// the cost per grid cell per step, so ops/s is cell updates per second.
+// Ripple_2048 keeps one spot of a 2048^2 pond excited, so most tiles stay
+// settled, and gathers the dirty rectangles a vertex upload would copy.
+// Async_2048 is what a frame pays for a 2048^2 grid stepped by AsyncWaves:
+// starting the job and picking up the newest snapshot.  The _compact cases
+// repeat Step4 with Waves::Storage::Compact (half heights, packed normals).
+// Ocean cases evaluate the spectral ocean at a new time on 256^2 and 512^2
+// patches, and on 512^2 from one thread to all hardware threads.
+// Only one large grid is alive at a time; the 4096^2 grid needs about
+// 450 MB.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../DirectX12/AsyncWaves.h"
+#include "../DirectX12/Ocean.h"
+#include "../DirectX12/WaveWorld.h"
+#include "../Common/JobSystem.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+	const float kTimeStep = 0.03f;
+
+	// One lake, a few rivers and many small ponds.
+	const int kSceneGrids[][2] = { { 1024, 1024 }, { 64, 1024 }, { 64, 768 }, { 48, 512 },
+		{ 128, 128 }, { 128, 128 }, { 96, 96 }, { 96, 96 }, { 64, 64 }, { 64, 64 },
+		{ 64, 64 }, { 64, 64 }, { 32, 32 }, { 32, 32 }, { 32, 32 }, { 32, 32 } };
+	const int kSceneGridCount = sizeof(kSceneGrids) / sizeof(kSceneGrids[0]);
+
+	struct SceneData
+	{
+		WaveWorld world;
+		std::vector<std::unique_ptr<Waves>> separate;
+		int cells = 0;
+
+		SceneData()
+		{
+			for (int g = 0; g < kSceneGridCount; ++g)
+			{
+				int m = kSceneGrids[g][0], n = kSceneGrids[g][1];
+				world.Add(m, n, 1.0f, kTimeStep, 4.0f, 0.2f);
+				separate.emplace_back(new Waves(m, n, 1.0f, kTimeStep, 4.0f, 0.2f));
+				cells += m * n;
+			}
+		}
+
+		void Excite(Waves& w)
+		{
+			w.Disturb(w.RowCount() / 2, w.ColumnCount() / 2, 1.0f);
+		}
+	};
+
+	// A mostly calm pond and the upload bookkeeping for it.
+	struct RippleData
+	{
+		std::unique_ptr<Waves> waves;
+		std::vector<Waves::DirtyRect> rects;
+		std::uint64_t uploaded = 0;
+	};
+
+	// One ocean per size and thread count, built on first use.
+	struct OceanData
+	{
+		std::map<std::pair<int, int>, std::unique_ptr<Ocean>> oceans;
+
+		Ocean& Get(int n, int threads)
+		{
+			std::unique_ptr<Ocean>& o = oceans[std::make_pair(n, threads)];
+			if (!o)
+			{
+				Ocean::Settings settings;
+				settings.Size = n;
+				settings.PatchSize = (float)n;
+				o.reset(new Ocean(settings, Pool(threads)));
+			}
+			return *o;
+		}
+	};
+
+	// Grid shared by all sizes; rebuilt when a case with another size or
+	// storage runs.
+	struct WavesData
+	{
+		std::unique_ptr<Waves> waves;
+		int size = 0;
+		Waves::Storage storage = Waves::Storage::Full;
+		JobSystem* jobs = nullptr;
+
+		Waves& Get(int n, JobSystem& js = JobSystem::Default(), Waves::Storage st = Waves::Storage::Full)
+		{
+			if (size != n || storage != st)
+			{
+				waves.reset();
+				waves.reset(new Waves(n, n, 1.0f, kTimeStep, 4.0f, 0.2f, st));
+				size = n;
+				storage = st;
+				jobs = &JobSystem::Default();
+			}
+			if (jobs != &js)
+			{
+				waves->SetJobSystem(js);
+				jobs = &js;
+			}
+			return *waves;
+		}
+	};
+}
+
+void bench::RegisterWaves(Registry& r)
+{
+	auto d = std::make_shared<WavesData>();
+
+	for (int n = 256; n <= 4096; n *= 2)
+	{
+		r.Add("Waves/Update_" + std::to_string(n), n * n, [d, n](size_t calls)
+		{
+			Waves& w = d->Get(n);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				// Keep the field excited so heights do not decay to denormals.
+				w.Disturb(n / 2, n / 2, 1.0f);
+				w.Update(kTimeStep);
+				DoNotOptimize(w.Heights()[n * (n / 2) + n / 2]);
+			}
+		});
+
+		r.Add("Waves/Step4_" + std::to_string(n), n * n * 4, [d, n](size_t calls)
+		{
+			Waves& w = d->Get(n);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				w.Disturb(n / 2, n / 2, 1.0f);
+				w.Step(4);
+				DoNotOptimize(w.Heights()[n * (n / 2) + n / 2]);
+			}
+		});
+
+		r.Add("Waves/Step4_" + std::to_string(n) + "_compact", n * n * 4, [d, n](size_t calls)
+		{
+			Waves& w = d->Get(n, JobSystem::Default(), Waves::Storage::Compact);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				w.Disturb(n / 2, n / 2, 1.0f);
+				w.Step(4);
+				DoNotOptimize(w.Height(n * (n / 2) + n / 2));
+			}
+		});
+
+		r.Add("Waves/Step1x4_" + std::to_string(n), n * n * 4, [d, n](size_t calls)
+		{
+			Waves& w = d->Get(n);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				w.Disturb(n / 2, n / 2, 1.0f);
+				for (int k = 0; k < 4; ++k)
+					w.Step(1);
+				DoNotOptimize(w.Heights()[n * (n / 2) + n / 2]);
+			}
+		});
+	}
+
+	const int scaleSize = 2048;
+	for (int t : ThreadCounts())
+	{
+		r.Add("Waves/Step4_" + std::to_string(scaleSize) + "_t" + std::to_string(t), scaleSize * scaleSize * 4,
+			[d, t](size_t calls)
+		{
+			const int n = scaleSize;
+			Waves& w = d->Get(n, Pool(t));
+			for (size_t c = 0; c < calls; ++c)
+			{
+				w.Disturb(n / 2, n / 2, 1.0f);
+				w.Step(4);
+				DoNotOptimize(w.Heights()[n * (n / 2) + n / 2]);
+			}
+		});
+	}
+
+	auto ripple = std::make_shared<RippleData>();
+
+	r.Add("Waves/Ripple_2048", 2048 * 2048, [d, ripple](size_t calls)
+	{
+		const int n = 2048;
+		if (!ripple->waves)
+		{
+			// Its own grid, so the other cases' excitation does not leak in.
+			d->waves.reset();
+			d->size = 0;
+			ripple->waves.reset(new Waves(n, n, 1.0f, kTimeStep, 4.0f, 0.2f));
+		}
+
+		Waves& w = *ripple->waves;
+		for (size_t c = 0; c < calls; ++c)
+		{
+			w.Disturb(n / 3, n / 3, 1.0f);
+			w.Update(kTimeStep);
+
+			ripple->rects.clear();
+			DoNotOptimize(w.DirtyRects(ripple->uploaded, ripple->rects));
+			ripple->uploaded = w.Version();
+		}
+	});
+
+	auto async = std::make_shared<std::unique_ptr<AsyncWaves>>();
+
+	r.Add("Waves/Async_2048", 2048 * 2048, [d, ripple, async](size_t calls)
+	{
+		const int n = 2048;
+		if (!*async)
+		{
+			d->waves.reset();
+			d->size = 0;
+			ripple->waves.reset();
+			async->reset(new AsyncWaves(n, n, 1.0f, kTimeStep, 4.0f, 0.2f));
+		}
+
+		AsyncWaves& w = **async;
+		Waves::Disturbance splash = { n / 2.0f, n / 2.0f, 1.0f, 8.0f, Waves::Brush::Gaussian };
+		for (size_t c = 0; c < calls; ++c)
+		{
+			w.QueueDisturb(splash);
+			w.Update(kTimeStep);
+			DoNotOptimize(w.Acquire().Height(n * (n / 2) + n / 2));
+		}
+	});
+
+	auto ocean = std::make_shared<OceanData>();
+	int hw = ThreadCounts().back();
+	for (int n = 256; n <= 512; n *= 2)
+	{
+		r.Add("Ocean/Evaluate_" + std::to_string(n), n * n, [ocean, n, hw](size_t calls)
+		{
+			Ocean& o = ocean->Get(n, hw);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				o.Update(kTimeStep);
+				DoNotOptimize(o.Foam(0));
+			}
+		});
+	}
+
+	for (int t : ThreadCounts())
+	{
+		r.Add("Ocean/Evaluate_512_t" + std::to_string(t), 512 * 512, [ocean, t](size_t calls)
+		{
+			Ocean& o = ocean->Get(512, t);
+			for (size_t c = 0; c < calls; ++c)
+			{
+				o.Update(kTimeStep);
+				DoNotOptimize(o.Foam(0));
+			}
+		});
+	}
+
+	auto scene = std::make_shared<SceneData>();
+
+	r.Add("Waves/WaveWorld_scene", scene->cells, [scene](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (int g = 0; g < kSceneGridCount; ++g)
+				scene->Excite(scene->world.Get(g));
+			scene->world.Update(kTimeStep);
+			DoNotOptimize(scene->world.Get(0).Heights()[0]);
+		}
+	});
+
+	r.Add("Waves/Separate_scene", scene->cells, [scene](size_t calls)
+	{
+		for (size_t c = 0; c < calls; ++c)
+		{
+			for (auto& w : scene->separate)
+			{
+				scene->Excite(*w);
+				w->Update(kTimeStep);
+			}
+			DoNotOptimize(scene->separate[0]->Heights()[0]);
+		}
+	});
+}
@@ -0,0 +1,507 @@
+//***************************************************************************************
+// WavesHarness.cpp
+//
+// Headless run of DirectX12/Waves: steps square grids through a scripted
+// series of disturbances and reports throughput and a checksum of the final
+// height field.  A solver change that is meant to be exact must reproduce
+// the checksum of the reference build for the same arguments; one that is
+// not can be judged by the RMS and peak height it reports next to it.
+//
+//   waves_bench [--size <n,...>] [--threads <n,...>] [--steps <n>]
+//               [--batch <n>] [--storage full|compact] [--compare]
+//               [--settle <eps>] [--script <file>] [--expect <checksum>]
+//               [--json <file|->]
+//
+// --batch is the step count of each Waves::Step() call (the catch-up a slow
+// frame makes).  --settle defaults to the Waves default; 0 solves every
+// cell that is not exactly flat.
+//
+// --compare runs every size with both storages, instead of --storage, and
+// reports how far the Compact solution ends up from the Full one: the RMS
+// height error and the largest height error (as percentages of the Full
+// RMS and peak height), the change in peak height, and the mean and
+// largest angle between the normals.  --expect then applies to Full runs.
+//
+// A script has one disturbance per line, '#' starting a comment:
+//
+//   <step> <row> <col> <magnitude> [<radius> [cross|disk|gaussian]]
+//
+// row and col are fractions of the grid, so one script drives every size;
+// radius is in cells.  A disturbance is queued before the Step() call that
+// advances past its step, so with --batch > 1 it lands at the start of that
+// batch.  Without a script, a fixed pseudo-random one splashes every 25
+// steps.
+//
+// Bandwidth is modelled, not measured: every cell a sweep solves reads and
+// writes both height levels once, and the final sweep writes its normal.
+// Thread counts of one size must agree on the checksum; the run fails if
+// they do not, or if --expect does not match.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "../DirectX12/Waves.h"
+#include "../Common/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace bench;
+
+namespace
+{
+	const float kTimeStep = 0.03f;
+
+	struct Event
+	{
+		int step;
+		float row, col;			// fractions of the grid
+		float magnitude;
+		float radius;
+		Waves::Brush brush;
+	};
+
+	struct Options
+	{
+		std::vector<int> sizes = { 256, 1024, 2048 };
+		std::vector<int> threads;
+		int steps = 500;
+		int batch = 1;
+		Waves::Storage storage = Waves::Storage::Full;
+		bool compare = false;
+		float settle = -1.0f;		// < 0: Waves default
+		std::string scriptPath;
+		std::string expect;
+		std::string jsonPath;
+	};
+
+	struct RunResult
+	{
+		int size;
+		int threads;
+		Waves::Storage storage;
+		double seconds;
+		double stepsPerSec;
+		double cellsPerSec;
+		double bytesPerSec;
+		long long droppedEvents;
+		std::uint64_t checksum;
+		double rmsHeight;
+		double maxHeight;
+	};
+
+	// Final solution of a run, kept for --compare.
+	struct Solution
+	{
+		std::vector<float> heights;
+		std::vector<DirectX::XMFLOAT3> normals;
+	};
+
+	// Compact against Full, both final solutions of one size.
+	struct Comparison
+	{
+		int size;
+		double rmsError;		// % of the Full RMS height
+		double maxError;		// largest |dh|, % of the Full peak height
+		double peakChange;		// change in peak height, % of the Full peak
+		double meanAngle;		// degrees between normals
+		double maxAngle;
+	};
+
+	std::vector<int> ParseList(const char* s)
+	{
+		std::vector<int> v;
+		std::stringstream ss(s);
+		std::string item;
+		while (std::getline(ss, item, ','))
+		{
+			int x = atoi(item.c_str());
+			if (x > 0)
+				v.push_back(x);
+		}
+		return v;
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* a = argv[i];
+			bool hasValue = i + 1 < argc;
+			bool ok = true;
+			if (!strcmp(a, "--size") && hasValue)
+				ok = !(opt.sizes = ParseList(argv[++i])).empty();
+			else if (!strcmp(a, "--threads") && hasValue)
+				ok = !(opt.threads = ParseList(argv[++i])).empty();
+			else if (!strcmp(a, "--steps") && hasValue)
+				ok = (opt.steps = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--batch") && hasValue)
+				ok = (opt.batch = atoi(argv[++i])) > 0;
+			else if (!strcmp(a, "--storage") && hasValue)
+			{
+				const char* s = argv[++i];
+				ok = !strcmp(s, "full") || !strcmp(s, "compact");
+				opt.storage = !strcmp(s, "compact") ? Waves::Storage::Compact : Waves::Storage::Full;
+			}
+			else if (!strcmp(a, "--compare"))
+				opt.compare = true;
+			else if (!strcmp(a, "--settle") && hasValue)
+				ok = (opt.settle = (float)atof(argv[++i])) >= 0.0f;
+			else if (!strcmp(a, "--script") && hasValue)
+				opt.scriptPath = argv[++i];
+			else if (!strcmp(a, "--expect") && hasValue)
+				opt.expect = argv[++i];
+			else if (!strcmp(a, "--json") && hasValue)
+				opt.jsonPath = argv[++i];
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				fprintf(stderr, "usage: %s [--size <n,...>] [--threads <n,...>] [--steps <n>] "
+					"[--batch <n>] [--storage full|compact] [--compare] [--settle <eps>] [--script <file>] "
+					"[--expect <checksum>] [--json <file|->]\n", argv[0]);
+				return false;
+			}
+		}
+
+		if (opt.threads.empty())
+		{
+			int hw = std::max((int)std::thread::hardware_concurrency(), 1);
+			opt.threads.push_back(1);
+			if (hw > 1)
+				opt.threads.push_back(hw);
+		}
+		return true;
+	}
+
+	bool LoadScript(const std::string& path, std::vector<Event>& events)
+	{
+		FILE* f = fopen(path.c_str(), "r");
+		if (!f)
+		{
+			fprintf(stderr, "cannot read script %s\n", path.c_str());
+			return false;
+		}
+
+		char line[256];
+		int lineNo = 0;
+		bool ok = true;
+		while (ok && fgets(line, sizeof(line), f))
+		{
+			++lineNo;
+			if (char* hash = strchr(line, '#'))
+				*hash = '\0';
+
+			Event e = { 0, 0.0f, 0.0f, 0.0f, 0.0f, Waves::Brush::Cross };
+			char brush[16] = "cross";
+			int fields = sscanf(line, "%d %f %f %f %f %15s", &e.step, &e.row, &e.col, &e.magnitude, &e.radius, brush);
+			if (fields <= 0)
+				continue;
+
+			if (!strcmp(brush, "disk"))
+				e.brush = Waves::Brush::Disk;
+			else if (!strcmp(brush, "gaussian"))
+				e.brush = Waves::Brush::Gaussian;
+			else if (strcmp(brush, "cross"))
+				fields = 0;
+
+			if (fields < 4 || e.step < 0)
+			{
+				fprintf(stderr, "%s:%d: expected <step> <row> <col> <magnitude> [<radius> [cross|disk|gaussian]]\n",
+					path.c_str(), lineNo);
+				ok = false;
+			}
+			events.push_back(e);
+		}
+		fclose(f);
+
+		std::stable_sort(events.begin(), events.end(),
+			[](const Event& a, const Event& b) { return a.step < b.step; });
+		return ok;
+	}
+
+	// Every 25 steps a splash somewhere in the middle 80% of the grid,
+	// cycling through the brushes.
+	void DefaultScript(int steps, std::vector<Event>& events)
+	{
+		unsigned state = 12345u;
+		const Waves::Brush brushes[] = { Waves::Brush::Cross, Waves::Brush::Disk, Waves::Brush::Gaussian };
+		for (int s = 0, k = 0; s < steps; s += 25, ++k)
+		{
+			Event e;
+			e.step = s;
+			e.row = RandF(state, 0.1f, 0.9f);
+			e.col = RandF(state, 0.1f, 0.9f);
+			e.magnitude = RandF(state, 0.25f, 1.0f);
+			e.radius = RandF(state, 2.0f, 8.0f);
+			e.brush = brushes[k % 3];
+			events.push_back(e);
+		}
+	}
+
+	// FNV-1a over the bit patterns of the heights, row-major, with -0
+	// folded into +0.
+	std::uint64_t Checksum(const std::vector<float>& heights)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (float h : heights)
+		{
+			h += 0.0f;
+			std::uint32_t bits;
+			memcpy(&bits, &h, sizeof(bits));
+			for (int b = 0; b < 4; ++b)
+			{
+				hash ^= (bits >> (8 * b)) & 0xFF;
+				hash *= 1099511628211ull;
+			}
+		}
+		return hash;
+	}
+
+	RunResult Run(int n, int threads, Waves::Storage storage, const std::vector<Event>& events, const Options& opt,
+		Solution* solution = nullptr)
+	{
+		JobSystem jobs(threads - 1);	// the caller is the last thread
+		std::unique_ptr<Waves> waves(new Waves(n, n, 1.0f, kTimeStep, 4.0f, 0.2f, storage));
+		waves->SetJobSystem(jobs);
+		if (opt.settle >= 0.0f)
+			waves->SetSettleEpsilon(opt.settle);
+
+		const double heightBytes = storage == Waves::Storage::Compact ? 2.0 : 4.0;
+		const double normalBytes = storage == Waves::Storage::Compact ? 4.0 : 12.0;
+
+		RunResult r = {};
+		r.size = n;
+		r.threads = threads;
+		r.storage = storage;
+
+		double bytes = 0.0;
+		size_t next = 0;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int s = 0; s < opt.steps; s += opt.batch)
+		{
+			int count = std::min(opt.batch, opt.steps - s);
+			for (; next < events.size() && events[next].step < s + count; ++next)
+			{
+				const Event& e = events[next];
+				Waves::Disturbance d;
+				d.Row = e.row * (n - 1);
+				d.Col = e.col * (n - 1);
+				d.Magnitude = e.magnitude;
+				d.Radius = e.radius;
+				d.Kernel = e.brush;
+				if (!waves->QueueDisturb(d))
+					++r.droppedEvents;
+			}
+
+			waves->Step(count);
+
+			int sweeps = (count + Waves::MaxSubsteps - 1) / Waves::MaxSubsteps;
+			double solved = waves->LastStats().SolvedCells;
+			bytes += solved * (sweeps * 4.0 * heightBytes + normalBytes);
+		}
+		auto t1 = std::chrono::steady_clock::now();
+
+		r.seconds = std::chrono::duration<double>(t1 - t0).count();
+		double seconds = std::max(r.seconds, 1e-9);
+		r.stepsPerSec = opt.steps / seconds;
+		r.cellsPerSec = (double)n * n * opt.steps / seconds;
+		r.bytesPerSec = bytes / seconds;
+
+		std::vector<float> heights(n * n);
+		waves->CopyHeights(0, n * n, heights.data());
+		r.checksum = Checksum(heights);
+
+		double sumSq = 0.0;
+		for (float h : heights)
+		{
+			sumSq += (double)h * h;
+			r.maxHeight = std::max(r.maxHeight, (double)fabsf(h));
+		}
+		r.rmsHeight = sqrt(sumSq / heights.size());
+
+		if (solution)
+		{
+			solution->normals.resize(n * n);
+			waves->CopyNormals(0, n * n, solution->normals.data());
+			solution->heights.swap(heights);
+		}
+		return r;
+	}
+
+	Comparison Compare(int n, const Solution& full, const Solution& compact)
+	{
+		double sumSq = 0.0, sumSqError = 0.0, maxError = 0.0, peakFull = 0.0, peakCompact = 0.0;
+		double sumAngle = 0.0, maxAngle = 0.0;
+		for (size_t i = 0; i < full.heights.size(); ++i)
+		{
+			double h = full.heights[i], dh = compact.heights[i] - h;
+			sumSq += h * h;
+			sumSqError += dh * dh;
+			maxError = std::max(maxError, fabs(dh));
+			peakFull = std::max(peakFull, fabs(h));
+			peakCompact = std::max(peakCompact, (double)fabsf(compact.heights[i]));
+
+			const DirectX::XMFLOAT3& a = full.normals[i];
+			const DirectX::XMFLOAT3& b = compact.normals[i];
+			double cx = (double)a.y*b.z - (double)a.z*b.y;
+			double cy = (double)a.z*b.x - (double)a.x*b.z;
+			double cz = (double)a.x*b.y - (double)a.y*b.x;
+			double dot = (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z;
+			double angle = atan2(sqrt(cx*cx + cy*cy + cz*cz), dot) * (180.0 / 3.14159265358979);
+			sumAngle += angle;
+			maxAngle = std::max(maxAngle, angle);
+		}
+
+		double rms = sqrt(sumSq / full.heights.size());
+		double rmsError = sqrt(sumSqError / full.heights.size());
+		Comparison c;
+		c.size = n;
+		c.rmsError = rms > 0.0 ? 100.0 * rmsError / rms : 0.0;
+		c.maxError = peakFull > 0.0 ? 100.0 * maxError / peakFull : 0.0;
+		c.peakChange = peakFull > 0.0 ? 100.0 * (peakCompact - peakFull) / peakFull : 0.0;
+		c.meanAngle = sumAngle / full.heights.size();
+		c.maxAngle = maxAngle;
+		return c;
+	}
+
+	const char* StorageName(Waves::Storage storage)
+	{
+		return storage == Waves::Storage::Compact ? "compact" : "full";
+	}
+
+	bool WriteJson(const std::string& path, const std::vector<RunResult>& results,
+		const std::vector<Comparison>& comparisons, const Options& opt)
+	{
+		FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+		if (!f)
+			return false;
+
+		fprintf(f, "{\n");
+		fprintf(f, "  \"steps\": %d,\n", opt.steps);
+		fprintf(f, "  \"batch\": %d,\n", opt.batch);
+		if (!opt.compare)
+			fprintf(f, "  \"storage\": \"%s\",\n", StorageName(opt.storage));
+		fprintf(f, "  \"script\": \"%s\",\n", opt.scriptPath.c_str());
+		fprintf(f, "  \"runs\": [\n");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const RunResult& r = results[i];
+			fprintf(f, "    {\"size\": %d, \"threads\": %d, \"storage\": \"%s\", \"seconds\": %.6f, "
+				"\"steps_per_sec\": %.3f, \"cells_per_sec\": %.1f, \"bytes_per_sec\": %.1f, \"dropped_events\": %lld, "
+				"\"checksum\": \"%016llx\", \"rms_height\": %.9g, \"max_height\": %.9g}%s\n",
+				r.size, r.threads, StorageName(r.storage), r.seconds, r.stepsPerSec, r.cellsPerSec, r.bytesPerSec, r.droppedEvents,
+				(unsigned long long)r.checksum, r.rmsHeight, r.maxHeight, i + 1 < results.size() ? "," : "");
+		}
+		fprintf(f, "  ]%s\n", opt.compare ? "," : "");
+		if (opt.compare)
+		{
+			fprintf(f, "  \"compact_vs_full\": [\n");
+			for (size_t i = 0; i < comparisons.size(); ++i)
+			{
+				const Comparison& c = comparisons[i];
+				fprintf(f, "    {\"size\": %d, \"rms_error_percent\": %.6g, \"max_error_percent\": %.6g, "
+					"\"peak_change_percent\": %.6g, \"mean_normal_degrees\": %.6g, \"max_normal_degrees\": %.6g}%s\n",
+					c.size, c.rmsError, c.maxError, c.peakChange, c.meanAngle, c.maxAngle,
+					i + 1 < comparisons.size() ? "," : "");
+			}
+			fprintf(f, "  ]\n");
+		}
+		fprintf(f, "}\n");
+
+		if (f != stdout)
+			fclose(f);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+		return 2;
+
+	std::vector<Event> events;
+	if (opt.scriptPath.empty())
+		DefaultScript(opt.steps, events);
+	else if (!LoadScript(opt.scriptPath, events))
+		return 2;
+
+	// Human-readable output goes to stderr when JSON is written to stdout.
+	FILE* log = opt.jsonPath == "-" ? stderr : stdout;
+
+	std::vector<Waves::Storage> storages(1, opt.storage);
+	if (opt.compare)
+		storages = { Waves::Storage::Full, Waves::Storage::Compact };
+
+	int status = 0;
+	std::vector<RunResult> results;
+	std::vector<Comparison> comparisons;
+	fprintf(log, "%6s %4s %-8s %10s %12s %14s %10s  %-16s %12s\n",
+		"size", "thr", "storage", "seconds", "steps/s", "cells/s", "GB/s", "checksum", "rms height");
+	for (int n : opt.sizes)
+	{
+		if (n < 3)
+			continue;
+
+		Solution solutions[2];
+		for (size_t k = 0; k < storages.size(); ++k)
+		{
+			std::uint64_t first = 0;
+			for (size_t t = 0; t < opt.threads.size(); ++t)
+			{
+				RunResult r = Run(n, opt.threads[t], storages[k], events, opt,
+					opt.compare && t == 0 ? &solutions[k] : nullptr);
+				fprintf(log, "%6d %4d %-8s %10.3f %12.1f %14.4g %10.2f  %016llx %12.6g\n",
+					r.size, r.threads, StorageName(r.storage), r.seconds, r.stepsPerSec, r.cellsPerSec,
+					r.bytesPerSec * 1e-9, (unsigned long long)r.checksum, r.rmsHeight);
+				if (r.droppedEvents > 0)
+					fprintf(log, "       %lld disturbances dropped: queue full\n", r.droppedEvents);
+				fflush(log);
+
+				char hex[17];
+				snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)r.checksum);
+				if (t == 0)
+					first = r.checksum;
+				else if (r.checksum != first)
+				{
+					fprintf(stderr, "size %d, %s: %d threads changed the checksum\n", n, StorageName(r.storage), r.threads);
+					status = 1;
+				}
+				if (!opt.expect.empty() && r.storage == opt.storage && opt.expect != hex)
+				{
+					fprintf(stderr, "size %d, %d threads: checksum %s, expected %s\n", n, r.threads, hex,
+						opt.expect.c_str());
+					status = 1;
+				}
+				results.push_back(r);
+			}
+		}
+
+		if (opt.compare)
+		{
+			Comparison c = Compare(n, solutions[0], solutions[1]);
+			fprintf(log, "%6d compact vs full: rms error %.3g%%, max error %.3g%% and peak change %+.3g%% of the peak, "
+				"normals %.3g deg mean, %.3g deg max\n",
+				n, c.rmsError, c.maxError, c.peakChange, c.meanAngle, c.maxAngle);
+			comparisons.push_back(c);
+		}
+	}
+
+	if (!opt.jsonPath.empty() && !WriteJson(opt.jsonPath, results, comparisons, opt))
+	{
+		fprintf(stderr, "cannot write %s\n", opt.jsonPath.c_str());
+		return 1;
+	}
+	return status;
+}
@@ -0,0 +1,245 @@
+//***************************************************************************************
+// JobSystem.cpp
+//***************************************************************************************
+
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+	// The job system and worker index of the calling thread, if it is a worker.
+	thread_local const JobSystem* tlsOwner = nullptr;
+	thread_local int tlsIndex = -1;
+}
+
+JobSystem::JobSystem(int threadCount)
+	: mQueued(0), mSleeping(0), mNextQueue(0), mStop(false)
+{
+	if (threadCount < 0)
+		threadCount = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+
+	// Without workers, jobs still need a queue for the waiting caller to
+	// drain.
+	int queueCount = std::max(threadCount, 1);
+	for (int i = 0; i < queueCount; ++i)
+		mQueues.emplace_back(new Queue());
+
+	for (int i = 0; i < threadCount; ++i)
+		mThreads.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepLock);
+		mStop = true;
+	}
+	mWake.notify_all();
+
+	for (auto& t : mThreads)
+		t.join();
+}
+
+JobSystem& JobSystem::Default()
+{
+	static JobSystem jobs;
+	return jobs;
+}
+
+int JobSystem::Concurrency()const
+{
+	return (int)mThreads.size() + 1;
+}
+
+int JobSystem::WorkerIndex()const
+{
+	return tlsOwner == this ? tlsIndex : -1;
+}
+
+void JobSystem::Push(int worker, Job fn, std::atomic<int>* pending)
+{
+	int queueCount = (int)mQueues.size();
+	if (worker < 0)
+		worker = WorkerIndex();
+	if (worker < 0)
+		worker = (int)(mNextQueue.fetch_add(1, std::memory_order_relaxed) % queueCount);
+
+	Queue& q = *mQueues[worker % queueCount];
+	{
+		std::lock_guard<std::mutex> lock(q.Lock);
+		Task t = { std::move(fn), pending };
+		q.Tasks.push_back(std::move(t));
+	}
+
+	// Either a sleeping worker sees mQueued > 0 before it sleeps, or we see
+	// it counted in mSleeping and wake it.
+	mQueued.fetch_add(1);
+	if (mSleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(mSleepLock);
+		mWake.notify_one();
+	}
+}
+
+bool JobSystem::RunOne(int self)
+{
+	int queueCount = (int)mQueues.size();
+	int start = self >= 0 ? self : 0;
+
+	Task task;
+	bool found = false;
+	for (int k = 0; k < queueCount && !found; ++k)
+	{
+		int index = (start + k) % queueCount;
+		Queue& q = *mQueues[index];
+		std::lock_guard<std::mutex> lock(q.Lock);
+		if (q.Tasks.empty())
+			continue;
+
+		// Own queue: newest first.  Others: steal the oldest.
+		if (index == self)
+		{
+			task = std::move(q.Tasks.back());
+			q.Tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(q.Tasks.front());
+			q.Tasks.pop_front();
+		}
+		found = true;
+	}
+
+	if (!found)
+		return false;
+
+	mQueued.fetch_sub(1);
+	task.Fn();
+	if (task.Pending)
+		task.Pending->fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void JobSystem::Wait(const std::atomic<int>& pending)
+{
+	int self = WorkerIndex();
+	while (pending.load(std::memory_order_acquire) > 0)
+	{
+		if (!RunOne(self))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerMain(int index)
+{
+	tlsOwner = this;
+	tlsIndex = index;
+
+	while (!mStop.load())
+	{
+		if (RunOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(mSleepLock);
+		mSleeping.fetch_add(1);
+		mWake.wait(lock, [this] { return mQueued.load() > 0 || mStop.load(); });
+		mSleeping.fetch_sub(1);
+	}
+}
+
+void JobSystem::Split(int begin, int end, int grain, const RangeBody& body, std::atomic<int>& pending)
+{
+	// Lazy binary splitting: queue the upper half, where an idle worker can
+	// steal it (and split it further), and keep going with the lower half.
+	// Work is only divided as finely as the load actually requires.
+	while (end - begin > grain)
+	{
+		int mid = begin + (end - begin) / 2;
+		pending.fetch_add(1, std::memory_order_relaxed);
+		Push(-1, [this, mid, end, grain, &body, &pending]()
+		{
+			Split(mid, end, grain, body, pending);
+		}, &pending);
+		end = mid;
+	}
+	body(begin, end);
+}
+
+void JobSystem::ParallelForRange(int begin, int end, const RangeBody& body, int grain)
+{
+	int count = end - begin;
+	if (count <= 0)
+		return;
+
+	// Around eight pieces per thread leaves room to balance uneven work.
+	if (grain <= 0)
+		grain = std::max(count / (Concurrency() * 8), 1);
+
+	if (mThreads.empty() || count <= grain)
+	{
+		body(begin, end);
+		return;
+	}
+
+	std::atomic<int> pending(0);
+	Split(begin, end, grain, body, pending);
+	Wait(pending);
+}
+
+void JobSystem::ParallelForRange(int begin, int end, const RangeBody& body, AffinityHint& hint)
+{
+	int count = end - begin;
+	if (count <= 0)
+		return;
+
+	if (mThreads.empty())
+	{
+		body(begin, end);
+		return;
+	}
+
+	int chunks = std::min(Concurrency(), count);
+	if (hint.mBegin != begin || hint.mEnd != end || (int)hint.mWorker.size() != chunks)
+	{
+		hint.mBegin = begin;
+		hint.mEnd = end;
+		hint.mWorker.assign(chunks, -1);
+	}
+
+	std::atomic<int> pending(chunks);
+	for (int c = 0; c < chunks; ++c)
+	{
+		int first = begin + (int)((long long)count * c / chunks);
+		int last = begin + (int)((long long)count * (c + 1) / chunks);
+		int* owner = &hint.mWorker[c];
+
+		// Chunks without a history start on worker c.
+		Push(*owner >= 0 ? *owner : c, [this, first, last, owner, &body]()
+		{
+			*owner = WorkerIndex();
+			body(first, last);
+		}, &pending);
+	}
+	Wait(pending);
+}
+
+TaskGroup::TaskGroup(JobSystem& jobs)
+	: mJobs(jobs), mPending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	Wait();
+}
+
+void TaskGroup::Run(JobSystem::Job job, int worker)
+{
+	mPending.fetch_add(1, std::memory_order_relaxed);
+	mJobs.Push(worker, std::move(job), &mPending);
+}
+
+void TaskGroup::Wait()
+{
+	mJobs.Wait(mPending);
+}
@@ -0,0 +1,151 @@
+//***************************************************************************************
+// JobSystem.h
+//
+// Small portable work-stealing job system.  Each worker thread owns a queue:
+// it pushes and pops its own jobs at the back (LIFO, cache-warm) while idle
+// workers steal from the front (FIFO, the largest pieces of a split range).
+// A thread waiting on a TaskGroup or ParallelFor runs queued jobs instead of
+// blocking, so nested parallelism does not deadlock.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Remembers which worker ran each chunk of a ParallelForRange so the next
+// call over the same range sends every chunk back to the same worker,
+// whose cache likely still holds its data.  Chunks are still stolen when
+// their worker is busy.
+class AffinityHint
+{
+private:
+	friend class JobSystem;
+
+	int mBegin = 0;
+	int mEnd = 0;
+	std::vector<int> mWorker;
+};
+
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+	typedef std::function<void(int first, int last)> RangeBody;
+
+	// threadCount worker threads; -1 uses one per hardware thread, minus the
+	// caller, which works while it waits.  0 runs everything on the caller.
+	explicit JobSystem(int threadCount = -1);
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+	~JobSystem();
+
+	// Shared instance used by default.
+	static JobSystem& Default();
+
+	// Threads that execute jobs: the workers plus a waiting caller.
+	int Concurrency()const;
+
+	// Index of the calling worker thread, or -1 for any other thread.
+	int WorkerIndex()const;
+
+	// Calls body(first, last) over [begin, end) in parallel.  Ranges are
+	// split lazily in halves down to 'grain' items; grain <= 0 picks one
+	// from the range size and Concurrency().
+	void ParallelForRange(int begin, int end, const RangeBody& body, int grain = 0);
+
+	// Splits [begin, end) into Concurrency() fixed chunks and prefers to
+	// run each one on the worker that ran it in the previous call with the
+	// same hint and range.
+	void ParallelForRange(int begin, int end, const RangeBody& body, AffinityHint& hint);
+
+	// Calls body(i) for every i in [begin, end).
+	template<typename Body>
+	void ParallelFor(int begin, int end, const Body& body, int grain = 0)
+	{
+		ParallelForRange(begin, end, [&body](int first, int last)
+		{
+			for (int i = first; i < last; ++i)
+				body(i);
+		}, grain);
+	}
+
+	template<typename Body>
+	void ParallelFor(int begin, int end, const Body& body, AffinityHint& hint)
+	{
+		ParallelForRange(begin, end, [&body](int first, int last)
+		{
+			for (int i = first; i < last; ++i)
+				body(i);
+		}, hint);
+	}
+
+private:
+	friend class TaskGroup;
+
+	struct Task
+	{
+		Job Fn;
+		std::atomic<int>* Pending;
+	};
+
+	struct Queue
+	{
+		std::mutex Lock;
+		std::deque<Task> Tasks;
+	};
+
+	// Queues fn; worker < 0 means the calling worker's queue (or the next
+	// one round-robin from other threads).  pending is decremented once fn
+	// has run.
+	void Push(int worker, Job fn, std::atomic<int>* pending);
+
+	// Runs one queued job, preferring the caller's own queue.
+	bool RunOne(int self);
+
+	// Runs jobs until pending reaches zero.
+	void Wait(const std::atomic<int>& pending);
+
+	void Split(int begin, int end, int grain, const RangeBody& body, std::atomic<int>& pending);
+	void WorkerMain(int index);
+
+private:
+	std::vector<std::unique_ptr<Queue>> mQueues;	// one per worker, plus one when there are none
+	std::vector<std::thread> mThreads;
+
+	std::atomic<int> mQueued;
+	std::atomic<int> mSleeping;
+	std::atomic<unsigned> mNextQueue;
+	std::atomic<bool> mStop;
+	std::mutex mSleepLock;
+	std::condition_variable mWake;
+};
+
+// A set of jobs that can be waited on together.  Wait() runs queued jobs
+// while it waits; the destructor waits too.
+class TaskGroup
+{
+public:
+	explicit TaskGroup(JobSystem& jobs = JobSystem::Default());
+	TaskGroup(const TaskGroup& rhs) = delete;
+	TaskGroup& operator=(const TaskGroup& rhs) = delete;
+	~TaskGroup();
+
+	// worker >= 0 is an affinity hint: the job goes to that worker's queue
+	// (modulo the worker count), where it can still be stolen.
+	void Run(JobSystem::Job job, int worker = -1);
+
+	void Wait();
+
+private:
+	JobSystem& mJobs;
+	std::atomic<int> mPending;
+};
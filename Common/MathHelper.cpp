@@ -35,48 +35,18 @@ float MathHelper::AngleFromXY(float x, float y)
 
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
-
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
-	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
-
-		return XMVector3Normalize(v);
-	}
+	XMFLOAT3 v;
+	Random::ThreadLocal().NextUnitVec3(&v.x);
+	return XMLoadFloat3(&v);
 }
 
 XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	// A uniform direction reflected into the hemisphere about n is still
+	// uniform over that hemisphere, without rejection sampling.
+	XMVECTOR v = RandUnitVec3();
+	if( XMVector3Less( XMVector3Dot(n, v), XMVectorZero() ) )
+		v = XMVectorNegate(v);
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
-	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
-
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-		
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
-
-		// Ignore points in the bottom hemisphere.
-		if( XMVector3Less( XMVector3Dot(n, v), Zero ) )
-			continue;
-
-		return XMVector3Normalize(v);
-	}
-}
\ No newline at end of file
+	return v;
+}
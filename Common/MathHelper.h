@@ -6,17 +6,25 @@
 
 #pragma once
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 #include <DirectXMath.h>
 #include <cstdint>
+#include <cstdlib>
+#include "Random.h"
 
 class MathHelper
 {
 public:
+	// The Rand* helpers draw from the calling thread's Random stream, so they
+	// are safe to call from worker threads.  Random::SetGlobalSeed makes
+	// them reproducible.
+
 	// Returns random float in [0, 1).
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return Random::ThreadLocal().NextFloat();
 	}
 
 	// Returns random float in [a, b).
@@ -25,9 +33,10 @@ public:
 		return a + RandF()*(b-a);
 	}
 
+	// Returns random int in [a, b].
     static int Rand(int a, int b)
     {
-        return a + rand() % ((b - a) + 1);
+        return Random::ThreadLocal().NextInt(a, b);
     }
 
 	template<typename T>
@@ -78,6 +87,41 @@ public:
         return DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(&det, A));
 	}
 
+    // Inverse of an affine matrix (last column 0,0,0,1), e.g. a world or view
+    // matrix.  Inverts only the upper 3x3 by cross products and folds the
+    // translation back in, which is much cheaper than XMMatrixInverse.
+    static DirectX::XMMATRIX AffineInverse(DirectX::FXMMATRIX M)
+    {
+        DirectX::XMVECTOR c0 = DirectX::XMVector3Cross(M.r[1], M.r[2]);
+        DirectX::XMVECTOR c1 = DirectX::XMVector3Cross(M.r[2], M.r[0]);
+        DirectX::XMVECTOR c2 = DirectX::XMVector3Cross(M.r[0], M.r[1]);
+        DirectX::XMVECTOR invDet = DirectX::XMVectorReciprocal(DirectX::XMVector3Dot(M.r[0], c0));
+
+        DirectX::XMMATRIX A;
+        A.r[0] = DirectX::XMVectorMultiply(c0, invDet);
+        A.r[1] = DirectX::XMVectorMultiply(c1, invDet);
+        A.r[2] = DirectX::XMVectorMultiply(c2, invDet);
+        A.r[3] = DirectX::g_XMIdentityR3;
+        A = DirectX::XMMatrixTranspose(A);
+
+        A.r[3] = DirectX::XMVectorNegate(DirectX::XMVector3TransformNormal(M.r[3], A));
+        A.r[3] = DirectX::XMVectorSetW(A.r[3], 1.0f);
+        return A;
+    }
+
+    // Dual quaternion (real = rotation, dual = 0.5 * t * real) of the rigid
+    // part of M; any scale is dropped.
+    static void DualQuaternionFromMatrix(DirectX::FXMMATRIX M, DirectX::XMFLOAT4* real, DirectX::XMFLOAT4* dual)
+    {
+        DirectX::XMVECTOR S, Q, T;
+        DirectX::XMMatrixDecompose(&S, &Q, &T, M);
+        T = DirectX::XMVectorSetW(T, 0.0f);
+
+        // XMQuaternionMultiply(Q, T) is the product T * Q.
+        DirectX::XMStoreFloat4(real, Q);
+        DirectX::XMStoreFloat4(dual, DirectX::XMVectorScale(DirectX::XMQuaternionMultiply(Q, T), 0.5f));
+    }
+
     static DirectX::XMFLOAT4X4 Identity4x4()
     {
         static DirectX::XMFLOAT4X4 I(
@@ -0,0 +1,102 @@
+//***************************************************************************************
+// MpscQueue.h
+//
+// Bounded lock-free queue for many producer threads and one consumer
+// (Vyukov's bounded queue).  Every slot carries a sequence number that says
+// whether it is free for the producer that claimed its position or filled
+// for the consumer.  Producers claim positions with a compare-and-swap on
+// the tail and retry when another producer got there first, but never
+// block: no thread waits on a lock or on another thread finishing.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+template<typename T>
+class MpscQueue
+{
+public:
+	// capacity is rounded up to a power of two.
+	explicit MpscQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+
+		mMask = size - 1;
+		mSlots.reset(new Slot[size]);
+		for (size_t i = 0; i < size; ++i)
+			mSlots[i].Sequence.store(i, std::memory_order_relaxed);
+		mTail.store(0, std::memory_order_relaxed);
+		mHead = 0;
+	}
+
+	MpscQueue(const MpscQueue& rhs) = delete;
+	MpscQueue& operator=(const MpscQueue& rhs) = delete;
+
+	// Any thread.  Returns false, dropping value, when the queue is full.
+	bool Push(const T& value)
+	{
+		size_t pos = mTail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot& slot = mSlots[pos & mMask];
+			size_t seq = slot.Sequence.load(std::memory_order_acquire);
+			std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+			if (diff == 0)
+			{
+				// Free slot: claim its position, fill it, then publish it.
+				if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					slot.Value = value;
+					slot.Sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				// The consumer has not emptied this slot yet.
+				return false;
+			}
+			else
+			{
+				pos = mTail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Consumer thread only.  Returns false when no published item is left;
+	// an item still being written is picked up by a later call.
+	bool Pop(T& value)
+	{
+		Slot& slot = mSlots[mHead & mMask];
+		size_t seq = slot.Sequence.load(std::memory_order_acquire);
+		if (seq != mHead + 1)
+			return false;
+
+		value = slot.Value;
+		slot.Sequence.store(mHead + mMask + 1, std::memory_order_release);
+		++mHead;
+		return true;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> Sequence;
+		T Value;
+	};
+
+	std::unique_ptr<Slot[]> mSlots;
+	size_t mMask = 0;
+
+	// Producers and the consumer write different cache lines.
+	char mPad0[64];
+	std::atomic<size_t> mTail;
+	char mPad1[64];
+	size_t mHead;
+};
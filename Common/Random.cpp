@@ -0,0 +1,299 @@
+//***************************************************************************************
+// Random.cpp
+//***************************************************************************************
+
+#include "Random.h"
+#include <DirectXMath.h>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RANDOM_SSE2 1
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	const float TwoPi = 6.283185307f;
+
+	std::atomic<uint64_t> gGlobalSeed(Random::DefaultSeed);
+	std::atomic<uint64_t> gNextStream(0);
+	std::atomic<uint32_t> gSeedEpoch(0);
+
+	uint64_t SplitMix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	inline uint32_t Rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	inline float ToUnitFloat(uint32_t x)
+	{
+		// Top 24 bits -> [0, 1).
+		return (float)(x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	inline XMVECTOR LogE(FXMVECTOR v)
+	{
+#if DIRECTX_MATH_VERSION >= 314
+		return XMVectorMultiply(XMVectorLog2(v), XMVectorReplicate(0.693147181f));
+#else
+		return XMVectorMultiply(XMVectorLog(v), XMVectorReplicate(0.693147181f));
+#endif
+	}
+}
+
+Random::Random(uint64_t seed, uint64_t stream)
+{
+	Seed(seed, stream);
+}
+
+void Random::Seed(uint64_t seed, uint64_t stream)
+{
+	// SplitMix64 expands (seed, stream) into the 4x128-bit lane states, as
+	// recommended for the xoshiro family.
+	uint64_t x = seed ^ (0xD1B54A32D192ED03ull * (stream + 1));
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		uint64_t a = SplitMix64(x);
+		uint64_t b = SplitMix64(x);
+		mState[0][lane] = (uint32_t)a;
+		mState[1][lane] = (uint32_t)(a >> 32);
+		mState[2][lane] = (uint32_t)b;
+		mState[3][lane] = (uint32_t)(b >> 32);
+
+		// An all-zero state would be stuck at zero.
+		if ((a | b) == 0)
+			mState[0][lane] = 1;
+	}
+}
+
+uint32_t Random::NextU32()
+{
+	// xoshiro128** on lane 0.
+	uint32_t* s0 = &mState[0][0];
+	uint32_t* s1 = &mState[1][0];
+	uint32_t* s2 = &mState[2][0];
+	uint32_t* s3 = &mState[3][0];
+
+	uint32_t result = Rotl(*s1 * 5, 7) * 9;
+	uint32_t t = *s1 << 9;
+
+	*s2 ^= *s0;
+	*s3 ^= *s1;
+	*s1 ^= *s2;
+	*s0 ^= *s3;
+	*s2 ^= t;
+	*s3 = Rotl(*s3, 11);
+
+	return result;
+}
+
+float Random::NextFloat()
+{
+	return ToUnitFloat(NextU32());
+}
+
+float Random::NextFloat(float a, float b)
+{
+	return a + NextFloat()*(b - a);
+}
+
+int Random::NextInt(int a, int b)
+{
+	// Lemire's multiply-and-reject: unbiased for any range size.
+	uint32_t range = (uint32_t)((int64_t)b - (int64_t)a + 1);
+	if (range == 0)
+		return (int)NextU32();	// full 32-bit range
+
+	uint64_t m = (uint64_t)NextU32() * range;
+	uint32_t low = (uint32_t)m;
+	if (low < range)
+	{
+		uint32_t threshold = (0u - range) % range;
+		while (low < threshold)
+		{
+			m = (uint64_t)NextU32() * range;
+			low = (uint32_t)m;
+		}
+	}
+	return (int)((int64_t)a + (int64_t)(m >> 32));
+}
+
+float Random::NextNormal()
+{
+	float u1 = 1.0f - NextFloat();	// (0, 1]
+	float u2 = NextFloat();
+	return sqrtf(-2.0f * logf(u1)) * cosf(TwoPi * u2);
+}
+
+void Random::NextUnitVec3(float* xyz)
+{
+	float z = 1.0f - 2.0f * NextFloat();
+	float phi = TwoPi * NextFloat();
+	float r = sqrtf(fmaxf(0.0f, 1.0f - z*z));
+	xyz[0] = r * cosf(phi);
+	xyz[1] = r * sinf(phi);
+	xyz[2] = z;
+}
+
+void Random::Uniform4(float out[4])
+{
+	// xoshiro128+ on all four lanes; its low bits are weak, but only the
+	// top 24 are used.
+#if defined(RANDOM_SSE2)
+	__m128i s0 = _mm_load_si128((const __m128i*)mState[0]);
+	__m128i s1 = _mm_load_si128((const __m128i*)mState[1]);
+	__m128i s2 = _mm_load_si128((const __m128i*)mState[2]);
+	__m128i s3 = _mm_load_si128((const __m128i*)mState[3]);
+
+	__m128i result = _mm_add_epi32(s0, s3);
+	__m128i t = _mm_slli_epi32(s1, 9);
+
+	s2 = _mm_xor_si128(s2, s0);
+	s3 = _mm_xor_si128(s3, s1);
+	s1 = _mm_xor_si128(s1, s2);
+	s0 = _mm_xor_si128(s0, s3);
+	s2 = _mm_xor_si128(s2, t);
+	s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+	_mm_store_si128((__m128i*)mState[0], s0);
+	_mm_store_si128((__m128i*)mState[1], s1);
+	_mm_store_si128((__m128i*)mState[2], s2);
+	_mm_store_si128((__m128i*)mState[3], s3);
+
+	__m128 f = _mm_cvtepi32_ps(_mm_srli_epi32(result, 8));
+	_mm_storeu_ps(out, _mm_mul_ps(f, _mm_set1_ps(1.0f / 16777216.0f)));
+#else
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		uint32_t& s0 = mState[0][lane];
+		uint32_t& s1 = mState[1][lane];
+		uint32_t& s2 = mState[2][lane];
+		uint32_t& s3 = mState[3][lane];
+
+		uint32_t result = s0 + s3;
+		uint32_t t = s1 << 9;
+
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = Rotl(s3, 11);
+
+		out[lane] = ToUnitFloat(result);
+	}
+#endif
+}
+
+void Random::FillUniform(float* out, size_t count, float a, float b)
+{
+	XMVECTOR base = XMVectorReplicate(a);
+	XMVECTOR scale = XMVectorReplicate(b - a);
+
+	XMFLOAT4 u;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		Uniform4(&u.x);
+		XMStoreFloat4((XMFLOAT4*)(out + i), XMVectorMultiplyAdd(XMLoadFloat4(&u), scale, base));
+	}
+	if (i < count)
+	{
+		XMFLOAT4 r;
+		Uniform4(&u.x);
+		XMStoreFloat4(&r, XMVectorMultiplyAdd(XMLoadFloat4(&u), scale, base));
+		memcpy(out + i, &r, (count - i) * sizeof(float));
+	}
+}
+
+void Random::FillNormal(float* out, size_t count, float mean, float stddev)
+{
+	// Box-Muller on four pairs at a time: eight deviates per step.
+	XMVECTOR m = XMVectorReplicate(mean);
+	XMVECTOR sd = XMVectorReplicate(stddev);
+
+	size_t i = 0;
+	while (i < count)
+	{
+		XMFLOAT4 u1, u2;
+		Uniform4(&u1.x);
+		Uniform4(&u2.x);
+
+		XMVECTOR v1 = XMVectorSubtract(g_XMOne, XMLoadFloat4(&u1));	// (0, 1]
+		XMVECTOR r = XMVectorSqrt(XMVectorMultiply(XMVectorReplicate(-2.0f), LogE(v1)));
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, XMVectorScale(XMLoadFloat4(&u2), TwoPi));
+
+		XMFLOAT4 lo, hi;
+		XMStoreFloat4(&lo, XMVectorMultiplyAdd(XMVectorMultiply(r, c), sd, m));
+		XMStoreFloat4(&hi, XMVectorMultiplyAdd(XMVectorMultiply(r, s), sd, m));
+
+		size_t n = count - i < 8 ? count - i : 8;
+		const float* src[2] = { &lo.x, &hi.x };
+		for (size_t k = 0; k < n; ++k)
+			out[i + k] = src[k / 4][k % 4];
+		i += n;
+	}
+}
+
+void Random::FillUnitVec3(float* xyz, size_t count)
+{
+	// z uniform in [-1, 1] and a uniform azimuth give a uniform direction
+	// (Archimedes), with no rejection loop.
+	size_t i = 0;
+	while (i < count)
+	{
+		XMFLOAT4 u1, u2;
+		Uniform4(&u1.x);
+		Uniform4(&u2.x);
+
+		XMVECTOR z = XMVectorNegativeMultiplySubtract(XMVectorReplicate(2.0f), XMLoadFloat4(&u1), g_XMOne);
+		XMVECTOR r = XMVectorSqrt(XMVectorMax(g_XMZero, XMVectorNegativeMultiplySubtract(z, z, g_XMOne)));
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, XMVectorScale(XMLoadFloat4(&u2), TwoPi));
+
+		// Rows x, y, z -> one xyz per row.
+		XMMATRIX v = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(r, c), XMVectorMultiply(r, s), z, g_XMZero));
+
+		size_t n = count - i < 4 ? count - i : 4;
+		for (size_t k = 0; k < n; ++k)
+			XMStoreFloat3((XMFLOAT3*)(xyz + (i + k) * 3), v.r[k]);
+		i += n;
+	}
+}
+
+Random& Random::ThreadLocal()
+{
+	struct Slot
+	{
+		Random Rng;
+		uint32_t Epoch = ~0u;
+	};
+	static thread_local Slot slot;
+
+	uint32_t epoch = gSeedEpoch.load(std::memory_order_acquire);
+	if (slot.Epoch != epoch)
+	{
+		slot.Rng.Seed(gGlobalSeed.load(std::memory_order_relaxed), gNextStream.fetch_add(1));
+		slot.Epoch = epoch;
+	}
+	return slot.Rng;
+}
+
+void Random::SetGlobalSeed(uint64_t seed)
+{
+	gGlobalSeed.store(seed, std::memory_order_relaxed);
+	gNextStream.store(0, std::memory_order_relaxed);
+	gSeedEpoch.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,64 @@
+//***************************************************************************************
+// Random.h
+//
+// xoshiro128+ / xoshiro128** generator with four interleaved lanes, so bulk
+// fills produce four values per step with SSE2.  Every instance is an
+// independent, deterministic stream: Random(seed, stream) always yields the
+// same sequence, and different streams do not overlap in practice.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Random
+{
+public:
+	explicit Random(uint64_t seed = DefaultSeed, uint64_t stream = 0);
+
+	void Seed(uint64_t seed, uint64_t stream = 0);
+
+	uint32_t NextU32();
+
+	// Uniform float in [0, 1) with 24 bits of precision.
+	float NextFloat();
+
+	// Uniform float in [a, b).
+	float NextFloat(float a, float b);
+
+	// Uniform int in [a, b], without modulo bias.
+	int NextInt(int a, int b);
+
+	// Standard normal deviate (Box-Muller).
+	float NextNormal();
+
+	// Uniformly distributed direction on the unit sphere.
+	void NextUnitVec3(float* xyz);
+
+	// Bulk fills, four values per step.  They draw from all four lanes,
+	// so the sequence differs from repeated single draws.
+	void FillUniform(float* out, size_t count, float a = 0.0f, float b = 1.0f);
+	void FillNormal(float* out, size_t count, float mean = 0.0f, float stddev = 1.0f);
+	void FillUnitVec3(float* xyz, size_t count);	// packed x,y,z triples
+
+	// Generator for the calling thread (used by MathHelper::RandF and co.).
+	// Threads get streams 0, 1, 2, ... of the global seed in the order they
+	// first draw; for results that do not depend on scheduling, give each
+	// task its own Random(seed, taskIndex) instead.
+	static Random& ThreadLocal();
+
+	// Reseeds every thread's ThreadLocal() generator (lazily, on its next
+	// draw) and restarts stream numbering.
+	static void SetGlobalSeed(uint64_t seed);
+
+	static const uint64_t DefaultSeed = 0x853C49E6748FEA9Bull;
+
+private:
+	// Advances all four lanes; out receives one xoshiro128+ value per lane,
+	// mapped to [0, 1).
+	void Uniform4(float out[4]);
+
+	// s[word][lane], laid out for 128-bit loads of one word across lanes.
+	alignas(16) uint32_t mState[4][4];
+};
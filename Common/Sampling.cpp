@@ -0,0 +1,285 @@
+//***************************************************************************************
+// Sampling.cpp
+//***************************************************************************************
+
+#include "Sampling.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const float TwoPi = 6.283185307f;
+	const float HalfPi = 1.570796327f;
+	const float QuarterPi = 0.785398163f;
+
+	uint32_t ReverseBits(uint32_t x)
+	{
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+		x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+		x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+		x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+		return x;
+	}
+
+	// Second Sobol dimension (Kollig and Keller), before scrambling.
+	uint32_t Sobol2(uint32_t n)
+	{
+		uint32_t r = 0;
+		for (uint32_t v = 1u << 31; n != 0; n >>= 1, v ^= v >> 1)
+		{
+			if (n & 1)
+				r ^= v;
+		}
+		return r;
+	}
+
+	// 32-bit fixed point -> [0, 1), keeping the top 24 bits so the result
+	// never rounds up to 1.
+	inline float ToUnitFloat(uint32_t x)
+	{
+		return (float)(x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Loads up to four points as u = (x0..x3), v = (y0..y3); missing lanes
+	// repeat the last point.
+	inline void Load4(const XMFLOAT2* in, uint32_t n, XMVECTOR& u, XMVECTOR& v)
+	{
+		XMFLOAT2 pad[4];
+		if (n < 4)
+		{
+			for (uint32_t k = 0; k < 4; ++k)
+				pad[k] = in[k < n ? k : n - 1];
+			in = pad;
+		}
+		XMVECTOR a = XMLoadFloat4((const XMFLOAT4*)&in[0]);
+		XMVECTOR b = XMLoadFloat4((const XMFLOAT4*)&in[2]);
+		u = XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Z, XM_PERMUTE_1X, XM_PERMUTE_1Z>(a, b);
+		v = XMVectorPermute<XM_PERMUTE_0Y, XM_PERMUTE_0W, XM_PERMUTE_1Y, XM_PERMUTE_1W>(a, b);
+	}
+
+	inline void Store3(XMFLOAT3* out, uint32_t n, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		XMMATRIX t = XMMatrixTranspose(XMMATRIX(x, y, z, g_XMZero));
+		for (uint32_t k = 0; k < n; ++k)
+			XMStoreFloat3(&out[k], t.r[k]);
+	}
+
+	inline void Store2(XMFLOAT2* out, uint32_t n, FXMVECTOR x, FXMVECTOR y)
+	{
+		XMFLOAT2 p[4];
+		XMStoreFloat4((XMFLOAT4*)&p[0], XMVectorMergeXY(x, y));
+		XMStoreFloat4((XMFLOAT4*)&p[2], XMVectorMergeZW(x, y));
+		memcpy(out, p, n * sizeof(XMFLOAT2));
+	}
+
+	// Shirley-Chiu concentric map of four points from [0, 1)^2 to the disk.
+	inline void Concentric4(FXMVECTOR u, FXMVECTOR v, XMVECTOR& x, XMVECTOR& y)
+	{
+		XMVECTOR two = XMVectorReplicate(2.0f);
+		XMVECTOR a = XMVectorMultiplyAdd(u, two, g_XMNegativeOne);
+		XMVECTOR b = XMVectorMultiplyAdd(v, two, g_XMNegativeOne);
+
+		// r is the larger coordinate, q the ratio of the smaller to it.
+		XMVECTOR useA = XMVectorGreater(XMVectorAbs(a), XMVectorAbs(b));
+		XMVECTOR r = XMVectorSelect(b, a, useA);
+		XMVECTOR o = XMVectorSelect(a, b, useA);
+		XMVECTOR q = XMVectorDivide(o, XMVectorSelect(r, g_XMOne, XMVectorEqual(r, g_XMZero)));
+
+		XMVECTOR quarterPi = XMVectorReplicate(QuarterPi);
+		XMVECTOR phi = XMVectorSelect(
+			XMVectorNegativeMultiplySubtract(q, quarterPi, XMVectorReplicate(HalfPi)),
+			XMVectorMultiply(q, quarterPi), useA);
+
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, phi);
+		x = XMVectorMultiply(r, c);
+		y = XMVectorMultiply(r, s);
+	}
+
+	// Point on the unit sphere with the given z and azimuth 2*pi*v.
+	inline void Azimuth4(FXMVECTOR z, FXMVECTOR v, XMVECTOR& x, XMVECTOR& y)
+	{
+		XMVECTOR r = XMVectorSqrt(XMVectorMax(g_XMZero, XMVectorNegativeMultiplySubtract(z, z, g_XMOne)));
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, XMVectorScale(v, TwoPi));
+		x = XMVectorMultiply(r, c);
+		y = XMVectorMultiply(r, s);
+	}
+}
+
+void Sampling::Random2D(XMFLOAT2* out, uint32_t count, Random& rng)
+{
+	rng.FillUniform(&out[0].x, (size_t)count * 2);
+}
+
+void Sampling::Stratified2D(XMFLOAT2* out, uint32_t nx, uint32_t ny, Random& rng)
+{
+	rng.FillUniform(&out[0].x, (size_t)nx * ny * 2);
+
+	float invX = 1.0f / nx;
+	float invY = 1.0f / ny;
+	for (uint32_t j = 0; j < ny; ++j)
+	{
+		for (uint32_t i = 0; i < nx; ++i)
+		{
+			XMFLOAT2& p = out[j * nx + i];
+			p.x = (i + p.x) * invX;
+			p.y = (j + p.y) * invY;
+		}
+	}
+}
+
+void Sampling::Hammersley2D(XMFLOAT2* out, uint32_t count, uint32_t scramble)
+{
+	float inv = 1.0f / count;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		out[i].x = i * inv;
+		out[i].y = ToUnitFloat(ReverseBits(i) ^ scramble);
+	}
+}
+
+void Sampling::Sobol2D(XMFLOAT2* out, uint32_t count, uint32_t scrambleX, uint32_t scrambleY, uint32_t first)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t n = first + i;
+		out[i].x = ToUnitFloat(ReverseBits(n) ^ scrambleX);
+		out[i].y = ToUnitFloat(Sobol2(n) ^ scrambleY);
+	}
+}
+
+void Sampling::BlueNoise2D(XMFLOAT2* out, uint32_t count, Random& rng, uint32_t candidates)
+{
+	if (count == 0)
+		return;
+
+	out[0].x = rng.NextFloat();
+	out[0].y = rng.NextFloat();
+
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		// Keep the candidate farthest from its nearest existing point.
+		float bestDist = -1.0f;
+		for (uint32_t c = 0; c < candidates; ++c)
+		{
+			float x = rng.NextFloat();
+			float y = rng.NextFloat();
+
+			float nearest = FLT_MAX;
+			for (uint32_t j = 0; j < i && nearest > bestDist; ++j)
+			{
+				float dx = fabsf(x - out[j].x);
+				float dy = fabsf(y - out[j].y);
+				dx = fminf(dx, 1.0f - dx);
+				dy = fminf(dy, 1.0f - dy);
+				nearest = fminf(nearest, dx*dx + dy*dy);
+			}
+
+			if (nearest > bestDist)
+			{
+				bestDist = nearest;
+				out[i].x = x;
+				out[i].y = y;
+			}
+		}
+	}
+}
+
+void Sampling::ToSphere(XMFLOAT3* out, const XMFLOAT2* in, uint32_t count)
+{
+	// z uniform in [-1, 1] (Archimedes' hat-box theorem).
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		uint32_t n = count - i < 4 ? count - i : 4;
+		XMVECTOR u, v, x, y;
+		Load4(in + i, n, u, v);
+		XMVECTOR z = XMVectorNegativeMultiplySubtract(XMVectorReplicate(2.0f), u, g_XMOne);
+		Azimuth4(z, v, x, y);
+		Store3(out + i, n, x, y, z);
+	}
+}
+
+void Sampling::ToHemisphere(XMFLOAT3* out, const XMFLOAT2* in, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		uint32_t n = count - i < 4 ? count - i : 4;
+		XMVECTOR u, v, x, y;
+		Load4(in + i, n, u, v);
+		XMVECTOR z = XMVectorSubtract(g_XMOne, u);	// (0, 1]
+		Azimuth4(z, v, x, y);
+		Store3(out + i, n, x, y, z);
+	}
+}
+
+void Sampling::ToCosineHemisphere(XMFLOAT3* out, const XMFLOAT2* in, uint32_t count)
+{
+	// Malley's method: project disk samples up onto the hemisphere.
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		uint32_t n = count - i < 4 ? count - i : 4;
+		XMVECTOR u, v, x, y;
+		Load4(in + i, n, u, v);
+		Concentric4(u, v, x, y);
+		XMVECTOR r2 = XMVectorMultiplyAdd(x, x, XMVectorMultiply(y, y));
+		XMVECTOR z = XMVectorSqrt(XMVectorMax(g_XMZero, XMVectorSubtract(g_XMOne, r2)));
+		Store3(out + i, n, x, y, z);
+	}
+}
+
+void Sampling::ToDisk(XMFLOAT2* out, const XMFLOAT2* in, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		uint32_t n = count - i < 4 ? count - i : 4;
+		XMVECTOR u, v, x, y;
+		Load4(in + i, n, u, v);
+		Concentric4(u, v, x, y);
+		Store2(out + i, n, x, y);
+	}
+}
+
+void Sampling::OrientHemisphere(XMFLOAT3* v, uint32_t count, FXMVECTOR n)
+{
+	// Branchless orthonormal basis around n (Duff et al. 2017).
+	XMFLOAT3 N;
+	XMStoreFloat3(&N, n);
+	float sign = copysignf(1.0f, N.z);
+	float a = -1.0f / (sign + N.z);
+	float b = N.x * N.y * a;
+
+	XMMATRIX basis(
+		1.0f + sign * N.x * N.x * a, sign * b, -sign * N.x, 0.0f,
+		b, sign + N.y * N.y * a, -N.y, 0.0f,
+		N.x, N.y, N.z, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (uint32_t i = 0; i < count; ++i)
+		XMStoreFloat3(&v[i], XMVector3TransformNormal(XMLoadFloat3(&v[i]), basis));
+}
+
+void Sampling::SsaoKernel(XMFLOAT4* out, uint32_t count, Random& rng)
+{
+	uint32_t scrambleX = rng.NextU32();
+	uint32_t scrambleY = rng.NextU32();
+
+	const uint32_t chunk = 64;
+	XMFLOAT2 u[chunk];
+	XMFLOAT3 dir[chunk];
+	for (uint32_t i = 0; i < count; i += chunk)
+	{
+		uint32_t n = count - i < chunk ? count - i : chunk;
+		Sobol2D(u, n, scrambleX, scrambleY, i);
+		ToSphere(dir, u, n);
+		for (uint32_t k = 0; k < n; ++k)
+		{
+			float s = rng.NextFloat(0.25f, 1.0f);
+			out[i + k] = XMFLOAT4(dir[k].x * s, dir[k].y * s, dir[k].z * s, 0.0f);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// Sampling.h
+//
+// Batch sample generators.  Point sets are generated in the unit square and
+// then warped onto the target domain with area-preserving maps, so the
+// stratification of the 2D set carries over to the sphere, hemisphere or
+// disk.  All functions write to caller-allocated arrays and do not allocate
+// (except BlueNoise2D, which keeps no state but is O(count^2)).
+//
+// Typical use, e.g. an SSAO kernel or an emitter burst:
+//
+//   XMFLOAT2 u[64];
+//   XMFLOAT3 dirs[64];
+//   Sampling::Sobol2D(u, 64, rng.NextU32(), rng.NextU32());
+//   Sampling::ToHemisphere(dirs, u, 64);
+//   Sampling::OrientHemisphere(dirs, 64, normal);
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include "Random.h"
+
+class Sampling
+{
+public:
+	//
+	// Point sets in [0, 1)^2.
+	//
+
+	// Independent uniform points.
+	static void Random2D(DirectX::XMFLOAT2* out, uint32_t count, Random& rng);
+
+	// One jittered point per cell of an nx * ny grid (nx * ny points).
+	static void Stratified2D(DirectX::XMFLOAT2* out, uint32_t nx, uint32_t ny, Random& rng);
+
+	// Hammersley set (i / count, radical inverse of i).  The whole set is
+	// well distributed, prefixes are not; use Sobol2D for progressive use.
+	static void Hammersley2D(DirectX::XMFLOAT2* out, uint32_t count, uint32_t scramble = 0);
+
+	// Points first .. first + count - 1 of the 2D Sobol (0,2)-sequence.
+	// Every power-of-two prefix is stratified.  The scrambles are XORed into
+	// each dimension (random digit scrambling); pass rng.NextU32() to
+	// decorrelate kernels, or 0 for the plain sequence.
+	static void Sobol2D(DirectX::XMFLOAT2* out, uint32_t count,
+		uint32_t scrambleX = 0, uint32_t scrambleY = 0, uint32_t first = 0);
+
+	// Mitchell's best-candidate blue noise (toroidal distance).  Costs
+	// O(count^2 * candidates); meant for kernels of up to a few thousand
+	// points that are built once.
+	static void BlueNoise2D(DirectX::XMFLOAT2* out, uint32_t count, Random& rng, uint32_t candidates = 16);
+
+	//
+	// Warps from [0, 1)^2.  out and in may not alias.
+	//
+
+	// Uniform on the unit sphere.
+	static void ToSphere(DirectX::XMFLOAT3* out, const DirectX::XMFLOAT2* in, uint32_t count);
+
+	// Uniform on the unit hemisphere around +Z.
+	static void ToHemisphere(DirectX::XMFLOAT3* out, const DirectX::XMFLOAT2* in, uint32_t count);
+
+	// Cosine-weighted on the unit hemisphere around +Z.
+	static void ToCosineHemisphere(DirectX::XMFLOAT3* out, const DirectX::XMFLOAT2* in, uint32_t count);
+
+	// Uniform on the unit disk (Shirley-Chiu concentric map).
+	static void ToDisk(DirectX::XMFLOAT2* out, const DirectX::XMFLOAT2* in, uint32_t count);
+
+	// Rotates +Z hemisphere samples in place so +Z maps to the unit vector n.
+	static void OrientHemisphere(DirectX::XMFLOAT3* v, uint32_t count, DirectX::FXMVECTOR n);
+
+	//
+	// Ready-made kernels.
+	//
+
+	// Offset vectors for SsaoConstants::OffsetVectors: scrambled Sobol
+	// directions over the whole sphere (the shader flips those behind the
+	// surface) with random lengths in [0.25, 1].
+	static void SsaoKernel(DirectX::XMFLOAT4* out, uint32_t count, Random& rng);
+};
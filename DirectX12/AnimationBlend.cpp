@@ -0,0 +1,334 @@
+//***************************************************************************************
+// AnimationBlend.cpp
+//***************************************************************************************
+
+#include "AnimationBlend.h"
+#include "AnimationCompression.h"
+#include "BakedAnimation.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	enum
+	{
+		Tx = BakedClip::Tx, Ty = BakedClip::Ty, Tz = BakedClip::Tz,
+		Qx = BakedClip::Qx, Qy = BakedClip::Qy, Qz = BakedClip::Qz, Qw = BakedClip::Qw,
+		Sx = BakedClip::Sx, Sy = BakedClip::Sy, Sz = BakedClip::Sz,
+		ComponentCount = BakedClip::ComponentCount
+	};
+
+	// A layer with what sampling it needs worked out once per pose.
+	struct PreparedLayer
+	{
+		const AnimationLayer* Layer;
+		BakedClip::Position At, Reference;
+		float Time;
+		XMVECTOR Weight;
+	};
+
+	void SampleLayer(const AnimationLayer& layer, const BakedClip::Position& p, float t,
+		CompressedClip::Cursor& cursor, int firstBone, XMVECTOR* trs)
+	{
+		if (layer.Baked)
+			layer.Baked->SampleBones(p, firstBone, trs);
+		else
+			layer.Compressed->SampleBones(t, firstBone, cursor, trs);
+	}
+
+	// Hamilton product p q of four quaternions a lane, x y z w from p[0]:
+	// the rotation q, then p.
+	void QuatMultiply(const XMVECTOR* p, const XMVECTOR* q, XMVECTOR* out)
+	{
+		XMVECTOR x = XMVectorMultiply(p[3], q[0]);
+		x = XMVectorMultiplyAdd(p[0], q[3], x);
+		x = XMVectorMultiplyAdd(p[1], q[2], x);
+		x = XMVectorNegativeMultiplySubtract(p[2], q[1], x);
+
+		XMVECTOR y = XMVectorMultiply(p[3], q[1]);
+		y = XMVectorNegativeMultiplySubtract(p[0], q[2], y);
+		y = XMVectorMultiplyAdd(p[1], q[3], y);
+		y = XMVectorMultiplyAdd(p[2], q[0], y);
+
+		XMVECTOR z = XMVectorMultiply(p[3], q[2]);
+		z = XMVectorMultiplyAdd(p[0], q[1], z);
+		z = XMVectorNegativeMultiplySubtract(p[1], q[0], z);
+		z = XMVectorMultiplyAdd(p[2], q[3], z);
+
+		XMVECTOR w = XMVectorMultiply(p[3], q[3]);
+		w = XMVectorNegativeMultiplySubtract(p[0], q[0], w);
+		w = XMVectorNegativeMultiplySubtract(p[1], q[1], w);
+		w = XMVectorNegativeMultiplySubtract(p[2], q[2], w);
+
+		out[0] = x;
+		out[1] = y;
+		out[2] = z;
+		out[3] = w;
+	}
+
+	XMVECTOR QuatDot(const XMVECTOR* p, const XMVECTOR* q)
+	{
+		XMVECTOR d = XMVectorMultiply(p[0], q[0]);
+		d = XMVectorMultiplyAdd(p[1], q[1], d);
+		d = XMVectorMultiplyAdd(p[2], q[2], d);
+		return XMVectorMultiplyAdd(p[3], q[3], d);
+	}
+
+	void QuatNormalize(XMVECTOR* q)
+	{
+		XMVECTOR invLength = XMVectorReciprocalSqrt(QuatDot(q, q));
+		for (int k = 0; k < 4; ++k)
+			q[k] = XMVectorMultiply(q[k], invLength);
+	}
+
+	// Negates the lanes of q where 'flip' is set.
+	void QuatSelectNegate(XMVECTOR* q, FXMVECTOR flip)
+	{
+		for (int k = 0; k < 4; ++k)
+			q[k] = XMVectorSelect(q[k], XMVectorNegate(q[k]), flip);
+	}
+
+	void BlendOverride(XMVECTOR* pose, XMVECTOR* trs, FXMVECTOR weight)
+	{
+		// nlerp the short way: where the layer's rotation is on the other
+		// side of the hypersphere, use its negation.
+		QuatSelectNegate(trs + Qx, XMVectorLess(QuatDot(pose + Qx, trs + Qx), g_XMZero));
+
+		for (int k = 0; k < ComponentCount; ++k)
+			pose[k] = XMVectorLerpV(pose[k], trs[k], weight);
+		QuatNormalize(pose + Qx);
+	}
+
+	void BlendAdditive(XMVECTOR* pose, XMVECTOR* trs, XMVECTOR* reference, FXMVECTOR weight)
+	{
+		// Translation and scale add and multiply per component.
+		for (int k = Tx; k <= Tz; ++k)
+			pose[k] = XMVectorMultiplyAdd(XMVectorSubtract(trs[k], reference[k]), weight, pose[k]);
+		for (int k = Sx; k <= Sz; ++k)
+		{
+			XMVECTOR ratio = XMVectorDivide(trs[k], reference[k]);
+			pose[k] = XMVectorMultiply(pose[k], XMVectorLerpV(g_XMOne, ratio, weight));
+		}
+
+		// The rotation from the reference to the layer's, the short way,
+		// nlerped from the identity by the weight and applied after the pose.
+		XMVECTOR conjugate[4] = { XMVectorNegate(reference[Qx]), XMVectorNegate(reference[Qy]),
+			XMVectorNegate(reference[Qz]), reference[Qw] };
+		XMVECTOR delta[4];
+		QuatMultiply(trs + Qx, conjugate, delta);
+		QuatSelectNegate(delta, XMVectorLess(delta[3], g_XMZero));
+
+		for (int k = 0; k < 3; ++k)
+			delta[k] = XMVectorMultiply(delta[k], weight);
+		delta[3] = XMVectorLerpV(g_XMOne, delta[3], weight);
+
+		XMVECTOR q[4];
+		QuatMultiply(delta, pose + Qx, q);
+		std::copy(q, q + 4, pose + Qx);
+		QuatNormalize(pose + Qx);
+	}
+}
+
+BoneMask::BoneMask(int boneCount, float weight)
+	: mBoneCount(boneCount)
+{
+	assert(boneCount >= 0);
+	mWeights.assign((boneCount + 3) & ~3, 0.0f);
+	std::fill_n(mWeights.begin(), boneCount, weight);
+}
+
+void BoneMask::Set(int bone, float weight)
+{
+	assert(bone >= 0 && bone < mBoneCount);
+	mWeights[bone] = weight;
+}
+
+int AnimationLayer::BoneCount()const
+{
+	return Baked ? Baked->BoneCount() : Compressed ? Compressed->BoneCount() : 0;
+}
+
+float AnimationLayer::Duration()const
+{
+	return Baked ? Baked->Duration() : Compressed ? Compressed->Duration() : 0.0f;
+}
+
+void BlendLayers(const AnimationLayer* layers, int layerCount, int boneCount, XMFLOAT4X4* pose)
+{
+	assert(layerCount >= 0 && layerCount <= MaxBlendLayers);
+
+	PreparedLayer prepared[MaxBlendLayers];
+	int count = 0;
+	for (int i = 0; i < layerCount; ++i)
+	{
+		const AnimationLayer& layer = layers[i];
+		assert(layer.Baked || layer.Compressed);
+		assert(layer.BoneCount() >= boneCount);
+		assert(!layer.Mask || layer.Mask->BoneCount() >= boneCount);
+		if (layer.Weight <= 0.0f)
+			continue;
+
+		PreparedLayer& p = prepared[count++];
+		p.Layer = &layer;
+		p.Time = layer.Time;
+		p.Weight = XMVectorReplicate(std::min(layer.Weight, 1.0f));
+		if (layer.Baked)
+		{
+			p.At = layer.Baked->Locate(layer.Time, layer.Stepped);
+			p.Reference = layer.Baked->Locate(layer.ReferenceTime);
+		}
+		else if (layer.Stepped)
+		{
+			float sampleTime = layer.Compressed->SampleTime();
+			p.Time = std::floor(layer.Time / sampleTime) * sampleTime;
+		}
+	}
+
+	// Four bones per pass, one lane each, through every layer.
+	for (int b = 0; b < boneCount; b += 4)
+	{
+		XMVECTOR blended[ComponentCount];
+		for (int k = 0; k < ComponentCount; ++k)
+			blended[k] = (k == Qw || k >= Sx) ? g_XMOne : g_XMZero;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const PreparedLayer& p = prepared[i];
+			const AnimationLayer& layer = *p.Layer;
+
+			XMVECTOR weight = p.Weight;
+			if (layer.Mask)
+				weight = XMVectorMultiply(weight, XMLoadFloat4((const XMFLOAT4*)(layer.Mask->Weights() + b)));
+
+			// Sampled rotations are lerped between frames; unit ones blend by
+			// the weight as given.
+			XMVECTOR trs[ComponentCount];
+			SampleLayer(layer, p.At, p.Time, layer.Cursor, b, trs);
+			QuatNormalize(trs + Qx);
+
+			if (layer.Blend == AnimationLayer::Mode::Additive)
+			{
+				XMVECTOR reference[ComponentCount];
+				SampleLayer(layer, p.Reference, layer.ReferenceTime, layer.ReferenceCursor, b, reference);
+				QuatNormalize(reference + Qx);
+				BlendAdditive(blended, trs, reference, weight);
+			}
+			else if (i == 0 && !layer.Mask && layer.Weight >= 1.0f)
+			{
+				// Nothing below to blend with.
+				std::copy(trs, trs + ComponentCount, blended);
+			}
+			else
+			{
+				BlendOverride(blended, trs, weight);
+			}
+		}
+
+		BakedClip::StoreBones(blended, std::min(boneCount - b, 4), pose + b);
+	}
+}
+
+void AnimationPlayer::Play(const BakedClip& clip, float fadeTime)
+{
+	AnimationLayer layer;
+	layer.Baked = &clip;
+	Play(layer, fadeTime);
+}
+
+void AnimationPlayer::Play(const CompressedClip& clip, float fadeTime)
+{
+	AnimationLayer layer;
+	layer.Compressed = &clip;
+	Play(layer, fadeTime);
+}
+
+void AnimationPlayer::Play(AnimationLayer layer, float fadeTime)
+{
+	layer.Stepped = mStepped;
+	if (fadeTime > 0.0f && mBaseCount > 0)
+	{
+		layer.Weight = 0.0f;
+		mFadeRates.push_back(1.0f / fadeTime);
+	}
+	else
+	{
+		// A cut: nothing below shows any more.
+		mLayers.erase(mLayers.begin(), mLayers.begin() + mBaseCount);
+		mFadeRates.clear();
+		mBaseCount = 0;
+		mFadeRates.push_back(0.0f);
+	}
+
+	// Clips started faster than they fade in pile up; the oldest goes.
+	if ((int)mLayers.size() + 1 > MaxBlendLayers && mBaseCount > 1)
+	{
+		mLayers.erase(mLayers.begin());
+		mFadeRates.erase(mFadeRates.begin());
+		--mBaseCount;
+		mLayers[0].Weight = 1.0f;
+	}
+
+	mLayers.insert(mLayers.begin() + mBaseCount, layer);
+	++mBaseCount;
+	assert((int)mLayers.size() <= MaxBlendLayers);
+}
+
+int AnimationPlayer::AddOverlay(const AnimationLayer& layer)
+{
+	assert((int)mLayers.size() < MaxBlendLayers);
+	mLayers.push_back(layer);
+	return OverlayCount() - 1;
+}
+
+void AnimationPlayer::ClearOverlays()
+{
+	mLayers.resize(mBaseCount);
+}
+
+void AnimationPlayer::SetStepped(bool stepped)
+{
+	mStepped = stepped;
+	for (AnimationLayer& layer : mLayers)
+		layer.Stepped = stepped;
+}
+
+int AnimationPlayer::BoneCount()const
+{
+	return mBaseCount > 0 ? mLayers[mBaseCount - 1].BoneCount() : 0;
+}
+
+void AnimationPlayer::Advance(float dt)
+{
+	for (AnimationLayer& layer : mLayers)
+	{
+		float duration = layer.Duration();
+		if (duration <= 0.0f)
+			continue;
+		layer.Time = std::fmod(layer.Time + dt, duration);
+		if (layer.Time < 0.0f)
+			layer.Time += duration;
+	}
+
+	for (int i = 0; i < mBaseCount; ++i)
+		mLayers[i].Weight = std::min(mLayers[i].Weight + mFadeRates[i] * dt, 1.0f);
+
+	// A clip at full weight hides every clip under it.
+	for (int i = mBaseCount - 1; i > 0; --i)
+	{
+		if (mLayers[i].Weight >= 1.0f)
+		{
+			mLayers.erase(mLayers.begin(), mLayers.begin() + i);
+			mFadeRates.erase(mFadeRates.begin(), mFadeRates.begin() + i);
+			mBaseCount -= i;
+			break;
+		}
+	}
+}
+
+void AnimationPlayer::Evaluate(XMFLOAT4X4* pose)const
+{
+	BlendLayers(mLayers.data(), (int)mLayers.size(), BoneCount(), pose);
+}
@@ -0,0 +1,130 @@
+//***************************************************************************************
+// AnimationBlend.h
+//
+// Layered blending of baked clips, BakedClip or CompressedClip, into one
+// pose.  Layers apply bottom to top, each over the result of the ones below:
+//
+//   Override  blends from the pose below toward the layer's pose by its
+//             weight: crossfades, or with a BoneMask an upper-body clip
+//             over a walk.
+//   Additive  adds the layer's motion away from its own pose at
+//             ReferenceTime, scaled by its weight: breathing, recoil, lean.
+//
+// Every layer is sampled and blended four bones at a time as translation,
+// rotation and scale, a bone per lane, and only the result is built into
+// matrices; no layer makes a pose of its own.  Rotations blend by nlerp.
+//
+// AnimationPlayer keeps the layers of one character: it advances their
+// times, fades clips in over the one playing, and evaluates them.
+//***************************************************************************************
+
+#ifndef ANIMATIONBLEND_H
+#define ANIMATIONBLEND_H
+
+#include <vector>
+#include <DirectXMath.h>
+#include "AnimationCompression.h"
+
+class BakedClip;
+
+// Per-bone scale of a layer's weight.
+class BoneMask
+{
+public:
+    BoneMask() = default;
+    explicit BoneMask(int boneCount, float weight = 0.0f);
+
+    int BoneCount()const { return mBoneCount; }
+
+    void Set(int bone, float weight);
+    float Weight(int bone)const { return mWeights[bone]; }
+
+    // BoneCount() weights, then zeros up to a multiple of four.
+    const float* Weights()const { return mWeights.data(); }
+
+private:
+    int mBoneCount = 0;
+    std::vector<float> mWeights;
+};
+
+struct AnimationLayer
+{
+    enum class Mode { Override, Additive };
+
+    // The clip, one or the other.
+    const BakedClip* Baked = nullptr;
+    const CompressedClip* Compressed = nullptr;
+
+    float Time = 0.0f;                  // seconds from the clip's first frame
+    float Weight = 1.0f;
+    Mode Blend = Mode::Override;
+    float ReferenceTime = 0.0f;         // Additive: time of the pose the motion is from
+    const BoneMask* Mask = nullptr;     // nullptr for every bone at Weight
+    bool Stepped = false;               // the baked frame at or before Time, unblended
+
+    // Where sampling Compressed is, at Time and at ReferenceTime.
+    // BlendLayers moves them along, so one thread at a time blends a layer.
+    mutable CompressedClip::Cursor Cursor, ReferenceCursor;
+
+    int BoneCount()const;
+    float Duration()const;
+};
+
+const int MaxBlendLayers = 16;
+
+// Blends layers[0, layerCount), at most MaxBlendLayers, over the identity
+// into boneCount matrices at 'pose'.  Layers without weight are skipped;
+// each layer's clip has at least boneCount bones.
+void BlendLayers(const AnimationLayer* layers, int layerCount, int boneCount,
+    DirectX::XMFLOAT4X4* pose);
+
+class AnimationPlayer
+{
+public:
+    // Plays 'clip' from its start, looping, fading it in over whatever is
+    // playing across fadeTime seconds; 0 cuts to it.
+    void Play(const BakedClip& clip, float fadeTime);
+    void Play(const CompressedClip& clip, float fadeTime);
+
+    bool IsPlaying()const { return mBaseCount > 0; }
+
+    // Layers over the clips Play starts, applied in the order added; their
+    // times loop as well.  Returns the overlay's index.
+    int AddOverlay(const AnimationLayer& layer);
+    AnimationLayer& Overlay(int index) { return mLayers[mBaseCount + index]; }
+    int OverlayCount()const { return (int)mLayers.size() - mBaseCount; }
+    void ClearOverlays();
+
+    // Samples every layer as Stepped says.
+    void SetStepped(bool stepped);
+
+    // Layers Evaluate blends: the clips still fading and the overlays.
+    int LayerCount()const { return (int)mLayers.size(); }
+    const AnimationLayer* Layers()const { return mLayers.data(); }
+
+    // Bones of the last clip played.
+    int BoneCount()const;
+
+    // Moves every layer and fade dt seconds on, and drops the clips
+    // hidden under one that has faded fully in.
+    void Advance(float dt);
+
+    // Writes the BoneCount() matrices of the blended layers to 'pose'.
+    // Moves the layers' cursors, so one thread at a time evaluates a player.
+    void Evaluate(DirectX::XMFLOAT4X4* pose)const;
+
+private:
+    void Play(AnimationLayer layer, float fadeTime);
+
+private:
+    // The clips Play started, oldest first, then the overlays.
+    std::vector<AnimationLayer> mLayers;
+
+    // Weight per second each of the clips Play started gains.
+    std::vector<float> mFadeRates;
+
+    int mBaseCount = 0;
+    bool mStepped = false;
+};
+
+#endif // ANIMATIONBLEND_H
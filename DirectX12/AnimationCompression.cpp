@@ -0,0 +1,472 @@
+//***************************************************************************************
+// AnimationCompression.cpp
+//***************************************************************************************
+
+#include "AnimationCompression.h"
+#include "BakedAnimation.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	const float kSqrt2 = 1.41421356f;
+
+	// Largest value of a packed quaternion component.
+	const float kPackedMax = 32767.0f;
+
+	inline XMVECTOR Load4(const float* p) { return XMLoadFloat4((const XMFLOAT4*)p); }
+
+	// Interpolation as played: lerp, and for rotations nlerp the short way.
+	inline XMVECTOR Interpolate(bool rotation, FXMVECTOR a, FXMVECTOR b, float s)
+	{
+		if (!rotation)
+			return XMVectorLerp(a, b, s);
+		XMVECTOR nearB = XMVectorGetX(XMQuaternionDot(a, b)) < 0.0f ? XMVectorNegate(b) : b;
+		return XMQuaternionNormalize(XMVectorLerp(a, nearB, s));
+	}
+
+	// A cursor's block for four bones, in floats, four lanes to an entry:
+	// per slot the frame of each channel, per slot each component in the
+	// order of BakedClip::Component, then per channel the reciprocal of
+	// slot 1's frame less slot 0's.  Each rotation is on the same side of
+	// the hypersphere as the key before, so the two nlerp the short way.  A
+	// constant track has its key in both slots, at frames 0 and FrameCount().
+	const int kChannels = 3;
+	const int kFramesAt = 0;
+	const int kValuesAt = kFramesAt + 2 * kChannels * 4;
+	const int kRatesAt = kValuesAt + 2 * BakedClip::ComponentCount * 4;
+	const int kBlockSize = kRatesAt + kChannels * 4;
+
+	// How far apart two values of a channel put a point 'distance' from the
+	// bone.  For rotations that is the chord 2 sin(angle / 2) at unit
+	// distance, which is |a - b| sqrt(2 (1 + a.b)) for unit quaternions;
+	// 1 - (a.b)^2 would round to 0 for small angles.  q and -q are the same
+	// rotation.
+	inline float ChannelError(bool rotation, bool scale, FXMVECTOR a, FXMVECTOR b, float distance)
+	{
+		if (rotation)
+		{
+			float c = XMVectorGetX(XMQuaternionDot(a, b));
+			XMVECTOR nearB = c < 0.0f ? XMVectorNegate(b) : b;
+			float chord = XMVectorGetX(XMVector4Length(XMVectorSubtract(a, nearB)));
+			return distance * chord * std::sqrt(2.0f * (1.0f + std::min(std::fabs(c), 1.0f)));
+		}
+		float d = XMVectorGetX(XMVector3Length(XMVectorSubtract(a, b)));
+		return scale ? distance * d : d;
+	}
+
+	// How far apart two bone matrices put the bone's origin and the points
+	// 'distance' along its axes.
+	float MatrixError(CXMMATRIX a, CXMMATRIX b, float distance)
+	{
+		XMVECTOR origin = XMVectorSubtract(a.r[3], b.r[3]);
+		float error = XMVectorGetX(XMVector3Length(origin));
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			XMVECTOR d = XMVectorMultiplyAdd(XMVectorSubtract(a.r[axis], b.r[axis]),
+				XMVectorReplicate(distance), origin);
+			error = std::max(error, XMVectorGetX(XMVector3Length(d)));
+		}
+		return error;
+	}
+}
+
+CompressedClip::CompressedClip(const XMFLOAT4X4* frames, int frameCount, int boneCount,
+	float sampleTime, const Settings& settings)
+	: mBoneCount(boneCount), mFrameCount(frameCount), mSampleTime(sampleTime),
+	mVertexDistance(settings.VertexDistance)
+{
+	assert(frameCount >= 1 && frameCount <= 65536);
+	assert(boneCount >= 0 && sampleTime > 0.0f);
+
+	// The three channels' errors add up at worst, so each gets a third.
+	float tolerance = settings.Tolerance / ChannelCount;
+
+	mTracks.resize((size_t)boneCount * ChannelCount);
+	std::vector<XMFLOAT4> values[ChannelCount];
+	for (int c = 0; c < ChannelCount; ++c)
+		values[c].resize(frameCount);
+
+	for (int bone = 0; bone < boneCount; ++bone)
+	{
+		for (int f = 0; f < frameCount; ++f)
+		{
+			XMVECTOR S, Q, T;
+			XMMatrixDecompose(&S, &Q, &T, XMLoadFloat4x4(&frames[(size_t)f * boneCount + bone]));
+			XMStoreFloat4(&values[Translation][f], T);
+			XMStoreFloat4(&values[Rotation][f], XMQuaternionNormalize(Q));
+			XMStoreFloat4(&values[Scale][f], S);
+		}
+
+		for (int c = 0; c < ChannelCount; ++c)
+			CompressTrack(c, bone, values[c], tolerance);
+	}
+
+	mStats.SourceBytes = (size_t)frameCount * boneCount * sizeof(XMFLOAT4X4);
+	mStats.CompressedBytes = mTracks.size() * sizeof(Track) +
+		mTranslations.size() * sizeof(XMFLOAT3) +
+		mRotations.size() * sizeof(PackedQuat) +
+		mScales.size() * sizeof(XMFLOAT3);
+	for (int c = 0; c < ChannelCount; ++c)
+		mStats.CompressedBytes += mKeyFrames[c].size() * sizeof(std::uint16_t);
+	mStats.SourceKeys = (size_t)frameCount * mTracks.size();
+
+	// Measure the result as it will be played: sampled at every source frame.
+	std::vector<XMFLOAT4X4> pose(boneCount);
+	for (int f = 0; f < frameCount; ++f)
+	{
+		Sample(f * sampleTime, pose.data());
+		for (int bone = 0; bone < boneCount; ++bone)
+		{
+			float error = MatrixError(XMLoadFloat4x4(&pose[bone]),
+				XMLoadFloat4x4(&frames[(size_t)f * boneCount + bone]), mVertexDistance);
+			mStats.MaxError = std::max(mStats.MaxError, error);
+		}
+	}
+}
+
+void CompressedClip::CompressTrack(int channel, int bone, const std::vector<XMFLOAT4>& values,
+	float tolerance)
+{
+	bool rotation = channel == Rotation;
+	bool scale = channel == Scale;
+	int n = mFrameCount;
+
+	// The value of every frame as it would be stored.
+	std::vector<XMFLOAT4> stored(n);
+	for (int f = 0; f < n; ++f)
+	{
+		XMVECTOR v = XMLoadFloat4(&values[f]);
+		XMStoreFloat4(&stored[f], rotation ? UnpackQuat(PackQuat(v)) : v);
+	}
+
+	Track& track = mTracks[(size_t)bone * ChannelCount + channel];
+	track.First = (std::uint32_t)mKeyFrames[channel].size();
+
+	bool constant = true;
+	XMVECTOR first = XMLoadFloat4(&stored[0]);
+	for (int f = 1; f < n && constant; ++f)
+		constant = ChannelError(rotation, scale, first, XMLoadFloat4(&values[f]), mVertexDistance) <= tolerance;
+
+	if (constant)
+	{
+		track.Count = 1;
+		AddKey(channel, 0, XMLoadFloat4(&values[0]));
+		++mStats.ConstantTracks;
+		++mStats.KeptKeys;
+		return;
+	}
+
+	// Keep the first and last frames, then split every span at its worst
+	// frame until interpolating the stored keys is within tolerance of
+	// every source frame.
+	std::vector<char> keep(n, 0);
+	keep[0] = keep[n - 1] = 1;
+	std::vector<std::pair<int, int>> spans;
+	spans.push_back(std::make_pair(0, n - 1));
+	while (!spans.empty())
+	{
+		int a = spans.back().first;
+		int b = spans.back().second;
+		spans.pop_back();
+
+		XMVECTOR va = XMLoadFloat4(&stored[a]);
+		XMVECTOR vb = XMLoadFloat4(&stored[b]);
+		int worst = -1;
+		float worstError = tolerance;
+		for (int f = a + 1; f < b; ++f)
+		{
+			XMVECTOR v = Interpolate(rotation, va, vb, (float)(f - a) / (b - a));
+			float error = ChannelError(rotation, scale, v, XMLoadFloat4(&values[f]), mVertexDistance);
+			if (error > worstError)
+			{
+				worst = f;
+				worstError = error;
+			}
+		}
+
+		if (worst >= 0)
+		{
+			keep[worst] = 1;
+			spans.push_back(std::make_pair(a, worst));
+			spans.push_back(std::make_pair(worst, b));
+		}
+	}
+
+	for (int f = 0; f < n; ++f)
+	{
+		if (keep[f])
+			AddKey(channel, f, XMLoadFloat4(&values[f]));
+	}
+	track.Count = (std::uint32_t)mKeyFrames[channel].size() - track.First;
+	++mStats.AnimatedTracks;
+	mStats.KeptKeys += track.Count;
+}
+
+void CompressedClip::AddKey(int channel, int frame, FXMVECTOR v)
+{
+	mKeyFrames[channel].push_back((std::uint16_t)frame);
+	if (channel == Rotation)
+	{
+		mRotations.push_back(PackQuat(v));
+	}
+	else
+	{
+		XMFLOAT3 value;
+		XMStoreFloat3(&value, v);
+		(channel == Translation ? mTranslations : mScales).push_back(value);
+	}
+}
+
+XMVECTOR CompressedClip::KeyValue(int channel, size_t key)const
+{
+	switch (channel)
+	{
+	case Translation: return XMLoadFloat3(&mTranslations[key]);
+	case Rotation: return UnpackQuat(mRotations[key]);
+	default: return XMLoadFloat3(&mScales[key]);
+	}
+}
+
+void CompressedClip::KeyComponents(int channel, size_t key, float* c)const
+{
+	if (channel == Rotation)
+	{
+		UnpackQuat(mRotations[key], c);
+		return;
+	}
+	const XMFLOAT3& v = (channel == Translation ? mTranslations : mScales)[key];
+	c[0] = v.x;
+	c[1] = v.y;
+	c[2] = v.z;
+}
+
+std::uint32_t CompressedClip::FindKey(int channel, const Track& track, float f)const
+{
+	if (track.Count == 1)
+		return 0;
+
+	// The keys include the first and last frames, so the first key after f
+	// is one of the others, or the last if f is the last frame.
+	const std::uint16_t* frames = mKeyFrames[channel].data() + track.First;
+	return (std::uint32_t)(std::upper_bound(frames + 1, frames + track.Count - 1, f) - frames) - 1;
+}
+
+XMVECTOR CompressedClip::SampleTrack(int channel, const Track& track, float f)const
+{
+	if (track.Count == 1)
+		return KeyValue(channel, track.First);
+
+	const std::uint16_t* frames = mKeyFrames[channel].data() + track.First;
+	std::uint32_t i = FindKey(channel, track, f);
+	std::uint32_t j = i + 1;
+
+	float s = (f - frames[i]) / (frames[j] - frames[i]);
+	return Interpolate(channel == Rotation, KeyValue(channel, track.First + i),
+		KeyValue(channel, track.First + j), s);
+}
+
+void CompressedClip::Sample(float t, XMFLOAT4X4* pose)const
+{
+	float f = std::min(std::max(t / mSampleTime, 0.0f), (float)(mFrameCount - 1));
+
+	XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	const Track* track = mTracks.data();
+	for (int bone = 0; bone < mBoneCount; ++bone, track += ChannelCount)
+	{
+		XMVECTOR T = SampleTrack(Translation, track[Translation], f);
+		XMVECTOR Q = SampleTrack(Rotation, track[Rotation], f);
+		XMVECTOR S = SampleTrack(Scale, track[Scale], f);
+		XMStoreFloat4x4(&pose[bone], XMMatrixAffineTransformation(S, zero, Q, T));
+	}
+}
+
+void CompressedClip::Bind(Cursor& cursor)const
+{
+	if (cursor.mClip == this && cursor.mKeys.size() == mTracks.size())
+		return;
+
+	int blocks = (mBoneCount + 3) / 4;
+	cursor.mClip = this;
+	cursor.mKeys.assign(mTracks.size(), 0);
+	cursor.mData.assign((size_t)blocks * kBlockSize, 0.0f);
+
+	// Padding bones are identity over every frame.
+	for (int b = 0; b < blocks; ++b)
+	{
+		float* block = cursor.mData.data() + (size_t)b * kBlockSize;
+		for (int c = 0; c < kChannels; ++c)
+		{
+			std::fill_n(block + kFramesAt + (kChannels + c) * 4, 4, (float)mFrameCount);
+			std::fill_n(block + kRatesAt + c * 4, 4, 1.0f / mFrameCount);
+		}
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			float* values = block + kValuesAt + slot * BakedClip::ComponentCount * 4;
+			std::fill_n(values + BakedClip::Qw * 4, 4, 1.0f);
+			std::fill_n(values + BakedClip::Sx * 4, 3 * 4, 1.0f);
+		}
+	}
+
+	for (int bone = 0; bone < mBoneCount; ++bone)
+	{
+		for (int c = 0; c < ChannelCount; ++c)
+			LoadKeys(cursor, c, bone, 0);
+	}
+}
+
+void CompressedClip::LoadKeys(Cursor& cursor, int channel, int bone, std::uint32_t key)const
+{
+	const Track& track = mTracks[(size_t)bone * ChannelCount + channel];
+	std::uint32_t& current = cursor.mKeys[(size_t)bone * ChannelCount + channel];
+	bool next = key == current + 1;
+	current = key;
+
+	// Entries are four floats apart, one per bone of the block.
+	float* block = cursor.mData.data() + (size_t)(bone / 4) * kBlockSize + (bone & 3);
+	int first = channel == Translation ? BakedClip::Tx : channel == Rotation ? BakedClip::Qx : BakedClip::Sx;
+	int count = channel == Rotation ? 4 : 3;
+	float* values[2] = { block + kValuesAt + first * 4,
+		block + kValuesAt + (BakedClip::ComponentCount + first) * 4 };
+	float* frames[2] = { block + kFramesAt + channel * 4, block + kFramesAt + (kChannels + channel) * 4 };
+	float* rate = block + kRatesAt + channel * 4;
+
+	float c[4];
+	if (track.Count == 1)
+	{
+		KeyComponents(channel, track.First, c);
+		for (int i = 0; i < count; ++i)
+			values[0][i * 4] = values[1][i * 4] = c[i];
+		*frames[0] = 0.0f;
+		*frames[1] = (float)mFrameCount;
+		*rate = 1.0f / mFrameCount;
+		return;
+	}
+
+	// Stepping forward leaves the key reached in its slot and only unpacks
+	// the one after it.
+	for (std::uint32_t k = next ? key + 1 : key; k <= key + 1; ++k)
+	{
+		KeyComponents(channel, track.First + k, c);
+		if (channel == Rotation && k > key)
+		{
+			const float* q = values[~k & 1];
+			if (c[0] * q[0] + c[1] * q[4] + c[2] * q[8] + c[3] * q[12] < 0.0f)
+			{
+				for (int i = 0; i < 4; ++i)
+					c[i] = -c[i];
+			}
+		}
+		for (int i = 0; i < count; ++i)
+			values[k & 1][i * 4] = c[i];
+		*frames[k & 1] = mKeyFrames[channel][track.First + k];
+	}
+	*rate = 1.0f / (*frames[1] - *frames[0]);
+}
+
+void CompressedClip::SampleBones(float t, int firstBone, Cursor& cursor, XMVECTOR* trs)const
+{
+	assert(firstBone % 4 == 0);
+	Bind(cursor);
+	float f = std::min(std::max(t / mSampleTime, 0.0f), (float)(mFrameCount - 1));
+	const float* block = cursor.mData.data() + (size_t)(firstBone / 4) * kBlockSize;
+
+	// Move the tracks f has left the keys of: to the next key when playing
+	// forward, else wherever a search finds.
+	int lanes = std::min(mBoneCount - firstBone, 4);
+	for (int c = 0; c < ChannelCount; ++c)
+	{
+		const float* frame0 = block + kFramesAt + c * 4;
+		const float* frame1 = block + kFramesAt + (kChannels + c) * 4;
+		for (int l = 0; l < lanes; ++l)
+		{
+			// Between the keys, whichever slot has the earlier.
+			if ((f - frame0[l]) * (f - frame1[l]) <= 0.0f)
+				continue;
+
+			int bone = firstBone + l;
+			const Track& track = mTracks[(size_t)bone * ChannelCount + c];
+			const std::uint16_t* frames = mKeyFrames[c].data() + track.First;
+			std::uint32_t key = cursor.mKeys[(size_t)bone * ChannelCount + c] + 1;
+			if (key + 1 >= track.Count || f < frames[key] || f > frames[key + 1])
+				key = FindKey(c, track, f);
+			LoadKeys(cursor, c, bone, key);
+		}
+	}
+
+	// Slot 0's value plus the difference to slot 1's over the frames between.
+	XMVECTOR at = XMVectorReplicate(f);
+	XMVECTOR s[ChannelCount];
+	for (int c = 0; c < ChannelCount; ++c)
+	{
+		XMVECTOR frame0 = Load4(block + kFramesAt + c * 4);
+		s[c] = XMVectorMultiply(XMVectorSubtract(at, frame0), Load4(block + kRatesAt + c * 4));
+	}
+
+	const float* a = block + kValuesAt;
+	const float* b = block + kValuesAt + BakedClip::ComponentCount * 4;
+	for (int k = 0; k < BakedClip::ComponentCount; ++k)
+	{
+		int channel = k < BakedClip::Qx ? Translation : k < BakedClip::Sx ? Rotation : Scale;
+		trs[k] = XMVectorLerpV(Load4(a + k * 4), Load4(b + k * 4), s[channel]);
+	}
+}
+
+CompressedClip::PackedQuat CompressedClip::PackQuat(FXMVECTOR q)
+{
+	XMFLOAT4 v;
+	XMStoreFloat4(&v, q);
+	float c[4] = { v.x, v.y, v.z, v.w };
+
+	int largest = 0;
+	for (int i = 1; i < 4; ++i)
+	{
+		if (std::fabs(c[i]) > std::fabs(c[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation; flip so the dropped component is
+	// positive.  The other three are then within +-1/sqrt(2).
+	float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+	PackedQuat p;
+	int k = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+		float unit = c[i] * sign * kSqrt2 * 0.5f + 0.5f;
+		float packed = std::floor(std::min(std::max(unit, 0.0f), 1.0f) * kPackedMax + 0.5f);
+		p.c[k++] = (std::uint16_t)packed;
+	}
+	p.c[0] |= (std::uint16_t)((largest & 1) << 15);
+	p.c[1] |= (std::uint16_t)((largest >> 1) << 15);
+	return p;
+}
+
+XMVECTOR CompressedClip::UnpackQuat(const PackedQuat& p)
+{
+	XMFLOAT4 q;
+	UnpackQuat(p, &q.x);
+	return XMLoadFloat4(&q);
+}
+
+void CompressedClip::UnpackQuat(const PackedQuat& p, float* c)
+{
+	int largest = (p.c[0] >> 15) | ((p.c[1] >> 15) << 1);
+
+	// The k-th stored component is the k-th of the other three.
+	float sumSquares = 0.0f;
+	for (int k = 0; k < 3; ++k)
+	{
+		// (unit * 2 - 1) / sqrt(2) for unit = packed / kPackedMax.
+		float v = (p.c[k] & 0x7fff) * (kSqrt2 / kPackedMax) - kSqrt2 * 0.5f;
+		c[k + (k >= largest)] = v;
+		sumSquares += v * v;
+	}
+	c[largest] = std::sqrt(std::max(1.0f - sumSquares, 0.0f));
+}
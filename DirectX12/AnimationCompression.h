@@ -0,0 +1,164 @@
+//***************************************************************************************
+// AnimationCompression.h
+//
+// Compression of baked skeletal animation: a clip sampled at a fixed rate,
+// one matrix per bone per frame, as Graphics::Fetch_bone_animations bakes
+// it from an FBX file.
+//
+// Each bone's matrices are split into translation, rotation and scale
+// tracks.  A track that barely moves is kept as one constant value; the
+// others keep only the frames that interpolation between their neighbours
+// cannot reproduce within the error tolerance, interpolating as playback
+// does: lerp, and nlerp for rotations.  Rotations are stored as 48-bit
+// "smallest three" quaternions.
+//
+// Error is measured where it shows: how far a point VertexDistance from the
+// bone lands from where the source matrix puts it.
+//***************************************************************************************
+
+#ifndef ANIMATIONCOMPRESSION_H
+#define ANIMATIONCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+class CompressedClip
+{
+public:
+    struct Settings
+    {
+        float Tolerance = 0.001f;       // largest error allowed, in model units
+        float VertexDistance = 1.0f;    // distance from the bone the error is measured at
+    };
+
+    struct Statistics
+    {
+        size_t SourceBytes = 0;         // the baked matrices
+        size_t CompressedBytes = 0;
+        int ConstantTracks = 0;
+        int AnimatedTracks = 0;
+        size_t SourceKeys = 0;          // frames x tracks
+        size_t KeptKeys = 0;
+        float MaxError = 0.0f;          // worst error over every bone and frame, in model units
+
+        float Ratio()const { return CompressedBytes > 0 ? (float)SourceBytes / CompressedBytes : 0.0f; }
+    };
+
+    CompressedClip() = default;
+
+    // Compresses frameCount x boneCount matrices, frame by frame, baked
+    // every sampleTime seconds.  Takes at most 65536 frames.
+    CompressedClip(const DirectX::XMFLOAT4X4* frames, int frameCount, int boneCount,
+        float sampleTime, const Settings& settings);
+
+    int BoneCount()const { return mBoneCount; }
+    int FrameCount()const { return mFrameCount; }
+    float SampleTime()const { return mSampleTime; }
+    float Duration()const { return (mFrameCount - 1) * mSampleTime; }
+
+    // How much smaller the clip got, and how much it moved.
+    const Statistics& Stats()const { return mStats; }
+
+    // Writes the BoneCount() matrices at time t, in seconds from the first
+    // frame, to 'pose', in the layout of the source frames.  t is clamped
+    // to the clip.
+    void Sample(float t, DirectX::XMFLOAT4X4* pose)const;
+
+    // Where one playback of the clip is: for every track, the two keys
+    // around the frame last sampled, unpacked into lanes the way BakedClip
+    // keeps its frames.  Sampling through a cursor unpacks a key only as
+    // playback reaches it, and never decodes more of the clip than that.
+    // One per playing layer; it starts over when used with another clip.
+    class Cursor
+    {
+    private:
+        friend class CompressedClip;
+
+        const CompressedClip* mClip = nullptr;
+
+        // Per track, the index in the track of the first of the two keys
+        // around the frame last sampled.
+        std::vector<std::uint32_t> mKeys;
+
+        // A block per four bones, laid out in AnimationCompression.cpp, of
+        // the keys in two slots: key k of a track is in slot k & 1.
+        std::vector<float> mData;
+    };
+
+    // The translation, rotation and scale of bones firstBone to firstBone + 3
+    // at time t through 'cursor', a bone per lane, in the order of
+    // BakedClip::Component; firstBone is a multiple of four.  Bones past the
+    // last are identity.  Rotations are lerped, so not quite unit.
+    void SampleBones(float t, int firstBone, Cursor& cursor, DirectX::XMVECTOR* trs)const;
+
+private:
+    enum Channel { Translation, Rotation, Scale, ChannelCount };
+
+    // Rotation as the three smallest components, 15 bits each, and the
+    // index of the largest one in the top bits of the first two.
+    struct PackedQuat
+    {
+        std::uint16_t c[3];
+    };
+
+    // A track's keys are Count entries from First in its channel's arrays.
+    // One key means the track is constant.
+    struct Track
+    {
+        std::uint32_t First;
+        std::uint32_t Count;
+    };
+
+    static PackedQuat PackQuat(DirectX::FXMVECTOR q);
+    static DirectX::XMVECTOR UnpackQuat(const PackedQuat& p);
+    static void UnpackQuat(const PackedQuat& p, float* q);
+
+    // The value of key 'key' of a channel.
+    DirectX::XMVECTOR KeyValue(int channel, size_t key)const;
+
+    // The same as 3 floats, or 4 for rotations, at 'c'.
+    void KeyComponents(int channel, size_t key, float* c)const;
+
+    // The index in a track of the first of the two keys around frame f;
+    // f is in the clip.  0 for a constant track.
+    std::uint32_t FindKey(int channel, const Track& track, float f)const;
+
+    // The channel value of a track at frame f; f is in the clip.
+    DirectX::XMVECTOR SampleTrack(int channel, const Track& track, float f)const;
+
+    // Makes 'cursor' this clip's, at the first frame, unless it already is.
+    void Bind(Cursor& cursor)const;
+
+    // Unpacks keys 'key' and 'key' + 1 of one bone's track into the cursor,
+    // only the second when 'key' follows the cursor's key; just the key for
+    // a constant track.
+    void LoadKeys(Cursor& cursor, int channel, int bone, std::uint32_t key)const;
+
+    // Compresses one channel of one bone from its per-frame values.
+    void CompressTrack(int channel, int bone, const std::vector<DirectX::XMFLOAT4>& values,
+        float tolerance);
+
+    // Appends key 'frame' with value v to a channel.
+    void AddKey(int channel, int frame, DirectX::FXMVECTOR v);
+
+private:
+    int mBoneCount = 0;
+    int mFrameCount = 0;
+    float mSampleTime = 0.0f;
+    float mVertexDistance = 1.0f;
+
+    // ChannelCount tracks per bone, bone by bone.
+    std::vector<Track> mTracks;
+
+    // Per channel, the frame of every key, and in parallel its value.
+    std::vector<std::uint16_t> mKeyFrames[ChannelCount];
+    std::vector<DirectX::XMFLOAT3> mTranslations;
+    std::vector<PackedQuat> mRotations;
+    std::vector<DirectX::XMFLOAT3> mScales;
+
+    Statistics mStats;
+};
+
+#endif // ANIMATIONCOMPRESSION_H
@@ -0,0 +1,134 @@
+//***************************************************************************************
+// AsyncWaves.cpp
+//***************************************************************************************
+
+#include "AsyncWaves.h"
+#include <chrono>
+
+using namespace DirectX;
+
+int WaveSnapshot::DirtyRects(std::uint64_t version, std::vector<Waves::DirtyRect>& rects)const
+{
+	return Waves::CollectDirtyRects(mTileVersions.data(), mNumRows, mNumCols, version, rects);
+}
+
+AsyncWaves::AsyncWaves(int m, int n, float dx, float dt, float speed, float damping, JobSystem& jobs,
+	Waves::Storage storage)
+	: mWaves(m, n, dx, dt, speed, damping, storage), mJobs(jobs), mReady(2), mRunning(false), mTasks(jobs)
+{
+	mWaves.SetJobSystem(jobs);
+
+	// Every snapshot starts out as the flat initial solution.
+	int tileCount = ((m + Waves::TileSize - 1) / Waves::TileSize) * ((n + Waves::TileSize - 1) / Waves::TileSize);
+	for (WaveSnapshot& s : mSnapshots)
+	{
+		s.mNumRows = m;
+		s.mNumCols = n;
+		s.mSpatialStep = dx;
+		s.mHalfWidth = (n - 1) * dx * 0.5f;
+		s.mHalfDepth = (m - 1) * dx * 0.5f;
+		s.mHeights.assign(m * n, 0.0f);
+		s.mNormals.assign(m * n, XMFLOAT3(0.0f, 1.0f, 0.0f));
+		s.mTileVersions.assign(tileCount, 0);
+	}
+}
+
+AsyncWaves::~AsyncWaves()
+{
+	Wait();
+}
+
+void AsyncWaves::Update(float dt)
+{
+	mRequestedTime += dt;
+	mPendingTime += dt;
+
+	// The job in flight has its time; this frame's waits for the next one.
+	if (mRunning.load(std::memory_order_acquire))
+		return;
+
+	float pending = mPendingTime;
+	double requested = mRequestedTime;
+	mPendingTime = 0.0f;
+	mRunning.store(true, std::memory_order_relaxed);
+
+	if (mJobs.Concurrency() == 1)
+	{
+		Solve(pending, requested);
+		return;
+	}
+
+	mTasks.Run([this, pending, requested]()
+	{
+		Solve(pending, requested);
+	});
+}
+
+void AsyncWaves::Solve(float dt, double simulatedTime)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	mWaves.Update(dt);
+
+	WaveSnapshot& back = mSnapshots[mBack];
+	Publish(back);
+	back.mSimulatedTime = simulatedTime;
+	back.mDroppedSteps = mWaves.DroppedSteps();
+	back.mSolveMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Hand the snapshot over and take back whichever one the renderer is
+	// not holding.
+	mBack = mReady.exchange(mBack | Fresh, std::memory_order_acq_rel) & ~Fresh;
+	mRunning.store(false, std::memory_order_release);
+}
+
+void AsyncWaves::Publish(WaveSnapshot& snapshot)
+{
+	// The snapshot already holds the solution as of its own version; bring
+	// over only the tiles that changed since.
+	mRects.clear();
+	mWaves.DirtyRects(snapshot.mVersion, mRects);
+
+	int n = mWaves.ColumnCount();
+	int tileCols = (n + Waves::TileSize - 1) / Waves::TileSize;
+	std::uint64_t version = mWaves.Version();
+	for (const Waves::DirtyRect& r : mRects)
+	{
+		size_t count = r.Col1 - r.Col0;
+		for (int i = r.Row0; i < r.Row1; ++i)
+		{
+			size_t k = (size_t)i * n + r.Col0;
+			mWaves.CopyHeights((int)k, (int)count, &snapshot.mHeights[k]);
+			mWaves.CopyNormals((int)k, (int)count, &snapshot.mNormals[k]);
+		}
+
+		for (int ti = r.Row0 / Waves::TileSize; ti <= (r.Row1 - 1) / Waves::TileSize; ++ti)
+		{
+			for (int tj = r.Col0 / Waves::TileSize; tj <= (r.Col1 - 1) / Waves::TileSize; ++tj)
+				snapshot.mTileVersions[ti * tileCols + tj] = version;
+		}
+	}
+	snapshot.mVersion = version;
+}
+
+const WaveSnapshot& AsyncWaves::Acquire()
+{
+	if (mReady.load(std::memory_order_relaxed) & Fresh)
+		mFront = mReady.exchange(mFront, std::memory_order_acq_rel) & ~Fresh;
+	return mSnapshots[mFront];
+}
+
+float AsyncWaves::LatencySeconds()const
+{
+	return (float)(mRequestedTime - mSnapshots[mFront].mSimulatedTime);
+}
+
+long long AsyncWaves::DroppedSteps()const
+{
+	return mSnapshots[mFront].mDroppedSteps;
+}
+
+void AsyncWaves::Wait()
+{
+	mTasks.Wait();
+}
@@ -0,0 +1,126 @@
+//***************************************************************************************
+// AsyncWaves.h
+//
+// Runs a Waves simulation on a worker thread so the renderer never waits for
+// the solver.  Each job steps the grid and copies the tiles that changed into
+// a spare snapshot.  Three snapshots are rotated through one atomic index, so
+// publishing and acquiring never lock: the solver always has a snapshot to
+// write and the renderer always has the newest complete one to read.
+//***************************************************************************************
+
+#ifndef ASYNCWAVES_H
+#define ASYNCWAVES_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "Waves.h"
+
+// A completed solution.  Stays unchanged while the renderer holds it.
+class WaveSnapshot
+{
+public:
+    DirectX::XMFLOAT3 Position(int i)const
+    {
+        int row = i / mNumCols;
+        int col = i - row * mNumCols;
+        return DirectX::XMFLOAT3(-mHalfWidth + col * mSpatialStep, mHeights[i], mHalfDepth - row * mSpatialStep);
+    }
+
+    float Height(int i)const { return mHeights[i]; }
+    const DirectX::XMFLOAT3& Normal(int i)const { return mNormals[i]; }
+
+    // Waves::Version() this snapshot was taken at; see Waves::DirtyRects().
+    std::uint64_t Version()const { return mVersion; }
+    int DirtyRects(std::uint64_t version, std::vector<Waves::DirtyRect>& rects)const;
+
+    // Total dt the snapshot has simulated, and Waves::DroppedSteps() then.
+    double SimulatedTime()const { return mSimulatedTime; }
+    long long DroppedSteps()const { return mDroppedSteps; }
+
+    // Wall-clock time the job that produced it took.
+    float SolveMilliseconds()const { return mSolveMs; }
+
+private:
+    friend class AsyncWaves;
+
+    int mNumRows = 0;
+    int mNumCols = 0;
+    float mSpatialStep = 0.0f;
+    float mHalfWidth = 0.0f;
+    float mHalfDepth = 0.0f;
+
+    std::vector<float> mHeights;
+    std::vector<DirectX::XMFLOAT3> mNormals;
+    std::vector<std::uint64_t> mTileVersions;
+
+    std::uint64_t mVersion = 0;
+    double mSimulatedTime = 0.0;
+    long long mDroppedSteps = 0;
+    float mSolveMs = 0.0f;
+};
+
+class AsyncWaves
+{
+public:
+    // See the Waves constructor.  With no worker threads in jobs, Update()
+    // steps synchronously.  Snapshots are always fp32, whatever the storage.
+    AsyncWaves(int m, int n, float dx, float dt, float speed, float damping,
+        JobSystem& jobs = JobSystem::Default(), Waves::Storage storage = Waves::Storage::Full);
+    AsyncWaves(const AsyncWaves& rhs) = delete;
+    AsyncWaves& operator=(const AsyncWaves& rhs) = delete;
+    ~AsyncWaves();
+
+    // The grid, for its dimensions only: its heights and normals belong to
+    // the solver thread.  Read them through Acquire().
+    const Waves& Grid()const { return mWaves; }
+
+    // Render thread, once per frame.  Starts a job advancing the grid by
+    // all the time passed in since the previous job started, unless one is
+    // still running; then the time carries over to the next job.
+    void Update(float dt);
+
+    // Render thread.  Returns the newest completed snapshot, which stays
+    // valid until the next Acquire().
+    const WaveSnapshot& Acquire();
+
+    // Simulated time the acquired snapshot lags behind the time passed to
+    // Update(), in seconds.
+    float LatencySeconds()const;
+
+    // Steps dropped because the solver fell more than Waves::MaxCatchUpSteps
+    // behind, as of the acquired snapshot.
+    long long DroppedSteps()const;
+
+    // Thread-safe; see Waves::QueueDisturb().
+    bool QueueDisturb(const Waves::Disturbance& d) { return mWaves.QueueDisturb(d); }
+
+    // Blocks until the job in flight, if any, has published.
+    void Wait();
+
+private:
+    void Solve(float dt, double simulatedTime);
+    void Publish(WaveSnapshot& snapshot);
+
+private:
+    static const int Fresh = 4;     // set in mReady when it holds an unread snapshot
+
+    Waves mWaves;
+    JobSystem& mJobs;
+
+    WaveSnapshot mSnapshots[3];
+    std::atomic<int> mReady;        // index published last, plus Fresh
+    int mFront = 0;                 // render thread's
+    int mBack = 1;                  // solver's
+
+    // Render thread's.
+    double mRequestedTime = 0.0;
+    float mPendingTime = 0.0f;
+
+    std::atomic<bool> mRunning;
+    std::vector<Waves::DirtyRect> mRects;   // solver's scratch
+
+    TaskGroup mTasks;               // last, so it waits before the rest goes
+};
+
+#endif // ASYNCWAVES_H
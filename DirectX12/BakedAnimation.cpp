@@ -0,0 +1,151 @@
+//***************************************************************************************
+// BakedAnimation.cpp
+//***************************************************************************************
+
+#include "BakedAnimation.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+namespace
+{
+	inline XMVECTOR Load4(const float* p) { return XMLoadFloat4((const XMFLOAT4*)p); }
+	inline void Store4(float* p, FXMVECTOR v) { XMStoreFloat4((XMFLOAT4*)p, v); }
+}
+
+BakedClip::BakedClip(const XMFLOAT4X4* frames, int frameCount, int boneCount, float sampleTime)
+	: mBoneCount(boneCount), mFrameCount(frameCount), mSampleTime(sampleTime),
+	mStride((boneCount + 3) & ~3)
+{
+	assert(frameCount >= 1 && boneCount >= 0 && sampleTime > 0.0f);
+
+	// Padding bones are identity.
+	mData.assign((size_t)frameCount * ComponentCount * mStride, 0.0f);
+	for (int f = 0; f < frameCount; ++f)
+	{
+		float* data = mData.data() + (size_t)f * ComponentCount * mStride;
+		for (int b = 0; b < mStride; ++b)
+		{
+			data[Qw * mStride + b] = 1.0f;
+			data[Sx * mStride + b] = data[Sy * mStride + b] = data[Sz * mStride + b] = 1.0f;
+		}
+
+		for (int b = 0; b < boneCount; ++b)
+		{
+			XMVECTOR S, Q, T;
+			XMMatrixDecompose(&S, &Q, &T, XMLoadFloat4x4(&frames[(size_t)f * boneCount + b]));
+			Q = XMQuaternionNormalize(Q);
+
+			if (f > 0)
+			{
+				const float* prev = data - ComponentCount * mStride;
+				XMVECTOR prevQ = XMVectorSet(prev[Qx * mStride + b], prev[Qy * mStride + b],
+					prev[Qz * mStride + b], prev[Qw * mStride + b]);
+				if (XMVectorGetX(XMQuaternionDot(Q, prevQ)) < 0.0f)
+					Q = XMVectorNegate(Q);
+			}
+
+			XMFLOAT3 t, s;
+			XMFLOAT4 q;
+			XMStoreFloat3(&t, T);
+			XMStoreFloat4(&q, Q);
+			XMStoreFloat3(&s, S);
+			data[Tx * mStride + b] = t.x;
+			data[Ty * mStride + b] = t.y;
+			data[Tz * mStride + b] = t.z;
+			data[Qx * mStride + b] = q.x;
+			data[Qy * mStride + b] = q.y;
+			data[Qz * mStride + b] = q.z;
+			data[Qw * mStride + b] = q.w;
+			data[Sx * mStride + b] = s.x;
+			data[Sy * mStride + b] = s.y;
+			data[Sz * mStride + b] = s.z;
+		}
+	}
+}
+
+void BakedClip::Sample(float t, XMFLOAT4X4* pose)const
+{
+	Position p = Locate(t);
+
+	// Four bones per pass, one lane each.
+	XMVECTOR trs[ComponentCount];
+	for (int b = 0; b < mBoneCount; b += 4)
+	{
+		SampleBones(p, b, trs);
+		StoreBones(trs, std::min(mBoneCount - b, 4), pose + b);
+	}
+}
+
+BakedClip::Position BakedClip::Locate(float t, bool stepped)const
+{
+	float f = std::min(std::max(t / mSampleTime, 0.0f), (float)(mFrameCount - 1));
+
+	Position p;
+	p.Frame0 = std::min((int)f, std::max(mFrameCount - 2, 0));
+	p.Frame1 = std::min(p.Frame0 + 1, mFrameCount - 1);
+	p.Blend = f - p.Frame0;
+	if (stepped)
+	{
+		p.Frame0 = p.Frame1 = (int)f;
+		p.Blend = 0.0f;
+	}
+	return p;
+}
+
+void BakedClip::SampleBones(const Position& p, int firstBone, XMVECTOR* trs)const
+{
+	const float* a = Frame(p.Frame0) + firstBone;
+	const float* c = Frame(p.Frame1) + firstBone;
+	XMVECTOR s = XMVectorReplicate(p.Blend);
+	for (int k = 0; k < ComponentCount; ++k)
+		trs[k] = XMVectorLerpV(Load4(a + k * mStride), Load4(c + k * mStride), s);
+}
+
+void BakedClip::StoreBones(const XMVECTOR* trs, int count, XMFLOAT4X4* pose)
+{
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR two = XMVectorReplicate(2.0f);
+
+	XMVECTOR lengthSq = XMVectorMultiply(trs[Qx], trs[Qx]);
+	lengthSq = XMVectorMultiplyAdd(trs[Qy], trs[Qy], lengthSq);
+	lengthSq = XMVectorMultiplyAdd(trs[Qz], trs[Qz], lengthSq);
+	lengthSq = XMVectorMultiplyAdd(trs[Qw], trs[Qw], lengthSq);
+	XMVECTOR invLength = XMVectorReciprocalSqrt(lengthSq);
+	XMVECTOR x = XMVectorMultiply(trs[Qx], invLength);
+	XMVECTOR y = XMVectorMultiply(trs[Qy], invLength);
+	XMVECTOR z = XMVectorMultiply(trs[Qz], invLength);
+	XMVECTOR w = XMVectorMultiply(trs[Qw], invLength);
+
+	// Scale * rotation * translation, as XMMatrixAffineTransformation
+	// builds it: row r of the rotation matrix scaled by the scale's r.
+	XMVECTOR x2 = XMVectorMultiply(x, two), y2 = XMVectorMultiply(y, two), z2 = XMVectorMultiply(z, two);
+	XMVECTOR xx = XMVectorMultiply(x, x2), yy = XMVectorMultiply(y, y2), zz = XMVectorMultiply(z, z2);
+	XMVECTOR xy = XMVectorMultiply(x, y2), xz = XMVectorMultiply(x, z2), yz = XMVectorMultiply(y, z2);
+	XMVECTOR wx = XMVectorMultiply(w, x2), wy = XMVectorMultiply(w, y2), wz = XMVectorMultiply(w, z2);
+
+	XMMATRIX rows[4];
+	rows[0] = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(yy, zz)), trs[Sx]),
+		XMVectorMultiply(XMVectorAdd(xy, wz), trs[Sx]),
+		XMVectorMultiply(XMVectorSubtract(xz, wy), trs[Sx]),
+		g_XMZero));
+	rows[1] = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(XMVectorSubtract(xy, wz), trs[Sy]),
+		XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, zz)), trs[Sy]),
+		XMVectorMultiply(XMVectorAdd(yz, wx), trs[Sy]),
+		g_XMZero));
+	rows[2] = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(XMVectorAdd(xz, wy), trs[Sz]),
+		XMVectorMultiply(XMVectorSubtract(yz, wx), trs[Sz]),
+		XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, yy)), trs[Sz]),
+		g_XMZero));
+	rows[3] = XMMatrixTranspose(XMMATRIX(trs[Tx], trs[Ty], trs[Tz], one));
+
+	for (int l = 0; l < count; ++l)
+	{
+		for (int r = 0; r < 4; ++r)
+			Store4(pose[l].m[r], rows[r].r[l]);
+	}
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// BakedAnimation.h
+//
+// Playback of baked skeletal animation, one matrix per bone per frame as
+// Graphics::Fetch_bone_animations bakes it, at any time rather than only at
+// the baked frames.  The frames are decomposed once into translation,
+// rotation and scale; sampling blends the two frames around t, lerping
+// translation and scale and nlerping rotation, four bones at a time.
+//
+// Since playback no longer steps from frame to frame, clips can be baked at
+// a fraction of their source rate.
+//***************************************************************************************
+
+#ifndef BAKEDANIMATION_H
+#define BAKEDANIMATION_H
+
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+
+class BakedClip
+{
+public:
+    // Bone transform components, in the order SampleBones returns them.
+    enum Component { Tx, Ty, Tz, Qx, Qy, Qz, Qw, Sx, Sy, Sz, ComponentCount };
+
+    // The two frames around a time and how far it is from the first.
+    struct Position
+    {
+        int Frame0;
+        int Frame1;
+        float Blend;
+    };
+
+    BakedClip() = default;
+
+    // Decomposes frameCount x boneCount matrices, frame by frame, baked
+    // every sampleTime seconds.
+    BakedClip(const DirectX::XMFLOAT4X4* frames, int frameCount, int boneCount, float sampleTime);
+
+    int BoneCount()const { return mBoneCount; }
+    int FrameCount()const { return mFrameCount; }
+    float SampleTime()const { return mSampleTime; }
+    float Duration()const { return (mFrameCount - 1) * mSampleTime; }
+    size_t Bytes()const { return mData.size() * sizeof(float); }
+
+    // Writes the BoneCount() matrices at time t, in seconds from the first
+    // frame, to 'pose', in the layout of the source frames.  t is clamped
+    // to the clip.
+    void Sample(float t, DirectX::XMFLOAT4X4* pose)const;
+
+    // The frames around time t, clamped to the clip.  With 'stepped' the
+    // frame at or before t, unblended.
+    Position Locate(float t, bool stepped = false)const;
+
+    // The components of bones firstBone to firstBone + 3 at p, a bone per
+    // lane; firstBone is a multiple of four.  Bones past the last are
+    // identity.  Rotations are lerped, so not quite unit.
+    void SampleBones(const Position& p, int firstBone, DirectX::XMVECTOR* trs)const;
+
+    // Builds the affine matrices of 'count' (up to four) lanes of
+    // components, normalizing the rotations, into pose[0, count).
+    static void StoreBones(const DirectX::XMVECTOR* trs, int count, DirectX::XMFLOAT4X4* pose);
+
+private:
+    const float* Frame(int f)const { return mData.data() + (size_t)f * ComponentCount * mStride; }
+
+private:
+    int mBoneCount = 0;
+    int mFrameCount = 0;
+    float mSampleTime = 0.0f;
+
+    // Bones rounded up to a multiple of four.
+    int mStride = 0;
+
+    // Frame by frame, each component of every bone, mStride floats per
+    // component.  Each rotation is on the same side of the hypersphere as
+    // the bone's rotation in the frame before, so neighbours nlerp the
+    // short way without a check.
+    std::vector<float> mData;
+};
+
+#endif // BAKEDANIMATION_H
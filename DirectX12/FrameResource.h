@@ -55,6 +55,13 @@ struct SkinnedConstants
     DirectX::XMFLOAT4X4 BoneTransforms[128];
 };
 
+// Dual-quaternion palette for shaders compiled with DUAL_QUAT_SKINNING:
+// Real/Dual pairs per bone, half the size of SkinnedConstants.
+struct SkinnedDualQuatConstants
+{
+    DirectX::XMFLOAT4 BoneDualQuats[128 * 2];
+};
+
 struct SsaoConstants
 {
     DirectX::XMFLOAT4X4 Proj;
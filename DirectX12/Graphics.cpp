@@ -296,6 +296,7 @@ void Graphics::OnKeyboardInput(const GameTimer& gt)
             animation_index = 0;
         }
         std::cout << animation_name[animation_index] << std::endl;
+        PlayAnimation(animation_crossfade);
     }
 
     if (GetAsyncKeyState('J') & 0x0001)
@@ -498,8 +499,7 @@ void Graphics::UpdateReflectedPassCB(const GameTimer& gt)
 void Graphics::UpdateInstanceData(const GameTimer& gt)
 {
     XMMATRIX view = mCamera.GetView();
-    XMVECTOR viewVector = XMMatrixDeterminant(view);
-    XMMATRIX invView = XMMatrixInverse(&viewVector, view);
+    XMMATRIX invView = MathHelper::AffineInverse(view);
 
     auto currInstanceBuffer = mCurrFrameResource->InstanceBuffer.get();
     for (auto& e : mAllInstanceRitems)
@@ -512,8 +512,8 @@ void Graphics::UpdateInstanceData(const GameTimer& gt)
         {
             XMMATRIX world = XMLoadFloat4x4(&instanceData[i].World);
             XMMATRIX texTransform = XMLoadFloat4x4(&instanceData[i].TexTransform);
-            XMVECTOR worldVector = XMMatrixDeterminant(world);
-            XMMATRIX invWorld = XMMatrixInverse(&worldVector, world);
+            // Instance worlds are affine, so skip the general 4x4 inverse.
+            XMMATRIX invWorld = MathHelper::AffineInverse(world);
 
             // View space to the object's local space.
             XMMATRIX viewToLocal = XMMatrixMultiply(invView, invWorld);
@@ -624,28 +624,53 @@ void Graphics::UpdateSkinnedCBs(const GameTimer& gt)
     auto currSkinnedCB = mCurrFrameResource->SkinnedCB.get();
     SkinnedConstants skinnedConstants;
 
-        if (extra_animations[animation_name[animation_index]].size() > 0)
+        if (!animation_player.IsPlaying())
+        {
+            PlayAnimation(0.0f);
+        }
+
+        Skeletal_animation& animation = extra_animations[animation_name[animation_index]];
+        if (animation_player.IsPlaying())
+        {
+            _ASSERT_EXPR(animation_player.BoneCount() < MAX_BONES, L"'the number_of_bones' exceeds MAX_BONES.");
+            animation_player.SetStepped(!interpolate_animations);
+            animation_player.Evaluate(skinnedConstants.BoneTransforms);
+            animation_player.Advance(animation_tick);
+        }
+        else if (animation.FrameCount() > 0)
         {
-            int frame = extra_animations[animation_name[animation_index]].animation_tick /
-                extra_animations[animation_name[animation_index]].sampling_time;
-            if (frame > extra_animations[animation_name[animation_index]].size() - 1)
+            int frame = animation.animation_tick / animation.sampling_time;
+            if (frame > animation.FrameCount() - 1)
             {
                 frame = 0;
-                extra_animations[animation_name[animation_index]].animation_tick = 0;
+                animation.animation_tick = 0;
             }
-            std::vector<Bone>& skeletal = extra_animations[animation_name[animation_index]].at(frame);
+            std::vector<Bone>& skeletal = animation.at(frame);
             size_t number_of_bones = skeletal.size();
             _ASSERT_EXPR(number_of_bones < MAX_BONES, L"'the number_of_bones' exceeds MAX_BONES.");
             for (size_t i = 0; i < number_of_bones; i++)
             {
                 XMStoreFloat4x4(&skinnedConstants.BoneTransforms[i], XMLoadFloat4x4(&skeletal.at(i).transform));
             }
-            extra_animations[animation_name[animation_index]].animation_tick += animation_tick;
+            animation.animation_tick += animation_tick;
         }
 
     currSkinnedCB->CopyData(0, skinnedConstants);
 }
 
+void Graphics::PlayAnimation(float fade_time)
+{
+    const Skeletal_animation& animation = extra_animations[animation_name[animation_index]];
+    if (animation.compressed.FrameCount() > 0)
+    {
+        animation_player.Play(animation.compressed, fade_time);
+    }
+    else if (animation.baked.FrameCount() > 0)
+    {
+        animation_player.Play(animation.baked, fade_time);
+    }
+}
+
 void Graphics::LoadContents()
 {
     LoadFBX(fbx);
@@ -2119,7 +2144,7 @@ void Graphics::BuildInstanceRenderItems()
 
                 XMStoreFloat4x4(&skullRitem->Instances[index].TexTransform, XMMatrixScaling(2.0f, 2.0f, 1.0f));
                 //skullRitem->Instances[index].MaterialIndex = index % (mMaterials.size() - mModelMaterials.size());
-                skullRitem->Instances[index].MaterialIndex = (rand() % 4) + 3;
+                skullRitem->Instances[index].MaterialIndex = MathHelper::Rand(3, 6);
 
             }
         }
@@ -2800,7 +2825,7 @@ void Graphics::LoadFBX(const std::wstring filename)
     if (boneNodes.size() > 0)
     {
         scene->SetName(_filename.c_str());
-        Fetch_bone_animations(boneNodes, extra_animations);
+        Fetch_bone_animations(boneNodes, extra_animations, animation_bake_rate);
     }
     manager->Destroy();
     
@@ -2862,6 +2887,35 @@ void Graphics::Fetch_bone_animations(std::vector<FbxNode*> bone_nodes, std::map<
                 }
                 skeletal_animation.push_back(skeletal);
             }
+            if (!skeletal_animation.empty())
+            {
+                int frame_count = (int)skeletal_animation.size();
+                int bone_count = (int)bone_nodes.size();
+                std::vector<XMFLOAT4X4> frames((size_t)frame_count * bone_count);
+                for (int f = 0; f < frame_count; ++f)
+                {
+                    for (int b = 0; b < bone_count; ++b)
+                    {
+                        frames[(size_t)f * bone_count + b] = skeletal_animation[f][b].transform;
+                    }
+                }
+                if (compress_animations)
+                {
+                    skeletal_animation.compressed = CompressedClip(frames.data(), frame_count, bone_count,
+                        sampling_time, animation_compression);
+
+                    const CompressedClip::Statistics& stats = skeletal_animation.compressed.Stats();
+                    std::cout << skeletal_animation.name << ": " << stats.SourceBytes << " -> " << stats.CompressedBytes
+                        << " bytes (" << stats.Ratio() << ":1), max error " << stats.MaxError << std::endl;
+                }
+                else
+                {
+                    skeletal_animation.baked = BakedClip(frames.data(), frame_count, bone_count, sampling_time);
+                }
+
+                skeletal_animation.clear();
+                skeletal_animation.shrink_to_fit();
+            }
             skeletal_animations[skeletal_animation.name] = skeletal_animation;
 
         }
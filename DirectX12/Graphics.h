@@ -7,6 +7,9 @@
 #include "Waves.h"
 #include "FrameResource.h"
 #include "SkinnedData.h"
+#include "AnimationBlend.h"
+#include "AnimationCompression.h"
+#include "BakedAnimation.h"
 #include "ShadowMap.h"
 #include "FBXMesh.h"
 
@@ -74,6 +77,17 @@ struct Skeletal_animation : public std::vector<Skeletal>
 	float sampling_time = 1 / 24.0f;
 	float animation_tick = 0.0f;
 	std::string name;
+
+	// Once loaded, the baked frames are dropped and the clip is played from
+	// one of these instead.
+	CompressedClip compressed;
+	BakedClip baked;
+
+	int FrameCount()const
+	{
+		return compressed.FrameCount() > 0 ? compressed.FrameCount() :
+			baked.FrameCount() > 0 ? baked.FrameCount() : (int)size();
+	}
 };
 
 struct Mesh
@@ -99,6 +113,12 @@ struct SkinnedModelInstance
 	std::string ClipName;
 	float TimePos = 0.0f;
 
+	// Reused every frame so updating the pose does not allocate.
+	PoseScratch Scratch;
+
+	// Where this instance is in ClipName's keyframes.
+	AnimationCursor Cursor;
+
 	// Called every frame and increments the time position, interpolates the 
 	// animations for each bone based on the current animation clip, and 
 	// generates the final transforms which are ultimately set to the effect
@@ -107,12 +127,14 @@ struct SkinnedModelInstance
 	{
 		TimePos += dt;
 
+		const AnimationClip& clip = *SkinnedInfo->FindClip(ClipName);
+
 		// Loop animation
-		if (TimePos > SkinnedInfo->GetClipEndTime(ClipName))
+		if (TimePos > clip.GetClipEndTime())
 			TimePos = 0.0f;
 
 		// Compute the final transforms for this time position.
-		SkinnedInfo->GetFinalTransforms(ClipName, TimePos, FinalTransforms);
+		SkinnedInfo->GetFinalTransforms(clip, TimePos, Cursor, Scratch, FinalTransforms.data());
 	}
 };
 
@@ -217,6 +239,10 @@ private:
 
 	void UpdateSkinnedCBs(const GameTimer& gt);
 
+	// Fades animation_name[animation_index] in over what animation_player
+	// plays, across fade_time seconds; 0 cuts to it.
+	void PlayAnimation(float fade_time);
+
 	void LoadFBX(const std::wstring filename);
 
 	void Fetch_bone_animations(std::vector <FbxNode*> bone_nodes, std::map<std::string, Skeletal_animation>& skeletal_animations, u_int sampling_rate = 0);
@@ -358,6 +384,22 @@ private:
 	int animation_index = 0;
 	float animation_speed = 1.0f;
 
+	// Compress the clips Fetch_bone_animations bakes.  The error is in model
+	// units, centimetres for the Mixamo models: a tenth of a millimetre
+	// 10 cm from the bone.
+	bool compress_animations = true;
+	CompressedClip::Settings animation_compression = { 0.01f, 10.0f };
+
+	// Blend between baked frames rather than step from one to the next.
+	// That hides a low bake rate; 0 bakes at the source frame rate.
+	bool interpolate_animations = true;
+	u_int animation_bake_rate = 0;
+
+	// Plays the compressed or baked clips, crossfading animation_crossfade
+	// seconds when SPACE switches them.
+	AnimationPlayer animation_player;
+	float animation_crossfade = 0.3f;
+
 	std::map<std::string, Skeletal_animation> extra_animations;
 
 	// this matrix trnasforms coordinates of the initial pose from mesh space to global space
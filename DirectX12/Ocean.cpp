@@ -0,0 +1,471 @@
+//***************************************************************************************
+// Ocean.cpp
+//***************************************************************************************
+
+#include "Ocean.h"
+#include "../Common/Random.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const float kGravity = 9.81f;
+
+	// Columns one FFT task transforms; four SIMD lanes each.
+	const int kColumnBlock = 16;
+
+	// Side of the square blocks the transpose swaps.
+	const int kTransposeBlock = 32;
+
+	// Stores four SoA vectors (x, y, z) as four consecutive XMFLOAT3s.
+	inline void StoreFloat3x4(XMFLOAT3* out, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		XMMATRIX t = XMMatrixTranspose(XMMATRIX(x, y, z, g_XMZero));
+		XMStoreFloat3(&out[0], t.r[0]);
+		XMStoreFloat3(&out[1], t.r[1]);
+		XMStoreFloat3(&out[2], t.r[2]);
+		XMStoreFloat3(&out[3], t.r[3]);
+	}
+
+	inline XMVECTOR Load4(const float* p) { return XMLoadFloat4((const XMFLOAT4*)p); }
+	inline void Store4(float* p, FXMVECTOR v) { XMStoreFloat4((XMFLOAT4*)p, v); }
+
+	// Stores the complex spectrum a + i b of two real fields a and b, given
+	// as (aRe, aIm) and (bRe, bIm).  The inverse FFT of a Hermitian spectrum
+	// is real, so a lands in the real part of the result and b in the
+	// imaginary part.
+	inline void StorePair(float* re, float* im, FXMVECTOR aRe, FXMVECTOR aIm, FXMVECTOR bRe, GXMVECTOR bIm)
+	{
+		Store4(re, XMVectorSubtract(aRe, bIm));
+		Store4(im, XMVectorAdd(aIm, bRe));
+	}
+
+	// Transposes the n x n matrix m in place, block row bi of it.
+	void TransposeBlockRow(float* m, int n, int bi)
+	{
+		int b = std::min(kTransposeBlock, n);
+		int i0 = bi * b;
+		for (int j0 = i0; j0 < n; j0 += b)
+		{
+			for (int i = i0; i < i0 + b; ++i)
+			{
+				// On the diagonal block only the upper triangle swaps.
+				int jStart = j0 == i0 ? i + 1 : j0;
+				for (int j = jStart; j < j0 + b; ++j)
+					std::swap(m[i * n + j], m[j * n + i]);
+			}
+		}
+	}
+}
+
+Ocean::Ocean(const Settings& settings, JobSystem& jobs)
+{
+	int n = settings.Size;
+	assert(n >= 16 && (n & (n - 1)) == 0);
+
+	mSize = n;
+	while ((1 << mLog2Size) < n)
+		++mLog2Size;
+
+	mSpatialStep = settings.PatchSize / n;
+	mHalfWidth = 0.5f * settings.PatchSize;
+	mChoppiness = settings.Choppiness;
+	mFoamThreshold = settings.FoamThreshold;
+	mJobs = &jobs;
+
+	// Bin m holds wave number 2 pi m' / L with m' = m - N past the middle,
+	// so e^(i k x) at x = j L / N is e^(2 pi i m j / N) either way.
+	mWaveNumber.resize(n);
+	for (int m = 0; m < n; ++m)
+		mWaveNumber[m] = XM_2PI * (m < n / 2 ? m : m - n) / settings.PatchSize;
+
+	mTwiddleRe.resize(n / 2);
+	mTwiddleIm.resize(n / 2);
+	for (int k = 0; k < n / 2; ++k)
+	{
+		double a = 2.0 * 3.14159265358979323846 * k / n;
+		mTwiddleRe[k] = (float)cos(a);
+		mTwiddleIm[k] = (float)sin(a);
+	}
+
+	mBitReverse.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		int r = 0;
+		for (int b = 0; b < mLog2Size; ++b)
+			r |= ((i >> b) & 1) << (mLog2Size - 1 - b);
+		mBitReverse[i] = r;
+	}
+
+	// Rows run along x and columns along the row index of the grid, which
+	// points down world z; the wind is mirrored to match.
+	float windX = settings.WindDirection.x;
+	float windZ = -settings.WindDirection.y;
+	float windLength = sqrtf(windX * windX + windZ * windZ);
+	if (windLength > 0.0f)
+	{
+		windX /= windLength;
+		windZ /= windLength;
+	}
+	else
+	{
+		windX = 1.0f;
+		windZ = 0.0f;
+	}
+
+	float largest = settings.WindSpeed * settings.WindSpeed / kGravity;
+	float smallest = settings.SmallWaveCutoff / XM_2PI;
+
+	// Phillips spectrum P(k) = exp(-1 / (k L)^2) / k^4 |k.w|^2, with waves
+	// shorter than the cutoff faded out and those running against the wind
+	// damped.  Its overall scale is fixed below from the RMS height.
+	int count = n * n;
+	std::vector<float> h0Re(count), h0Im(count);
+	Random rng(settings.Seed);
+	for (int r = 0; r < n; ++r)
+	{
+		for (int c = 0; c < n; ++c)
+		{
+			float kx = mWaveNumber[r];
+			float kz = mWaveNumber[c];
+			float kSq = kx * kx + kz * kz;
+
+			float xiRe = rng.NextNormal();
+			float xiIm = rng.NextNormal();
+
+			float p = 0.0f;
+			if (kSq > 0.0f)
+			{
+				float kDotW = (kx * windX + kz * windZ) / sqrtf(kSq);
+				p = expf(-1.0f / (kSq * largest * largest)) / (kSq * kSq) * kDotW * kDotW;
+				p *= expf(-kSq * smallest * smallest);
+				if (kDotW < 0.0f)
+					p *= 0.07f;
+			}
+
+			float a = sqrtf(0.5f * p);
+			h0Re[r * n + c] = xiRe * a;
+			h0Im[r * n + c] = xiIm * a;
+		}
+	}
+
+	mH0Re.assign(count, 0.0f);
+	mH0Im.assign(count, 0.0f);
+	mH0ConjNegRe.assign(count, 0.0f);
+	mH0ConjNegIm.assign(count, 0.0f);
+	mOmega.assign(count, 0.0f);
+
+	// By Parseval, the mean of h^2 over the patch is the sum of |h(k, t)|^2,
+	// whose average over time is |h0(k)|^2 + |h0(-k)|^2.
+	double energy = 0.0;
+	for (int r = 0; r < n; ++r)
+	{
+		for (int c = 0; c < n; ++c)
+		{
+			// A Nyquist bin is its own mirror but for a different k; it
+			// cannot be made Hermitian, so it stays empty.
+			if (r == n / 2 || c == n / 2)
+				continue;
+
+			int k = r * n + c;
+			int neg = ((n - r) % n) * n + (n - c) % n;
+			mH0Re[k] = h0Re[k];
+			mH0Im[k] = h0Im[k];
+			mH0ConjNegRe[k] = h0Re[neg];
+			mH0ConjNegIm[k] = -h0Im[neg];
+
+			float kx = mWaveNumber[r];
+			float kz = mWaveNumber[c];
+			mOmega[k] = sqrtf(kGravity * sqrtf(kx * kx + kz * kz));
+
+			energy += (double)h0Re[k] * h0Re[k] + (double)h0Im[k] * h0Im[k] +
+				(double)h0Re[neg] * h0Re[neg] + (double)h0Im[neg] * h0Im[neg];
+		}
+	}
+
+	if (energy > 0.0)
+	{
+		float scale = (float)(settings.WaveHeight / sqrt(energy));
+		for (int k = 0; k < count; ++k)
+		{
+			mH0Re[k] *= scale;
+			mH0Im[k] *= scale;
+			mH0ConjNegRe[k] *= scale;
+			mH0ConjNegIm[k] *= scale;
+		}
+	}
+
+	SetTime(0.0f);
+}
+
+Ocean::~Ocean()
+{
+}
+
+int Ocean::RowCount()const
+{
+	return mSize;
+}
+
+int Ocean::ColumnCount()const
+{
+	return mSize;
+}
+
+int Ocean::VertexCount()const
+{
+	return mSize * mSize;
+}
+
+int Ocean::TriangleCount()const
+{
+	return (mSize - 1) * (mSize - 1) * 2;
+}
+
+float Ocean::Width()const
+{
+	return mSize * mSpatialStep;
+}
+
+float Ocean::Depth()const
+{
+	return mSize * mSpatialStep;
+}
+
+void Ocean::Update(float dt)
+{
+	SetTime(mTime + dt);
+}
+
+void Ocean::SetTime(float t)
+{
+	mTime = t;
+	Evaluate(t, mField);
+	++mVersion;
+}
+
+XMFLOAT3 Ocean::TangentX(int i)const
+{
+	const XMFLOAT3& n = mField.Normal(i);
+	float inv = 1.0f / sqrtf(n.x * n.x + n.y * n.y);
+	return XMFLOAT3(n.y * inv, -n.x * inv, 0.0f);
+}
+
+int Ocean::DirtyRects(std::uint64_t version, std::vector<Waves::DirtyRect>& rects)const
+{
+	if (version >= mVersion)
+		return 0;
+
+	Waves::DirtyRect r = { 0, mSize, 0, mSize };
+	rects.push_back(r);
+	return mSize * mSize;
+}
+
+void Ocean::Evaluate(float t, OceanField& field)const
+{
+	int n = mSize;
+	size_t planeSize = (size_t)n * n;
+	if (field.mSize != n)
+	{
+		field.mSize = n;
+		field.mDisplacement.resize(planeSize);
+		field.mNormals.resize(planeSize);
+		field.mFoam.resize(planeSize);
+		field.mPlanes.resize(2 * PlaneCount * planeSize);
+	}
+	field.mTime = t;
+
+	float* planes = field.mPlanes.data();
+	mJobs->ParallelForRange(0, n, [this, t, planes](int first, int last)
+		{
+			FillSpectrum(t, planes, first, last);
+		});
+
+	// The 2D inverse FFT is a 1D FFT down every column, a transpose, and
+	// again down every column.  The spectrum is laid out by kx then kz, so
+	// the result comes out by z then x, the grid's own order.
+	int blocks = n / std::min(kColumnBlock, n);
+	auto columns = [this, n, planeSize, planes, blocks](int task)
+	{
+		int p = task / blocks;
+		int c0 = (task - p * blocks) * std::min(kColumnBlock, n);
+		float* re = planes + 2 * p * planeSize;
+		InverseFftColumns(re, re + planeSize, c0, c0 + std::min(kColumnBlock, n));
+	};
+
+	mJobs->ParallelFor(0, PlaneCount * blocks, columns, 1);
+
+	int blockRows = n / std::min(kTransposeBlock, n);
+	mJobs->ParallelFor(0, 2 * PlaneCount * blockRows, [n, planeSize, planes, blockRows](int task)
+		{
+			int m = task / blockRows;
+			TransposeBlockRow(planes + m * planeSize, n, task - m * blockRows);
+		}, 1);
+
+	mJobs->ParallelFor(0, PlaneCount * blocks, columns, 1);
+
+	mJobs->ParallelForRange(0, n, [this, &field](int first, int last)
+		{
+			Resolve(field, first, last);
+		});
+}
+
+void Ocean::FillSpectrum(float t, float* planes, int first, int last)const
+{
+	int n = mSize;
+	size_t planeSize = (size_t)n * n;
+	XMVECTOR T = XMVectorReplicate(t);
+
+	for (int r = first; r < last; ++r)
+	{
+		XMVECTOR kx = XMVectorReplicate(mWaveNumber[r]);
+		XMVECTOR kxSq = XMVectorMultiply(kx, kx);
+		for (int c = 0; c < n; c += 4)
+		{
+			int k = r * n + c;
+
+			// h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t).
+			XMVECTOR s, co;
+			XMVectorSinCos(&s, &co, XMVectorMultiply(Load4(&mOmega[k]), T));
+			XMVECTOR aRe = Load4(&mH0Re[k]);
+			XMVECTOR aIm = Load4(&mH0Im[k]);
+			XMVECTOR bRe = Load4(&mH0ConjNegRe[k]);
+			XMVECTOR bIm = Load4(&mH0ConjNegIm[k]);
+			XMVECTOR hRe = XMVectorMultiply(XMVectorAdd(aRe, bRe), co);
+			hRe = XMVectorMultiplyAdd(XMVectorSubtract(bIm, aIm), s, hRe);
+			XMVECTOR hIm = XMVectorMultiply(XMVectorAdd(aIm, bIm), co);
+			hIm = XMVectorMultiplyAdd(XMVectorSubtract(aRe, bRe), s, hIm);
+
+			XMVECTOR kz = Load4(&mWaveNumber[c]);
+			XMVECTOR kSq = XMVectorMultiplyAdd(kz, kz, kxSq);
+			XMVECTOR invK = XMVectorSelect(XMVectorReciprocalSqrt(kSq), g_XMZero, XMVectorEqual(kSq, g_XMZero));
+
+			// Derivatives and displacements multiply h by i kx, i kz,
+			// -i kx / k, -i kz / k, kx^2 / k, kz^2 / k and kx kz / k.
+			XMVECTOR dx = XMVectorMultiply(kx, invK);
+			XMVECTOR dz = XMVectorMultiply(kz, invK);
+			XMVECTOR xx = XMVectorMultiply(kx, dx);
+			XMVECTOR zz = XMVectorMultiply(kz, dz);
+			XMVECTOR xz = XMVectorMultiply(kx, dz);
+			XMVECTOR nhRe = XMVectorNegate(hRe);
+			XMVECTOR nhIm = XMVectorNegate(hIm);
+
+			float* p = planes + k;
+			// (height, displacement x)
+			StorePair(p, p + planeSize, hRe, hIm,
+				XMVectorMultiply(dx, hIm), XMVectorMultiply(dx, nhRe));
+			p += 2 * planeSize;
+			// (displacement z, slope x)
+			StorePair(p, p + planeSize, XMVectorMultiply(dz, hIm), XMVectorMultiply(dz, nhRe),
+				XMVectorMultiply(kx, nhIm), XMVectorMultiply(kx, hRe));
+			p += 2 * planeSize;
+			// (slope z, d displacement x / dx)
+			StorePair(p, p + planeSize, XMVectorMultiply(kz, nhIm), XMVectorMultiply(kz, hRe),
+				XMVectorMultiply(xx, hRe), XMVectorMultiply(xx, hIm));
+			p += 2 * planeSize;
+			// (d displacement z / dz, d displacement x / dz)
+			StorePair(p, p + planeSize, XMVectorMultiply(zz, hRe), XMVectorMultiply(zz, hIm),
+				XMVectorMultiply(xz, hRe), XMVectorMultiply(xz, hIm));
+		}
+	}
+}
+
+void Ocean::InverseFftColumns(float* re, float* im, int first, int last)const
+{
+	int n = mSize;
+
+	for (int i = 0; i < n; ++i)
+	{
+		int j = mBitReverse[i];
+		if (j <= i)
+			continue;
+		for (int c = first; c < last; ++c)
+		{
+			std::swap(re[i * n + c], re[j * n + c]);
+			std::swap(im[i * n + c], im[j * n + c]);
+		}
+	}
+
+	// Radix-2 decimation in time; every butterfly runs across the block's
+	// columns four at a time.
+	for (int half = 1; half < n; half *= 2)
+	{
+		int stride = n / (2 * half);
+		for (int start = 0; start < n; start += 2 * half)
+		{
+			for (int k = 0; k < half; ++k)
+			{
+				XMVECTOR wRe = XMVectorReplicate(mTwiddleRe[k * stride]);
+				XMVECTOR wIm = XMVectorReplicate(mTwiddleIm[k * stride]);
+				float* aRe = re + (start + k) * n;
+				float* aIm = im + (start + k) * n;
+				float* bRe = aRe + half * n;
+				float* bIm = aIm + half * n;
+				for (int c = first; c < last; c += 4)
+				{
+					XMVECTOR xRe = Load4(&bRe[c]);
+					XMVECTOR xIm = Load4(&bIm[c]);
+					XMVECTOR tRe = XMVectorNegativeMultiplySubtract(xIm, wIm, XMVectorMultiply(xRe, wRe));
+					XMVECTOR tIm = XMVectorMultiplyAdd(xIm, wRe, XMVectorMultiply(xRe, wIm));
+					XMVECTOR uRe = Load4(&aRe[c]);
+					XMVECTOR uIm = Load4(&aIm[c]);
+					Store4(&aRe[c], XMVectorAdd(uRe, tRe));
+					Store4(&aIm[c], XMVectorAdd(uIm, tIm));
+					Store4(&bRe[c], XMVectorSubtract(uRe, tRe));
+					Store4(&bIm[c], XMVectorSubtract(uIm, tIm));
+				}
+			}
+		}
+	}
+}
+
+void Ocean::Resolve(OceanField& field, int first, int last)const
+{
+	int n = mSize;
+	size_t planeSize = (size_t)n * n;
+	const float* planes = field.mPlanes.data();
+	XMVECTOR lambda = XMVectorReplicate(mChoppiness);
+	XMVECTOR threshold = XMVectorReplicate(mFoamThreshold);
+
+	for (int row = first; row < last; ++row)
+	{
+		for (int col = 0; col < n; col += 4)
+		{
+			int i = row * n + col;
+			XMVECTOR h = Load4(&planes[i]);
+			XMVECTOR dx = Load4(&planes[planeSize + i]);
+			XMVECTOR dz = Load4(&planes[2 * planeSize + i]);
+			XMVECTOR sx = Load4(&planes[3 * planeSize + i]);
+			XMVECTOR sz = Load4(&planes[4 * planeSize + i]);
+			XMVECTOR dxx = Load4(&planes[5 * planeSize + i]);
+			XMVECTOR dzz = Load4(&planes[6 * planeSize + i]);
+			XMVECTOR dxz = Load4(&planes[7 * planeSize + i]);
+
+			// The grid's rows run down world z, so z components flip sign.
+			dx = XMVectorMultiply(lambda, dx);
+			dz = XMVectorMultiply(lambda, dz);
+			StoreFloat3x4(&field.mDisplacement[i], dx, h, XMVectorNegate(dz));
+
+			// Tangents of the displaced surface along the rest x and z axes
+			// are (jxx, sx, jxz) and (jxz, sz, jzz); their cross product has
+			// the Jacobian of the displacement as its y.
+			XMVECTOR jxx = XMVectorMultiplyAdd(lambda, dxx, g_XMOne);
+			XMVECTOR jzz = XMVectorMultiplyAdd(lambda, dzz, g_XMOne);
+			XMVECTOR jxz = XMVectorMultiply(lambda, dxz);
+			XMVECTOR nx = XMVectorNegativeMultiplySubtract(jzz, sx, XMVectorMultiply(sz, jxz));
+			XMVECTOR ny = XMVectorNegativeMultiplySubtract(jxz, jxz, XMVectorMultiply(jxx, jzz));
+			XMVECTOR nz = XMVectorNegativeMultiplySubtract(jxz, sx, XMVectorMultiply(sz, jxx));
+			XMVECTOR invN = XMVectorReciprocalSqrt(
+				XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(ny, ny, XMVectorMultiply(nz, nz))));
+			StoreFloat3x4(&field.mNormals[i], XMVectorMultiply(nx, invN), XMVectorMultiply(ny, invN),
+				XMVectorMultiply(nz, invN));
+
+			// Where the surface is squeezed (Jacobian under the threshold)
+			// or folds over (negative), foam builds up.
+			Store4(&field.mFoam[i], XMVectorSaturate(XMVectorSubtract(threshold, ny)));
+		}
+	}
+}
@@ -0,0 +1,162 @@
+//***************************************************************************************
+// Ocean.h
+//
+// Spectral ocean surface after Tessendorf, "Simulating Ocean Water".  A
+// Phillips spectrum of wave amplitudes is drawn once; the surface at any
+// time t is then a closed-form function of t, evaluated with inverse FFTs.
+// Unlike Waves there is no state carried from step to step, so any frame
+// can be computed on its own, out of order, or several at once.  The
+// N x N patch tiles seamlessly in x and z.
+//
+// Ocean has the same vertex-output interface as Waves (Position, Normal,
+// Width, DirtyRects, ...), so Graphics::UpdateWaves can fill a vertex
+// buffer from either.
+//***************************************************************************************
+
+#ifndef OCEAN_H
+#define OCEAN_H
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "Waves.h"
+#include "../Common/JobSystem.h"
+
+// The surface at one time t: displaced positions, normals and foam of every
+// vertex, plus the FFT scratch planes that produced them.  A field can be
+// reused for any time and any Ocean of the same size.
+class OceanField
+{
+public:
+    int Size()const { return mSize; }
+    float Time()const { return mTime; }
+
+    // x, z offsets are added to the vertex's rest position; y is the height.
+    const DirectX::XMFLOAT3& Displacement(int i)const { return mDisplacement[i]; }
+    const DirectX::XMFLOAT3& Normal(int i)const { return mNormals[i]; }
+
+    // 0 where the surface is stretched or flat, up to 1 where choppy
+    // displacement folds it over: wave crests, where foam belongs.
+    float Foam(int i)const { return mFoam[i]; }
+
+private:
+    friend class Ocean;
+
+    int mSize = 0;
+    float mTime = 0.0f;
+
+    std::vector<DirectX::XMFLOAT3> mDisplacement;
+    std::vector<DirectX::XMFLOAT3> mNormals;
+    std::vector<float> mFoam;
+
+    // PlaneCount complex planes, each as a real then an imaginary N x N
+    // block.  Every plane carries two real fields, one in each part.
+    std::vector<float> mPlanes;
+};
+
+class Ocean
+{
+public:
+    struct Settings
+    {
+        int Size = 256;                 // vertices per side; a power of two >= 16
+        float PatchSize = 256.0f;       // side of the tile, in metres
+        DirectX::XMFLOAT2 WindDirection = DirectX::XMFLOAT2(1.0f, 0.0f);  // x, z; need not be unit
+        float WindSpeed = 20.0f;        // m/s; sets the longest waves (V^2 / g)
+        float WaveHeight = 1.0f;        // RMS height of the surface, in metres
+        float SmallWaveCutoff = 0.5f;   // wavelength in metres below which waves fade out
+        float Choppiness = 1.0f;        // horizontal displacement scale; 0 for round crests
+        float FoamThreshold = 1.0f;     // foam where the surface Jacobian falls below this
+        std::uint64_t Seed = 1;
+    };
+
+    explicit Ocean(const Settings& settings, JobSystem& jobs = JobSystem::Default());
+    Ocean(const Ocean& rhs) = delete;
+    Ocean& operator=(const Ocean& rhs) = delete;
+    ~Ocean();
+
+    // Computes the surface at time t into 'field', resizing it if need be.
+    // Only reads the Ocean, so calls with different fields may run at the
+    // same time, on any threads.
+    void Evaluate(float t, OceanField& field)const;
+
+    // The Waves interface, over a field the Ocean keeps for itself.
+    int RowCount()const;
+    int ColumnCount()const;
+    int VertexCount()const;
+    int TriangleCount()const;
+    float Width()const;
+    float Depth()const;
+
+    // Advances the time by dt and evaluates the surface there.
+    void Update(float dt);
+
+    // Evaluates the surface at time t.
+    void SetTime(float t);
+    float Time()const { return mTime; }
+
+    DirectX::XMFLOAT3 Position(int i)const
+    {
+        int row = i / mSize;
+        int col = i - row * mSize;
+        const DirectX::XMFLOAT3& d = mField.Displacement(i);
+        return DirectX::XMFLOAT3(-mHalfWidth + col * mSpatialStep + d.x, d.y, mHalfWidth - row * mSpatialStep + d.z);
+    }
+
+    const DirectX::XMFLOAT3& Normal(int i)const { return mField.Normal(i); }
+    DirectX::XMFLOAT3 TangentX(int i)const;
+    float Foam(int i)const { return mField.Foam(i); }
+    const OceanField& Field()const { return mField; }
+
+    // Every vertex moves each evaluation, so this is the whole grid or
+    // nothing.  See Waves::DirtyRects().
+    std::uint64_t Version()const { return mVersion; }
+    int DirtyRects(std::uint64_t version, std::vector<Waves::DirtyRect>& rects)const;
+
+private:
+    static const int PlaneCount = 4;
+
+    // Builds the spectrum of every plane at time t, rows [first, last).
+    void FillSpectrum(float t, float* planes, int first, int last)const;
+
+    // Inverse FFT along the rows' direction of every column of one plane,
+    // columns [first, last), a multiple of four.
+    void InverseFftColumns(float* re, float* im, int first, int last)const;
+
+    // Turns the spatial planes into displacement, normals and foam, rows
+    // [first, last).
+    void Resolve(OceanField& field, int first, int last)const;
+
+private:
+    int mSize = 0;
+    int mLog2Size = 0;
+    float mSpatialStep = 0.0f;
+    float mHalfWidth = 0.0f;
+    float mChoppiness = 0.0f;
+    float mFoamThreshold = 0.0f;
+
+    JobSystem* mJobs = nullptr;
+
+    // Per frequency bin, row-major by kx then kz: h0(k), conj(h0(-k)) and
+    // the angular frequency.  Bins that have no counterpart at -k (the
+    // Nyquist row and column) and k = 0 are zero.
+    std::vector<float> mH0Re;
+    std::vector<float> mH0Im;
+    std::vector<float> mH0ConjNegRe;
+    std::vector<float> mH0ConjNegIm;
+    std::vector<float> mOmega;
+
+    // Wave number of each bin index, the same along x and z.
+    std::vector<float> mWaveNumber;
+
+    // exp(2 pi i k / N) for k < N / 2, and the bit-reversal permutation.
+    std::vector<float> mTwiddleRe;
+    std::vector<float> mTwiddleIm;
+    std::vector<int> mBitReverse;
+
+    float mTime = 0.0f;
+    std::uint64_t mVersion = 0;
+    OceanField mField;
+};
+
+#endif // OCEAN_H
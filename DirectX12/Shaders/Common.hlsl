@@ -82,10 +82,51 @@ cbuffer cbPerObject : register(b0)
 	uint gObjPad2;
 };
 
+#ifdef DUAL_QUAT_SKINNING
+cbuffer cbSkinned : register(b1)
+{
+    // Real (rotation) and dual (0.5 * translation * real) part per bone.
+    float4 gBoneDualQuats[256];
+};
+
+// Dual-quaternion linear blend of four bones, taking the shortest path
+// relative to the first one.  Returns the normalized real part in real
+// and the matching dual part in dual.
+void BlendBoneDualQuats(float4 weights, uint4 indices, out float4 real, out float4 dual)
+{
+    float4 pivot = gBoneDualQuats[indices[0] * 2];
+    real = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    dual = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < 4; ++i)
+    {
+        float4 r = gBoneDualQuats[indices[i] * 2];
+        float4 d = gBoneDualQuats[indices[i] * 2 + 1];
+        float w = dot(pivot, r) < 0.0f ? -weights[i] : weights[i];
+        real += w * r;
+        dual += w * d;
+    }
+
+    float invLen = rsqrt(dot(real, real));
+    real *= invLen;
+    dual *= invLen;
+}
+
+float3 DualQuatRotate(float4 real, float3 v)
+{
+    return v + 2.0f * cross(real.xyz, cross(real.xyz, v) + real.w * v);
+}
+
+float3 DualQuatTransformPoint(float4 real, float4 dual, float3 p)
+{
+    float3 t = 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+    return DualQuatRotate(real, p) + t;
+}
+#else
 cbuffer cbSkinned : register(b1)
 {
     row_major float4x4 gBoneTransforms[128];
 };
+#endif
 
 
 // Constant data that varies per material.
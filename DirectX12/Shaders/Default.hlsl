@@ -47,7 +47,15 @@ VertexOut VS(VertexIn vin)
 	// Fetch the material data.
 	MaterialData matData = gMaterialData[gMaterialIndex];
 
-#ifdef SKINNED
+#if defined(SKINNED) && defined(DUAL_QUAT_SKINNING)
+
+	float4 real, dual;
+	BlendBoneDualQuats(vin.BoneWeights, vin.BoneIndices, real, dual);
+	vin.PosL = DualQuatTransformPoint(real, dual, vin.PosL);
+	vin.NormalL = DualQuatRotate(real, vin.NormalL);
+	vin.TangentL.xyz = DualQuatRotate(real, vin.TangentL.xyz);
+
+#elif defined(SKINNED)
 
 	float3 posL = { 0.0f, 0.0f, 0.0f };
 	float3 normalL = { 0.0f, 0.0f, 0.0f };
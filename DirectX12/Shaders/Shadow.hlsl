@@ -29,6 +29,11 @@ VertexOut VS(VertexIn vin)
 	weights[2] = vin.BoneWeights.z;
 	weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
 
+#ifdef DUAL_QUAT_SKINNING
+	float4 real, dual;
+	BlendBoneDualQuats(float4(weights[0], weights[1], weights[2], weights[3]), vin.BoneIndices, real, dual);
+	vin.PosL = DualQuatTransformPoint(real, dual, vin.PosL);
+#else
 	float3 posL = float3(0.0f, 0.0f, 0.0f);
 	for (int i = 0; i < 4; ++i)
 	{
@@ -39,6 +44,7 @@ VertexOut VS(VertexIn vin)
 	}
 
 	vin.PosL = posL;
+#endif
 #endif
 	// Transform to world space.
 	float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
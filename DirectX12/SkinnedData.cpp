@@ -2,6 +2,62 @@
 
 using namespace DirectX;
 
+namespace
+{
+	// The segment [time(i), time(i + 1)] holding t, time(0) < t < time(count - 1):
+	// the first i with t <= time(i + 1), as a scan from the start would find.
+	// Tries 'hint' and the few segments after it before a binary search.
+	template<typename TimeFn>
+	std::uint32_t FindKeySegment(TimeFn time, size_t count, float t, std::uint32_t hint)
+	{
+		const int MaxSteps = 4;
+
+		size_t i = hint;
+		if (i + 1 < count && t > time(i))
+		{
+			// t is past the start of segment i, so the answer is i or later.
+			for (int step = 0; step < MaxSteps; ++step, ++i)
+			{
+				if (t <= time(i + 1))
+					return (std::uint32_t)i;
+			}
+		}
+
+		// Lower bound of t in time(1) .. time(count - 1).
+		size_t lo = 1;
+		size_t hi = count - 1;
+		while (lo < hi)
+		{
+			size_t mid = lo + (hi - lo) / 2;
+			if (time(mid) < t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return (std::uint32_t)(lo - 1);
+	}
+
+	struct StoreTransposed
+	{
+		XMFLOAT4X4* out;
+
+		void operator()(size_t i, FXMMATRIX finalTransform)const
+		{
+			XMStoreFloat4x4(&out[i], XMMatrixTranspose(finalTransform));
+		}
+	};
+
+	struct StoreDualQuat
+	{
+		BoneDualQuat* out;
+
+		void operator()(size_t i, FXMMATRIX finalTransform)const
+		{
+			MathHelper::DualQuaternionFromMatrix(finalTransform, &out[i].Real, &out[i].Dual);
+		}
+	};
+}
+
 Keyframe::Keyframe()
 	: TimePos(0.0f),
 	Translation(0.0f, 0.0f, 0.0f),
@@ -30,59 +86,83 @@ float BoneAnimation::GetEndTime()const
 
 void BoneAnimation::Interpolate(float t, XMFLOAT4X4& M)const
 {
-	if (t <= Keyframes.front().TimePos)
+	XMStoreFloat4x4(&M, Interpolate(t));
+}
+
+XMMATRIX BoneAnimation::Interpolate(float t)const
+{
+	std::uint32_t key = 0;
+	return Interpolate(t, key);
+}
+
+XMMATRIX BoneAnimation::Interpolate(float t, std::uint32_t& key)const
+{
+	size_t count = Keyframes.size();
+	const float* times = KeyTimes.size() == count ? KeyTimes.data() : nullptr;
+	float startTime = times ? times[0] : Keyframes.front().TimePos;
+	float endTime = times ? times[count - 1] : Keyframes.back().TimePos;
+
+	if (t <= startTime)
 	{
 		XMVECTOR S = XMLoadFloat3(&Keyframes.front().Scale);
 		XMVECTOR P = XMLoadFloat3(&Keyframes.front().Translation);
 		XMVECTOR Q = XMLoadFloat4(&Keyframes.front().RotationQuat);
 
 		XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+		return XMMatrixAffineTransformation(S, zero, Q, P);
 	}
-	else if (t >= Keyframes.back().TimePos)
+	else if (t >= endTime)
 	{
 		XMVECTOR S = XMLoadFloat3(&Keyframes.back().Scale);
 		XMVECTOR P = XMLoadFloat3(&Keyframes.back().Translation);
 		XMVECTOR Q = XMLoadFloat4(&Keyframes.back().RotationQuat);
 
 		XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-		XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+		return XMMatrixAffineTransformation(S, zero, Q, P);
 	}
-	else
+	else if (t != t)
 	{
-		for (UINT i = 0; i < Keyframes.size() - 1; ++i)
-		{
-			if (t >= Keyframes[i].TimePos && t <= Keyframes[i + 1].TimePos)
-			{
-				float lerpPercent = (t - Keyframes[i].TimePos) / (Keyframes[i + 1].TimePos - Keyframes[i].TimePos);
+		// NaN compares false to both ends.
+		return XMMatrixIdentity();
+	}
 
-				XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
-				XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
+	size_t i;
+	if (times)
+		i = key = FindKeySegment([times](size_t k) { return times[k]; }, count, t, key);
+	else
+		i = key = FindKeySegment([this](size_t k) { return Keyframes[k].TimePos; }, count, t, key);
 
-				XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
-				XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
+	float lerpPercent = (t - Keyframes[i].TimePos) / (Keyframes[i + 1].TimePos - Keyframes[i].TimePos);
 
-				XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
-				XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
+	XMVECTOR s0 = XMLoadFloat3(&Keyframes[i].Scale);
+	XMVECTOR s1 = XMLoadFloat3(&Keyframes[i + 1].Scale);
 
-				XMVECTOR S = XMVectorLerp(s0, s1, lerpPercent);
-				XMVECTOR P = XMVectorLerp(p0, p1, lerpPercent);
-				XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerpPercent);
+	XMVECTOR p0 = XMLoadFloat3(&Keyframes[i].Translation);
+	XMVECTOR p1 = XMLoadFloat3(&Keyframes[i + 1].Translation);
 
-				XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-				XMStoreFloat4x4(&M, XMMatrixAffineTransformation(S, zero, Q, P));
+	XMVECTOR q0 = XMLoadFloat4(&Keyframes[i].RotationQuat);
+	XMVECTOR q1 = XMLoadFloat4(&Keyframes[i + 1].RotationQuat);
 
-				break;
-			}
-		}
-	}
+	XMVECTOR S = XMVectorLerp(s0, s1, lerpPercent);
+	XMVECTOR P = XMVectorLerp(p0, p1, lerpPercent);
+	XMVECTOR Q = XMQuaternionSlerp(q0, q1, lerpPercent);
+
+	XMVECTOR zero = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	return XMMatrixAffineTransformation(S, zero, Q, P);
+}
+
+void BoneAnimation::CacheKeyTimes()
+{
+	KeyTimes.resize(Keyframes.size());
+	for (size_t i = 0; i < Keyframes.size(); ++i)
+		KeyTimes[i] = Keyframes[i].TimePos;
 }
 
 float AnimationClip::GetClipStartTime()const
 {
 	// Find smallest start time over all bones in this clip.
 	float t = MathHelper::Infinity;
-	for (UINT i = 0; i < BoneAnimations.size(); ++i)
+	for (size_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		t = MathHelper::Min(t, BoneAnimations[i].GetStartTime());
 	}
@@ -94,7 +174,7 @@ float AnimationClip::GetClipEndTime()const
 {
 	// Find largest end time over all bones in this clip.
 	float t = 0.0f;
-	for (UINT i = 0; i < BoneAnimations.size(); ++i)
+	for (size_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		t = MathHelper::Max(t, BoneAnimations[i].GetEndTime());
 	}
@@ -104,12 +184,28 @@ float AnimationClip::GetClipEndTime()const
 
 void AnimationClip::Interpolate(float t, std::vector<XMFLOAT4X4>& boneTransforms)const
 {
-	for (UINT i = 0; i < BoneAnimations.size(); ++i)
+	for (size_t i = 0; i < BoneAnimations.size(); ++i)
 	{
 		BoneAnimations[i].Interpolate(t, boneTransforms[i]);
 	}
 }
 
+void AnimationClip::CacheKeyTimes()
+{
+	for (size_t i = 0; i < BoneAnimations.size(); ++i)
+		BoneAnimations[i].CacheKeyTimes();
+}
+
+std::uint32_t* AnimationCursor::Bind(const AnimationClip& clip)
+{
+	if (mClip != &clip || mKeys.size() != clip.BoneAnimations.size())
+	{
+		mClip = &clip;
+		mKeys.assign(clip.BoneAnimations.size(), 0);
+	}
+	return mKeys.data();
+}
+
 float SkinnedData::GetClipStartTime(const std::string& clipName)const
 {
 	auto clip = mAnimations.find(clipName);
@@ -122,9 +218,15 @@ float SkinnedData::GetClipEndTime(const std::string& clipName)const
 	return clip->second.GetClipEndTime();
 }
 
-UINT SkinnedData::BoneCount()const
+std::uint32_t SkinnedData::BoneCount()const
+{
+	return (std::uint32_t)mBoneHierarchy.size();
+}
+
+const AnimationClip* SkinnedData::FindClip(const std::string& clipName)const
 {
-	return mBoneHierarchy.size();
+	auto clip = mAnimations.find(clipName);
+	return clip != mAnimations.end() ? &clip->second : nullptr;
 }
 
 void SkinnedData::Set(std::vector<int>& boneHierarchy,
@@ -135,59 +237,96 @@ void SkinnedData::Set(std::vector<int>& boneHierarchy,
 	mBoneHierarchy = boneHierarchy;
 	mBoneOffsets = boneOffsets;
 	mAnimations = animations;
+	for (auto& clip : mAnimations)
+		clip.second.CacheKeyTimes();
 	mGlobalInverseTransform = globalInverseTransform;
 }
 
-void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos, std::vector<XMFLOAT4X4>& finalTransforms)const
+PoseScratch::PoseScratch(XMFLOAT4X4* memory, size_t capacity)
+	: mMemory(memory), mCapacity(capacity)
 {
-	UINT numBones = mBoneOffsets.size();
-
-	std::vector<XMFLOAT4X4> toParentTransforms(numBones);
-
-	// Interpolate all the bones of this clip at the given time instance.
-	auto clip = mAnimations.find(clipName);
-	clip->second.Interpolate(timePos, toParentTransforms);
-
-	//
-	// Traverse the hierarchy and transform all the bones to the root space.
-	//
+}
 
-	std::vector<XMFLOAT4X4> toRootTransforms(numBones);
+XMFLOAT4X4* PoseScratch::Get(size_t count)
+{
+	if (count <= mCapacity)
+		return mMemory;
 
-	// The root bone has index 0.  The root bone has no parent, so its toRootTransform
-	// is just its local bone transform.
-	//toRootTransforms[0] = toParentTransforms[0];
+	if (mOwned.size() < count)
+		mOwned.resize(count);
+	return mOwned.data();
+}
 
-	// Now find the toRootTransform of the children.
-	for (UINT i = 0; i < numBones; ++i)
+template<typename StoreFn>
+void SkinnedData::ForEachFinalTransform(const AnimationClip& clip, float timePos, std::uint32_t* keys,
+	PoseScratch& scratch, StoreFn store)const
+{
+	size_t numBones = mBoneOffsets.size();
+	size_t numAnimated = clip.BoneAnimations.size();
+	XMFLOAT4X4* toRootTransforms = scratch.Get(numBones);
+
+	// One pass down the hierarchy: interpolate the bone's local transform,
+	// take it to root space through its parent, which comes earlier, and
+	// premultiply by the bone offset.  Only the to-root transforms are kept,
+	// for the children.
+	for (size_t i = 0; i < numBones; ++i)
 	{
-		XMMATRIX toParent = XMLoadFloat4x4(&toParentTransforms[i]);
-
-		int parentIndex = mBoneHierarchy[i];
-
-
-		if (parentIndex == i)
+		XMMATRIX toParent = XMMatrixIdentity();
+		if (i < numAnimated)
 		{
-			XMStoreFloat4x4(&toRootTransforms[i], XMLoadFloat4x4(&toParentTransforms[i]));
+			toParent = keys ? clip.BoneAnimations[i].Interpolate(timePos, keys[i]) :
+				clip.BoneAnimations[i].Interpolate(timePos);
 		}
-		else
-		{
-			XMMATRIX parentToRoot = XMLoadFloat4x4(&toRootTransforms[parentIndex]);
-
-			XMMATRIX toRoot = XMMatrixMultiply(toParent, parentToRoot);
 
-			XMStoreFloat4x4(&toRootTransforms[i], toRoot);
-		}
-		
-	}
+		// The root bone is its own parent; its toRootTransform is just its
+		// local bone transform.
+		int parentIndex = mBoneHierarchy[i];
+		XMMATRIX toRoot = toParent;
+		if (parentIndex != (int)i)
+			toRoot = XMMatrixMultiply(toParent, XMLoadFloat4x4(&toRootTransforms[parentIndex]));
+		XMStoreFloat4x4(&toRootTransforms[i], toRoot);
 
-	// Premultiply by the bone offset transform to get the final transform.
-	for (UINT i = 0; i < numBones; ++i)
-	{
 		XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
-		XMMATRIX toRoot = XMLoadFloat4x4(&toRootTransforms[i]);
 		XMMATRIX finalTransform = XMMatrixMultiply(offset, toRoot);
 		//finalTransform = XMMatrixMultiply(finalTransform, XMLoadFloat4x4(&mGlobalInverseTransform));
-		XMStoreFloat4x4(&finalTransforms[i], XMMatrixTranspose(finalTransform));
+		store(i, finalTransform);
 	}
+}
+
+void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos, std::vector<XMFLOAT4X4>& finalTransforms)const
+{
+	// Per thread, so it only allocates the first time it meets a skeleton
+	// this size.
+	thread_local PoseScratch scratch;
+	GetFinalTransforms(*FindClip(clipName), timePos, scratch, finalTransforms.data());
+}
+
+void SkinnedData::GetFinalTransforms(const std::string& clipName, float timePos, std::vector<BoneDualQuat>& finalDualQuats)const
+{
+	thread_local PoseScratch scratch;
+	GetFinalTransforms(*FindClip(clipName), timePos, scratch, finalDualQuats.data());
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip, float timePos, PoseScratch& scratch,
+	XMFLOAT4X4* out)const
+{
+	ForEachFinalTransform(clip, timePos, nullptr, scratch, StoreTransposed{ out });
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip, float timePos, PoseScratch& scratch,
+	BoneDualQuat* out)const
+{
+	ForEachFinalTransform(clip, timePos, nullptr, scratch, StoreDualQuat{ out });
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip, float timePos, AnimationCursor& cursor,
+	PoseScratch& scratch, XMFLOAT4X4* out)const
+{
+	ForEachFinalTransform(clip, timePos, cursor.Bind(clip), scratch, StoreTransposed{ out });
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip, float timePos, AnimationCursor& cursor,
+	PoseScratch& scratch, BoneDualQuat* out)const
+{
+	ForEachFinalTransform(clip, timePos, cursor.Bind(clip), scratch, StoreDualQuat{ out });
 }
\ No newline at end of file
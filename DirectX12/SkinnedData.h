@@ -1,7 +1,11 @@
 #ifndef SKINNEDDATA_H
 #define SKINNEDDATA_H
 
-#include "../Common/d3dUtil.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "../Common/MathHelper.h"
 
 ///<summary>
@@ -31,8 +35,24 @@ struct BoneAnimation
 	float GetEndTime()const;
 
 	void Interpolate(float t, DirectX::XMFLOAT4X4& M)const;
+	DirectX::XMMATRIX Interpolate(float t)const;
+
+	// Same, but starts looking for the keyframes around t at segment 'key'
+	// (keys [key, key + 1]) and leaves the segment it found there.  Played
+	// forward, the next segment is nearly always the same one or the one
+	// after; seeks and loops fall back to a binary search.
+	DirectX::XMMATRIX Interpolate(float t, std::uint32_t& key)const;
+
+	// Copies the keyframe times into KeyTimes.  Call after changing
+	// Keyframes; SkinnedData::Set does it for every clip it is given.
+	void CacheKeyTimes();
 
 	std::vector<Keyframe> Keyframes;
+
+	// Keyframes[i].TimePos, packed so searching for a time does not pull
+	// the transforms into the cache.  Not used unless it has one entry per
+	// keyframe.
+	std::vector<float> KeyTimes;
 };
 
 ///<summary>
@@ -47,14 +67,73 @@ struct AnimationClip
 
 	void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
 
+	void CacheKeyTimes();
+
 	std::vector<BoneAnimation> BoneAnimations;
 };
 
+///<summary>
+/// Where an instance's playback of a clip is: for every bone, the keyframe
+/// segment the last sampled time fell in.  Sampling through a cursor makes
+/// forward playback O(1) per bone however long the clip.  One per animated
+/// instance; it starts over when used with a different clip.
+///</summary>
+class AnimationCursor
+{
+public:
+	// Returns one key per bone of 'clip', all zero if the cursor was last
+	// used with another clip.
+	std::uint32_t* Bind(const AnimationClip& clip);
+
+private:
+	const AnimationClip* mClip = nullptr;
+	std::vector<std::uint32_t> mKeys;
+};
+
+///<summary>
+/// A bone transform as a dual quaternion: Real is the rotation and
+/// Dual = 0.5 * translation * Real.  Half the size of a 4x4 matrix.
+///</summary>
+struct BoneDualQuat
+{
+	DirectX::XMFLOAT4 Real;
+	DirectX::XMFLOAT4 Dual;
+};
+
+///<summary>
+/// Working memory for SkinnedData::GetFinalTransforms: one to-root matrix
+/// per bone.  It either owns a buffer that grows to the largest skeleton
+/// seen, or wraps memory the caller provides (a per-frame arena, say), so
+/// evaluating poses in steady state never touches the heap.  One per
+/// thread; it is overwritten by every call.
+///</summary>
+class PoseScratch
+{
+public:
+	PoseScratch() = default;
+
+	// Uses 'capacity' matrices at 'memory', which must outlive it.  Falls
+	// back to a buffer of its own for skeletons that do not fit.
+	PoseScratch(DirectX::XMFLOAT4X4* memory, size_t capacity);
+
+	// Returns room for 'count' matrices.
+	DirectX::XMFLOAT4X4* Get(size_t count);
+
+private:
+	DirectX::XMFLOAT4X4* mMemory = nullptr;
+	size_t mCapacity = 0;
+	std::vector<DirectX::XMFLOAT4X4> mOwned;
+};
+
 class SkinnedData
 {
 public:
 
-	UINT BoneCount()const;
+	std::uint32_t BoneCount()const;
+
+	// nullptr if there is no such clip.  Look a clip up once and keep the
+	// pointer to save hashing its name every frame.
+	const AnimationClip* FindClip(const std::string& clipName)const;
 
 	float GetClipStartTime(const std::string& clipName)const;
 	float GetClipEndTime(const std::string& clipName)const;
@@ -71,7 +150,33 @@ public:
 	void GetFinalTransforms(const std::string& clipName, float timePos,
 		std::vector<DirectX::XMFLOAT4X4>& finalTransforms)const;
 
+	// Same as above, but outputs a dual-quaternion palette for shaders compiled
+	// with DUAL_QUAT_SKINNING.  Bone transforms are treated as rigid.
+	void GetFinalTransforms(const std::string& clipName, float timePos,
+		std::vector<BoneDualQuat>& finalDualQuats)const;
+
+	// Allocation-free versions: write BoneCount() transforms (transposed for
+	// the constant buffer) or dual quaternions to 'out', using 'scratch' for
+	// the to-root matrices.  Safe to call from several threads at once with
+	// different scratch.  The overloads above use a per-thread scratch.
+	void GetFinalTransforms(const AnimationClip& clip, float timePos, PoseScratch& scratch,
+		DirectX::XMFLOAT4X4* out)const;
+	void GetFinalTransforms(const AnimationClip& clip, float timePos, PoseScratch& scratch,
+		BoneDualQuat* out)const;
+
+	// Same, sampling the keyframes through the instance's playback cursor.
+	void GetFinalTransforms(const AnimationClip& clip, float timePos, AnimationCursor& cursor,
+		PoseScratch& scratch, DirectX::XMFLOAT4X4* out)const;
+	void GetFinalTransforms(const AnimationClip& clip, float timePos, AnimationCursor& cursor,
+		PoseScratch& scratch, BoneDualQuat* out)const;
+
 private:
+	// Calls store(i, offset * toRoot) for every bone i.  'keys' is a cursor's
+	// per-bone keys, or nullptr to search every bone from the start.
+	template<typename StoreFn>
+	void ForEachFinalTransform(const AnimationClip& clip, float timePos, std::uint32_t* keys,
+		PoseScratch& scratch, StoreFn store)const;
+
 	// Gives parentIndex of ith bone.
 	std::vector<int> mBoneHierarchy;
 
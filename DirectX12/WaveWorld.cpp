@@ -0,0 +1,135 @@
+//***************************************************************************************
+// WaveWorld.cpp
+//***************************************************************************************
+
+#include "WaveWorld.h"
+#include <algorithm>
+#include <cassert>
+
+WaveWorld::WaveWorld(JobSystem& jobs)
+	: mJobs(jobs)
+{
+	mBins.resize(jobs.Concurrency());
+	mBinCost.resize(jobs.Concurrency());
+}
+
+WaveWorld::~WaveWorld()
+{
+}
+
+int WaveWorld::Add(int m, int n, float dx, float dt, float speed, float damping, Waves::Storage storage)
+{
+	mGrids.emplace_back(new Waves(m, n, dx, dt, speed, damping, storage));
+	mGrids.back()->SetJobSystem(mJobs);
+	mStepsDue.push_back(0);
+	return (int)mGrids.size() - 1;
+}
+
+int WaveWorld::Count()const
+{
+	return (int)mGrids.size();
+}
+
+Waves& WaveWorld::Get(int index)
+{
+	assert(index >= 0 && index < Count());
+	return *mGrids[index];
+}
+
+const Waves& WaveWorld::Get(int index)const
+{
+	assert(index >= 0 && index < Count());
+	return *mGrids[index];
+}
+
+void WaveWorld::Update(float dt)
+{
+	bool pending = false;
+	for (size_t g = 0; g < mGrids.size(); ++g)
+	{
+		mStepsDue[g] = mGrids[g]->Advance(dt);
+		if (mStepsDue[g] > 0)
+			mGrids[g]->ApplyDisturbances();
+		pending |= mStepsDue[g] > 0;
+	}
+
+	// Usually one round; more only when a grid owes more than MaxSubsteps.
+	bool firstSweep = true;
+	while (pending)
+	{
+		mWork.clear();
+		for (size_t g = 0; g < mGrids.size(); ++g)
+		{
+			if (mStepsDue[g] == 0)
+				continue;
+
+			// Bands whose tiles have all settled cost nothing and are left out.
+			Waves& w = *mGrids[g];
+			w.BeginSweep(firstSweep);
+			int substeps = std::min(mStepsDue[g], (int)Waves::MaxSubsteps);
+			bool normals = mStepsDue[g] == substeps;
+			for (int band = 0; band < w.mBandCount; ++band)
+			{
+				long long cells = w.BandCost(band);
+				if (cells == 0)
+					continue;
+
+				Work work = { &w, band, substeps, normals, cells * substeps };
+				mWork.push_back(work);
+			}
+		}
+		firstSweep = false;
+
+		Balance();
+
+		// As in Waves::Sweep, every halo must be captured before any band
+		// writes.
+		mJobs.ParallelFor(0, (int)mBins.size(), [this](int bin)
+			{
+				for (const Work& w : mBins[bin])
+					w.Grid->SnapshotHalo(w.Band, w.Substeps);
+			}, mBinAffinity);
+
+		mJobs.ParallelFor(0, (int)mBins.size(), [this](int bin)
+			{
+				for (const Work& w : mBins[bin])
+					w.Grid->SweepBand(w.Band, w.Substeps, w.Normals);
+			}, mBinAffinity);
+
+		pending = false;
+		for (size_t g = 0; g < mGrids.size(); ++g)
+		{
+			if (mStepsDue[g] == 0)
+				continue;
+
+			int substeps = std::min(mStepsDue[g], (int)Waves::MaxSubsteps);
+			mGrids[g]->EndSweep(substeps, mStepsDue[g] == substeps);
+			mStepsDue[g] -= substeps;
+			pending |= mStepsDue[g] > 0;
+		}
+	}
+}
+
+void WaveWorld::Balance()
+{
+	// Longest processing time first: hand the most expensive band to the
+	// least loaded bin.  Deterministic, so an unchanged world maps to the
+	// same bins (and, through mBinAffinity, the same threads) every frame.
+	std::stable_sort(mWork.begin(), mWork.end(), [](const Work& a, const Work& b)
+		{
+			return a.Cost > b.Cost;
+		});
+
+	for (size_t b = 0; b < mBins.size(); ++b)
+	{
+		mBins[b].clear();
+		mBinCost[b] = 0;
+	}
+
+	for (const Work& w : mWork)
+	{
+		size_t best = std::min_element(mBinCost.begin(), mBinCost.end()) - mBinCost.begin();
+		mBins[best].push_back(w);
+		mBinCost[best] += w.Cost;
+	}
+}
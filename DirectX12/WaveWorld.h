@@ -0,0 +1,63 @@
+//***************************************************************************************
+// WaveWorld.h
+//
+// Owns any number of independent Waves grids (ponds, rivers, ...), each
+// with its own size, constants and fixed-timestep accumulator, and advances
+// all of them in one parallel pass per frame.
+//***************************************************************************************
+
+#ifndef WAVEWORLD_H
+#define WAVEWORLD_H
+
+#include <memory>
+#include <vector>
+#include "Waves.h"
+
+class WaveWorld
+{
+public:
+    explicit WaveWorld(JobSystem& jobs = JobSystem::Default());
+    WaveWorld(const WaveWorld& rhs) = delete;
+    WaveWorld& operator=(const WaveWorld& rhs) = delete;
+    ~WaveWorld();
+
+    // Adds an m x n grid (see the Waves constructor) and returns its index.
+    int Add(int m, int n, float dx, float dt, float speed, float damping,
+        Waves::Storage storage = Waves::Storage::Full);
+
+    int Count()const;
+    Waves& Get(int index);
+    const Waves& Get(int index)const;
+
+    // Advances every grid by the whole time steps its own accumulator has
+    // reached.  Bands from all grids that are due are balanced across
+    // threads by cell count, so one sweep round costs two parallel loops
+    // however many grids there are.
+    void Update(float dt);
+
+private:
+    struct Work
+    {
+        Waves* Grid;
+        int Band;
+        int Substeps;
+        bool Normals;
+        long long Cost;     // cells * substeps
+    };
+
+    void Balance();
+
+private:
+    JobSystem& mJobs;
+    std::vector<std::unique_ptr<Waves>> mGrids;
+
+    // Per-frame scratch, kept to avoid reallocating.
+    std::vector<int> mStepsDue;
+    std::vector<Work> mWork;
+    std::vector<std::vector<Work>> mBins;
+    std::vector<long long> mBinCost;
+
+    AffinityHint mBinAffinity;
+};
+
+#endif // WAVEWORLD_H
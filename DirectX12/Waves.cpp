@@ -3,15 +3,171 @@
 //***************************************************************************************
 
 #include "Waves.h"
-#include <ppl.h>
+#include "../Common/JobSystem.h"
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 
-Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
+namespace
 {
+	// Stores four SoA vectors (x, y, z) as four consecutive XMFLOAT3s.
+	inline void StoreFloat3x4(XMFLOAT3* out, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+	{
+		XMMATRIX t = XMMatrixTranspose(XMMATRIX(x, y, z, g_XMZero));
+		XMStoreFloat3(&out[0], t.r[0]);
+		XMStoreFloat3(&out[1], t.r[1]);
+		XMStoreFloat3(&out[2], t.r[2]);
+		XMStoreFloat3(&out[3], t.r[3]);
+	}
+
+	// Height storage: float, or HALF converted on load and store.
+	inline XMVECTOR LoadHeights4(const float* p) { return XMLoadFloat4((const XMFLOAT4*)p); }
+	inline XMVECTOR LoadHeights4(const HALF* p) { return XMLoadHalf4((const XMHALF4*)p); }
+	inline void StoreHeights4(float* p, FXMVECTOR v) { XMStoreFloat4((XMFLOAT4*)p, v); }
+	inline void StoreHeights4(HALF* p, FXMVECTOR v) { XMStoreHalf4((XMHALF4*)p, v); }
+	inline float LoadHeight(float h) { return h; }
+	inline float LoadHeight(HALF h) { return XMConvertHalfToFloat(h); }
+	inline void StoreHeight(float& h, float v) { h = v; }
+	inline void StoreHeight(HALF& h, float v) { h = XMConvertFloatToHalf(v); }
+
+	// Octahedral normal: the normal is projected onto the octahedron
+	// |x| + |y| + |z| = 1 and its x and z kept as two snorm16s.  Wave normals
+	// always point up (y = 2dx before normalizing), so the upper half of the
+	// octahedron is enough and y = 1 - |x| - |z|.  x and z are given already
+	// scaled to [-32767, 32767] and rounded.
+	inline std::uint32_t PackOctahedral(float x, float z)
+	{
+		return (std::uint32_t)(std::uint16_t)(std::int16_t)(int)x |
+			((std::uint32_t)(std::uint16_t)(std::int16_t)(int)z << 16);
+	}
+
+	inline XMFLOAT3 UnpackOctahedral(std::uint32_t v)
+	{
+		float x = (std::int16_t)(v & 0xFFFF) * (1.0f / 32767.0f);
+		float z = (std::int16_t)(v >> 16) * (1.0f / 32767.0f);
+		float y = 1.0f - fabsf(x) - fabsf(z);
+		float inv = 1.0f / sqrtf(x * x + y * y + z * z);
+		return XMFLOAT3(x * inv, y * inv, z * inv);
+	}
+
+	// Stores the normals of four cells from the unnormalized (nx, 2dx, nz).
+	inline void StoreNormals4(XMFLOAT3* out, FXMVECTOR nx, FXMVECTOR nz, float twoDx)
+	{
+		XMVECTOR TwoDx = XMVectorReplicate(twoDx);
+		XMVECTOR lenSq = XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(nz, nz, XMVectorReplicate(twoDx * twoDx)));
+		XMVECTOR invN = XMVectorReciprocalSqrt(lenSq);
+		StoreFloat3x4(out, XMVectorMultiply(nx, invN), XMVectorMultiply(TwoDx, invN), XMVectorMultiply(nz, invN));
+	}
+
+	inline void StoreNormals4(std::uint32_t* out, FXMVECTOR nx, FXMVECTOR nz, float twoDx)
+	{
+		XMVECTOR l1 = XMVectorAdd(XMVectorAdd(XMVectorAbs(nx), XMVectorAbs(nz)), XMVectorReplicate(twoDx));
+		XMVECTOR scale = XMVectorDivide(XMVectorReplicate(32767.0f), l1);
+		XMFLOAT4 x, z;
+		XMStoreFloat4(&x, XMVectorRound(XMVectorMultiply(nx, scale)));
+		XMStoreFloat4(&z, XMVectorRound(XMVectorMultiply(nz, scale)));
+		out[0] = PackOctahedral(x.x, z.x);
+		out[1] = PackOctahedral(x.y, z.y);
+		out[2] = PackOctahedral(x.z, z.z);
+		out[3] = PackOctahedral(x.w, z.w);
+	}
+
+	inline void StoreNormal(XMFLOAT3& out, float nx, float nz, float twoDx)
+	{
+		float invN = 1.0f / sqrtf(nx * nx + nz * nz + twoDx * twoDx);
+		out = XMFLOAT3(nx * invN, twoDx * invN, nz * invN);
+	}
+
+	inline void StoreNormal(std::uint32_t& out, float nx, float nz, float twoDx)
+	{
+		float scale = 32767.0f / (fabsf(nx) + fabsf(nz) + twoDx);
+		out = PackOctahedral(nearbyintf(nx * scale), nearbyintf(nz * scale));
+	}
+
+	// Five-point update of columns [j0, j1) of one row, four at a time:
+	// prev = k1*prev + k2*curr + k3*(up + down + left + right).
+	// up/curr/down are rows i-1, i, i+1 of the current solution.
+	template<typename H>
+	void StencilRow(H* prev, const H* up, const H* curr, const H* down,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		XMVECTOR K1 = XMVectorReplicate(k1);
+		XMVECTOR K2 = XMVectorReplicate(k2);
+		XMVECTOR K3 = XMVectorReplicate(k3);
+
+		int j = j0;
+		for (; j + 4 <= j1; j += 4)
+		{
+			XMVECTOR sum = XMVectorAdd(
+				XMVectorAdd(LoadHeights4(&up[j]), LoadHeights4(&down[j])),
+				XMVectorAdd(LoadHeights4(&curr[j - 1]), LoadHeights4(&curr[j + 1])));
+
+			XMVECTOR h = XMVectorMultiply(K1, LoadHeights4(&prev[j]));
+			h = XMVectorMultiplyAdd(K2, LoadHeights4(&curr[j]), h);
+			h = XMVectorMultiplyAdd(K3, sum, h);
+			StoreHeights4(&prev[j], h);
+		}
+		for (; j < j1; ++j)
+		{
+			float sum = (LoadHeight(up[j]) + LoadHeight(down[j])) + (LoadHeight(curr[j - 1]) + LoadHeight(curr[j + 1]));
+			StoreHeight(prev[j], k3 * sum + (k2 * LoadHeight(curr[j]) + k1 * LoadHeight(prev[j])));
+		}
+	}
+
+	// Central-difference normals of columns [j0, j1) of one row:
+	// n = normalize(l - r, 2dx, b - t).
+	// Returns the largest |h| over those columns of curr and other, the
+	// row's previous time level, or of the height differences the normals
+	// see, which may reach into a neighbouring tile.
+	template<typename H, typename N>
+	float NormalRow(N* normals, const H* up, const H* curr, const H* down, const H* other,
+		int j0, int j1, float dx)
+	{
+		float twoDx = 2.0f * dx;
+		XMVECTOR maxAbs = g_XMZero;
+
+		int j = j0;
+		for (; j + 4 <= j1; j += 4)
+		{
+			XMVECTOR c = LoadHeights4(&curr[j]);
+			XMVECTOR o = LoadHeights4(&other[j]);
+			maxAbs = XMVectorMax(maxAbs, XMVectorMax(XMVectorAbs(c), XMVectorAbs(o)));
+
+			XMVECTOR l = LoadHeights4(&curr[j - 1]);
+			XMVECTOR r = LoadHeights4(&curr[j + 1]);
+			XMVECTOR t = LoadHeights4(&up[j]);
+			XMVECTOR b = LoadHeights4(&down[j]);
+
+			XMVECTOR nx = XMVectorSubtract(l, r);
+			XMVECTOR nz = XMVectorSubtract(b, t);
+			maxAbs = XMVectorMax(maxAbs, XMVectorMax(XMVectorAbs(nx), XMVectorAbs(nz)));
+			StoreNormals4(&normals[j], nx, nz, twoDx);
+		}
+
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, maxAbs);
+		float result = std::max(std::max(lanes.x, lanes.y), std::max(lanes.z, lanes.w));
+		for (; j < j1; ++j)
+		{
+			result = std::max(result, std::max(fabsf(LoadHeight(curr[j])), fabsf(LoadHeight(other[j]))));
+
+			float nx = LoadHeight(curr[j - 1]) - LoadHeight(curr[j + 1]);
+			float nz = LoadHeight(down[j]) - LoadHeight(up[j]);
+			result = std::max(result, std::max(fabsf(nx), fabsf(nz)));
+			StoreNormal(normals[j], nx, nz, twoDx);
+		}
+		return result;
+	}
+}
+
+Waves::Waves(int m, int n, float dx, float dt, float speed, float damping, Storage storage)
+{
+	mStorage = storage;
 	mNumRows = m;
 	mNumCols = n;
 
@@ -27,34 +183,66 @@ Waves::Waves(int m, int n, float dx, float dt, float speed, float damping)
 	mK2 = (4.0f - 8.0f * e) / d;
 	mK3 = (2.0f * e) / d;
 
-	mPrevSolution.resize(m * n);
-	mCurrSolution.resize(m * n);
-	mNormals.resize(m * n);
-	mTangentX.resize(m * n);
+	mHalfWidth = (n - 1) * dx * 0.5f;
+	mHalfDepth = (m - 1) * dx * 0.5f;
 
-	// Generate grid vertices in system memory.
-
-	float halfWidth = (n - 1) * dx * 0.5f;
-	float halfDepth = (m - 1) * dx * 0.5f;
-	for (int i = 0; i < m; ++i)
+	if (storage == Storage::Compact)
 	{
-		float z = halfDepth - i * dx;
-		for (int j = 0; j < n; ++j)
-		{
-			float x = -halfWidth + j * dx;
-
-			mPrevSolution[i * n + j] = XMFLOAT3(x, 0.0f, z);
-			mCurrSolution[i * n + j] = XMFLOAT3(x, 0.0f, z);
-			mNormals[i * n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			mTangentX[i * n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
-		}
+		mPrevHalf.assign(m * n, 0);
+		mCurrHalf.assign(m * n, 0);
+		mPackedNormals.assign(m * n, PackOctahedral(0.0f, 0.0f));
+	}
+	else
+	{
+		mPrevHeights.assign(m * n, 0.0f);
+		mCurrHeights.assign(m * n, 0.0f);
+		mNormals.assign(m * n, XMFLOAT3(0.0f, 1.0f, 0.0f));
 	}
+
+	mTileRows = (m + TileSize - 1) / TileSize;
+	mTileCols = (n + TileSize - 1) / TileSize;
+	int tileCount = mTileRows * mTileCols;
+	mTileActive.assign(tileCount, 0);
+	mTileSolve.assign(tileCount, 0);
+	mTileSeed.assign(tileCount, 0);
+	mTileMax.assign(tileCount, 0.0f);
+	mTileVersion.assign(tileCount, 0);
+	mSpanStart.assign(mTileRows + 1, 0);
+	mSpanCells.assign(mTileRows, 0);
+	mSpans.reserve((size_t)tileCount * 2);
+
+	SetJobSystem(JobSystem::Default());
+}
+
+void Waves::SetJobSystem(JobSystem& jobs)
+{
+	mJobs = &jobs;
+
+	// One band per thread, but tall enough that the rows each band
+	// recomputes around its edges stay a small fraction of its work, and
+	// a whole number of tile rows.
+	int interior = std::max(mNumRows - 2, 0);
+	int threads = jobs.Concurrency();
+	mBandRows = std::max((interior + threads - 1) / threads, 64);
+	mBandRows = (mBandRows + TileSize - 1) / TileSize * TileSize;
+	mBandCount = interior > 0 ? (mNumRows - 1 + mBandRows - 1) / mBandRows : 0;
+
+	size_t haloSize = (size_t)mBandCount * 2 * (2 * (MaxSubsteps + 1)) * mNumCols;
+	if (mStorage == Storage::Compact)
+		mHaloHalf.resize(haloSize);
+	else
+		mHalo.resize(haloSize);
 }
 
 Waves::~Waves()
 {
 }
 
+void Waves::SetSettleEpsilon(float epsilon)
+{
+	mSettleEpsilon = epsilon;
+}
+
 int Waves::RowCount()const
 {
 	return mNumRows;
@@ -85,72 +273,433 @@ float Waves::Depth()const
 	return mNumRows * mSpatialStep;
 }
 
+XMFLOAT3 Waves::Normal(int i)const
+{
+	return mStorage == Storage::Compact ? UnpackOctahedral(mPackedNormals[i]) : mNormals[i];
+}
+
+XMFLOAT3 Waves::TangentX(int i)const
+{
+	XMFLOAT3 n = Normal(i);
+	float inv = 1.0f / sqrtf(n.x * n.x + n.y * n.y);
+	return XMFLOAT3(n.y * inv, -n.x * inv, 0.0f);
+}
+
+void Waves::CopyHeights(int i, int count, float* out)const
+{
+	if (mStorage == Storage::Compact)
+		XMConvertHalfToFloatStream(out, sizeof(float), &mCurrHalf[i], sizeof(HALF), count);
+	else
+		memcpy(out, &mCurrHeights[i], count * sizeof(float));
+}
+
+void Waves::CopyNormals(int i, int count, XMFLOAT3* out)const
+{
+	if (mStorage == Storage::Compact)
+	{
+		for (int k = 0; k < count; ++k)
+			out[k] = UnpackOctahedral(mPackedNormals[i + k]);
+	}
+	else
+	{
+		memcpy(out, &mNormals[i], count * sizeof(XMFLOAT3));
+	}
+}
+
+void Waves::AddHeight(int i, float v)
+{
+	if (mStorage == Storage::Compact)
+		mCurrHalf[i] = XMConvertFloatToHalf(XMConvertHalfToFloat(mCurrHalf[i]) + v);
+	else
+		mCurrHeights[i] += v;
+}
+
 void Waves::Update(float dt)
 {
-	static float t = 0;
+	int steps = Advance(dt);
+	if (steps > 0)
+		Step(steps);
+}
 
+int Waves::Advance(float dt)
+{
 	// Accumulate time.
-	t += dt;
+	mAccumTime += dt;
 
-	// Only update the simulation at the specified time step.
-	if (t >= mTimeStep)
+	// Only update the simulation at the specified time step.  A frame that
+	// fell behind by several steps catches up in the same sweep.
+	int steps = (int)(mAccumTime / mTimeStep);
+	if (steps > MaxCatchUpSteps)
 	{
-		// Only update interior points; we use zero boundary conditions.
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-			//for(int i = 1; i < mNumRows-1; ++i)
+		mDroppedSteps += steps - MaxCatchUpSteps;
+		steps = MaxCatchUpSteps;
+		mAccumTime = 0.0f;
+	}
+	else
+	{
+		mAccumTime -= steps * mTimeStep;
+	}
+	return steps;
+}
+
+void Waves::Step(int steps)
+{
+	ApplyDisturbances();
+
+	bool firstSweep = true;
+	while (steps > 0)
+	{
+		int substeps = std::min(steps, (int)MaxSubsteps);
+		steps -= substeps;
+
+		// Normals are only needed for the final solution.
+		Sweep(substeps, firstSweep, steps == 0);
+		firstSweep = false;
+	}
+}
+
+void Waves::Sweep(int substeps, bool firstSweep, bool computeNormals)
+{
+	BeginSweep(firstSweep);
+
+	// Snapshot every band's halo before any band writes, then advance the
+	// bands independently.
+	mJobs->ParallelFor(0, mBandCount, [this, substeps](int band)
+		{
+			SnapshotHalo(band, substeps);
+		}, mBandAffinity);
+
+	mJobs->ParallelFor(0, mBandCount, [this, substeps, computeNormals](int band)
+		{
+			SweepBand(band, substeps, computeNormals);
+		}, mBandAffinity);
+
+	EndSweep(substeps, computeNormals);
+}
+
+void Waves::BeginSweep(bool firstSweep)
+{
+	// A disturbance travels at most one cell per substep and a sweep has at
+	// most MaxSubsteps <= TileSize of them, so during one sweep only the
+	// eight neighbours of a tile holding waves can pick any up.  Later
+	// sweeps of the same step grow the previous sweep's region again.
+	mTileSeed = firstSweep ? mTileActive : mTileSolve;
+
+	mSpans.clear();
+	for (int ti = 0; ti < mTileRows; ++ti)
+	{
+		mSpanStart[ti] = (int)mSpans.size();
+		mSpanCells[ti] = 0;
+
+		int a0 = std::max(ti - 1, 0);
+		int a1 = std::min(ti + 1, mTileRows - 1);
+		for (int tj = 0; tj < mTileCols; ++tj)
+		{
+			int b0 = std::max(tj - 1, 0);
+			int b1 = std::min(tj + 1, mTileCols - 1);
+			bool solve = false;
+			for (int a = a0; a <= a1 && !solve; ++a)
 			{
-				for (int j = 1; j < mNumCols - 1; ++j)
-				{
-					// After this update we will be discarding the old previous
-					// buffer, so overwrite that buffer with the new update.
-					// Note how we can do this inplace (read/write to same element) 
-					// because we won't need prev_ij again and the assignment happens last.
-
-					// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-					// Moreover, our +z axis goes "down"; this is just to 
-					// keep consistent with our row indices going down.
-
-					mPrevSolution[i * mNumCols + j].y =
-						mK1 * mPrevSolution[i * mNumCols + j].y +
-						mK2 * mCurrSolution[i * mNumCols + j].y +
-						mK3 * (mCurrSolution[(i + 1) * mNumCols + j].y +
-							mCurrSolution[(i - 1) * mNumCols + j].y +
-							mCurrSolution[i * mNumCols + j + 1].y +
-							mCurrSolution[i * mNumCols + j - 1].y);
-				}
-			});
+				for (int b = b0; b <= b1 && !solve; ++b)
+					solve = mTileSeed[a * mTileCols + b] != 0;
+			}
 
-		// We just overwrote the previous buffer with the new data, so
-		// this data needs to become the current solution and the old
-		// current solution becomes the new previous solution.
-		std::swap(mPrevSolution, mCurrSolution);
+			int t = ti * mTileCols + tj;
+			mTileSolve[t] = solve;
+			mTileMax[t] = 0.0f;
 
-		t = 0.0f; // reset time
+			int c0 = std::max(tj * TileSize, 1);
+			int c1 = std::min((tj + 1) * TileSize, mNumCols - 1);
+			if (!solve || c0 >= c1)
+				continue;
+
+			// Neighbouring tiles share one span.
+			if ((int)mSpans.size() > mSpanStart[ti] && mSpans.back() == c0)
+			{
+				mSpans.back() = c1;
+			}
+			else
+			{
+				mSpans.push_back(c0);
+				mSpans.push_back(c1);
+			}
+			mSpanCells[ti] += c1 - c0;
+		}
+	}
+	mSpanStart[mTileRows] = (int)mSpans.size();
+}
+
+void Waves::BandRows(int band, int& r0, int& r1)const
+{
+	r0 = std::max(band * mBandRows, 1);
+	r1 = std::min((band + 1) * mBandRows, mNumRows - 1);
+}
+
+long long Waves::BandCost(int band)const
+{
+	int r0, r1;
+	BandRows(band, r0, r1);
+
+	long long cells = 0;
+	for (int ti = r0 / TileSize; ti * TileSize < r1; ++ti)
+	{
+		int rows = std::min((ti + 1) * TileSize, r1) - std::max(ti * TileSize, r0);
+		cells += (long long)rows * mSpanCells[ti];
+	}
+	return cells;
+}
+
+void Waves::SnapshotHalo(int band, int substeps)
+{
+	// A band with nothing to solve needs no halo either.
+	if (BandCost(band) == 0)
+		return;
+
+	if (mStorage == Storage::Compact)
+		CopyHalo(band, substeps, mPrevHalf, mCurrHalf, mHaloHalf);
+	else
+		CopyHalo(band, substeps, mPrevHeights, mCurrHeights, mHalo);
+}
+
+template<typename H>
+void Waves::CopyHalo(int band, int substeps, const std::vector<H>& prev, const std::vector<H>& curr,
+	std::vector<H>& halo)
+{
+	int r0, r1;
+	BandRows(band, r0, r1);
+	int e0 = std::max(r0 - substeps - 1, 0);
+	int e1 = std::min(r1 + substeps + 1, mNumRows);
+
+	size_t rowBytes = mNumCols * sizeof(H);
+	H* haloPrev = &halo[(size_t)band * 2 * (2 * (MaxSubsteps + 1)) * mNumCols];
+	H* haloCurr = haloPrev + (2 * (MaxSubsteps + 1)) * mNumCols;
+	for (int i = e0; i < e1; ++i)
+	{
+		if (i == r0)
+			i = r1;
+		int slot = i < r0 ? i - e0 : (r0 - e0) + (i - r1);
+		memcpy(haloPrev + slot * mNumCols, &prev[i * mNumCols], rowBytes);
+		memcpy(haloCurr + slot * mNumCols, &curr[i * mNumCols], rowBytes);
+	}
+}
+
+void Waves::EndSweep(int substeps, bool computeNormals)
+{
+	// Odd substep counts leave the newest solution in the prev buffer.
+	if (substeps & 1)
+	{
+		std::swap(mPrevHeights, mCurrHeights);
+		std::swap(mPrevHalf, mCurrHalf);
+	}
+
+	if (computeNormals)
+		Settle();
+}
+
+void Waves::Settle()
+{
+	++mVersion;
+	mStats = Stats();
+
+	for (int ti = 0; ti < mTileRows; ++ti)
+	{
+		for (int tj = 0; tj < mTileCols; ++tj)
+		{
+			// Tiles that were not solved are flat and stay that way.
+			int t = ti * mTileCols + tj;
+			if (!mTileSolve[t])
+				continue;
+
+			bool dirty;
+			if (mTileMax[t] > mSettleEpsilon)
+			{
+				dirty = true;
+				mTileActive[t] = 1;
+				++mStats.ActiveTiles;
+			}
+			else
+			{
+				// Settled: flush what little is left so the tile can be
+				// skipped exactly.
+				dirty = mTileActive[t] || mTileMax[t] > 0.0f;
+				if (mTileMax[t] > 0.0f)
+					FlattenTile(ti, tj);
+				mTileActive[t] = 0;
+			}
+
+			if (dirty)
+			{
+				mTileVersion[t] = mVersion;
+				mStats.DirtyVertices += (std::min((ti + 1) * TileSize, mNumRows) - ti * TileSize) *
+					(std::min((tj + 1) * TileSize, mNumCols) - tj * TileSize);
+			}
+		}
+
+		int rows = std::min((ti + 1) * TileSize, mNumRows - 1) - std::max(ti * TileSize, 1);
+		mStats.SolvedCells += std::max(rows, 0) * mSpanCells[ti];
+	}
+
+	long long interior = (long long)std::max(mNumRows - 2, 0) * std::max(mNumCols - 2, 0);
+	if (interior > 0)
+		mStats.ActiveCellPercent = 100.0f * mStats.SolvedCells / interior;
+}
+
+void Waves::FlattenTile(int ti, int tj)
+{
+	int i0 = ti * TileSize;
+	int i1 = std::min(i0 + TileSize, mNumRows);
+	int j0 = tj * TileSize;
+	int j1 = std::min(j0 + TileSize, mNumCols);
+	for (int i = i0; i < i1; ++i)
+	{
+		int k = i * mNumCols;
+		if (mStorage == Storage::Compact)
+		{
+			std::fill(&mPrevHalf[k + j0], &mPrevHalf[k + j1], (HALF)0);
+			std::fill(&mCurrHalf[k + j0], &mCurrHalf[k + j1], (HALF)0);
+			std::fill(&mPackedNormals[k + j0], &mPackedNormals[k + j1], PackOctahedral(0.0f, 0.0f));
+		}
+		else
+		{
+			std::fill(&mPrevHeights[k + j0], &mPrevHeights[k + j1], 0.0f);
+			std::fill(&mCurrHeights[k + j0], &mCurrHeights[k + j1], 0.0f);
+			std::fill(&mNormals[k + j0], &mNormals[k + j1], XMFLOAT3(0.0f, 1.0f, 0.0f));
+		}
+	}
+}
+
+int Waves::DirtyRects(std::uint64_t version, std::vector<DirtyRect>& rects)const
+{
+	return CollectDirtyRects(mTileVersion.data(), mNumRows, mNumCols, version, rects);
+}
+
+int Waves::CollectDirtyRects(const std::uint64_t* tileVersions, int m, int n,
+	std::uint64_t version, std::vector<DirtyRect>& rects)
+{
+	int tileRows = (m + TileSize - 1) / TileSize;
+	int tileCols = (n + TileSize - 1) / TileSize;
+
+	int vertices = 0;
+	for (int ti = 0; ti < tileRows; ++ti)
+	{
+		const std::uint64_t* stamps = &tileVersions[ti * tileCols];
+		for (int tj = 0; tj < tileCols; ++tj)
+		{
+			if (stamps[tj] <= version)
+				continue;
+
+			// Merge a run of dirty tiles along the tile row.
+			int tjEnd = tj + 1;
+			while (tjEnd < tileCols && stamps[tjEnd] > version)
+				++tjEnd;
+
+			DirtyRect r;
+			r.Row0 = ti * TileSize;
+			r.Row1 = std::min(r.Row0 + TileSize, m);
+			r.Col0 = tj * TileSize;
+			r.Col1 = std::min(tjEnd * TileSize, n);
+			rects.push_back(r);
+			vertices += (r.Row1 - r.Row0) * (r.Col1 - r.Col0);
+
+			tj = tjEnd;
+		}
+	}
+	return vertices;
+}
+
+void Waves::SweepBand(int band, int substeps, bool computeNormals)
+{
+	// Temporal tiling.  Substep s overwrites row i of the buffer holding
+	// level s-2 with level s.  Each substep lags the previous one by a row,
+	// so when substep s reaches row i, substep s-1 has produced rows i-1..i+1
+	// and no longer needs level s-2 at row i.  Only a few rows of
+	// each buffer are live at once, so the band is streamed once per sweep
+	// rather than once per step.  Rows outside the band live in its halo
+	// copy, and the rows updated there shrink by one on each side per
+	// substep, except at the fixed grid boundary.  Only the column spans
+	// of each row's tile row that are being solved are touched; the rest
+	// of the row is zero in both buffers.
+	if (BandCost(band) == 0)
+		return;
+
+	if (mStorage == Storage::Compact)
+		SweepRows(band, substeps, computeNormals, mPrevHalf, mCurrHalf, mHaloHalf, mPackedNormals);
+	else
+		SweepRows(band, substeps, computeNormals, mPrevHeights, mCurrHeights, mHalo, mNormals);
+}
+
+template<typename H, typename N>
+void Waves::SweepRows(int band, int substeps, bool computeNormals, std::vector<H>& prevHeights,
+	std::vector<H>& currHeights, std::vector<H>& halo, std::vector<N>& normals)
+{
+	int r0, r1;
+	BandRows(band, r0, r1);
+	int e0 = std::max(r0 - substeps - 1, 0);
+	int e1 = std::min(r1 + substeps + 1, mNumRows);
+
+	H* haloPrev = &halo[(size_t)band * 2 * (2 * (MaxSubsteps + 1)) * mNumCols];
+	H* haloCurr = haloPrev + (2 * (MaxSubsteps + 1)) * mNumCols;
+
+	// Row i of the prev (level -1, 1, 3, ...) or curr (level 0, 2, ...) buffer.
+	auto row = [&](bool curr, int i) -> H*
+	{
+		if (i >= r0 && i < r1)
+			return curr ? &currHeights[i * mNumCols] : &prevHeights[i * mNumCols];
+		int slot = i < r0 ? i - e0 : (r0 - e0) + (i - r1);
+		return (curr ? haloCurr : haloPrev) + slot * mNumCols;
+	};
+	auto first = [&](int s) { return e0 == 0 ? 1 : e0 + s; };
+	auto last = [&](int s) { return e1 == mNumRows ? mNumRows - 1 : e1 - s; };
+
+	bool finalInCurr = (substeps & 1) == 0;
+	for (int r = first(1); r < last(1) + substeps; ++r)
+	{
+		for (int s = 1; s <= substeps; ++s)
+		{
+			// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+			// Moreover, our +z axis goes "down"; this is just to 
+			// keep consistent with our row indices going down.
+			int i = r - (s - 1);
+			if (i < first(s) || i >= last(s))
+				continue;
+
+			bool srcCurr = (s & 1) != 0;
+			H* dst = row(!srcCurr, i);
+			const H* up = row(srcCurr, i - 1);
+			const H* curr = row(srcCurr, i);
+			const H* down = row(srcCurr, i + 1);
+
+			const int* span = mSpans.data() + mSpanStart[i / TileSize];
+			const int* spanEnd = mSpans.data() + mSpanStart[i / TileSize + 1];
+			for (; span != spanEnd; span += 2)
+				StencilRow(dst, up, curr, down, span[0], span[1], mK1, mK2, mK3);
+		}
 
 		//
-		// Compute normals using finite difference scheme.
+		// Compute normals using finite difference scheme, one row behind
+		// the last substep, and measure what is left in each tile.
 		//
-		concurrency::parallel_for(1, mNumRows - 1, [this](int i)
-			//for(int i = 1; i < mNumRows - 1; ++i)
+		int i = r - substeps;
+		if (computeNormals && i >= r0 && i < r1)
+		{
+			const H* up = row(finalInCurr, i - 1);
+			const H* curr = row(finalInCurr, i);
+			const H* down = row(finalInCurr, i + 1);
+			const H* other = row(!finalInCurr, i);
+
+			int ti = i / TileSize;
+			for (int tj = 0; tj < mTileCols; ++tj)
 			{
-				for (int j = 1; j < mNumCols - 1; ++j)
-				{
-					float l = mCurrSolution[i * mNumCols + j - 1].y;
-					float r = mCurrSolution[i * mNumCols + j + 1].y;
-					float t = mCurrSolution[(i - 1) * mNumCols + j].y;
-					float b = mCurrSolution[(i + 1) * mNumCols + j].y;
-					mNormals[i * mNumCols + j].x = -r + l;
-					mNormals[i * mNumCols + j].y = 2.0f * mSpatialStep;
-					mNormals[i * mNumCols + j].z = b - t;
-
-					XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&mNormals[i * mNumCols + j]));
-					XMStoreFloat3(&mNormals[i * mNumCols + j], n);
-
-					mTangentX[i * mNumCols + j] = XMFLOAT3(2.0f * mSpatialStep, r - l, 0.0f);
-					XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i * mNumCols + j]));
-					XMStoreFloat3(&mTangentX[i * mNumCols + j], T);
-				}
-			});
+				int t = ti * mTileCols + tj;
+				int c0 = std::max(tj * TileSize, 1);
+				int c1 = std::min((tj + 1) * TileSize, mNumCols - 1);
+				if (!mTileSolve[t] || c0 >= c1)
+					continue;
+
+				float h = NormalRow(&normals[i * mNumCols], up, curr, down, other, c0, c1, mSpatialStep);
+				mTileMax[t] = std::max(mTileMax[t], h);
+			}
+		}
 	}
 }
 
@@ -163,10 +712,101 @@ void Waves::Disturb(int i, int j, float magnitude)
 	float halfMag = 0.5f * magnitude;
 
 	// Disturb the ijth vertex height and its neighbors.
-	mCurrSolution[i * mNumCols + j].y += magnitude;
-	mCurrSolution[i * mNumCols + j + 1].y += halfMag;
-	mCurrSolution[i * mNumCols + j - 1].y += halfMag;
-	mCurrSolution[(i + 1) * mNumCols + j].y += halfMag;
-	mCurrSolution[(i - 1) * mNumCols + j].y += halfMag;
+	AddHeight(i * mNumCols + j, magnitude);
+	AddHeight(i * mNumCols + j + 1, halfMag);
+	AddHeight(i * mNumCols + j - 1, halfMag);
+	AddHeight((i + 1) * mNumCols + j, halfMag);
+	AddHeight((i - 1) * mNumCols + j, halfMag);
+
+	// Wake the tiles it touched.
+	++mVersion;
+	for (int ti = (i - 1) / TileSize; ti <= (i + 1) / TileSize; ++ti)
+	{
+		for (int tj = (j - 1) / TileSize; tj <= (j + 1) / TileSize; ++tj)
+		{
+			mTileActive[ti * mTileCols + tj] = 1;
+			mTileVersion[ti * mTileCols + tj] = mVersion;
+		}
+	}
+}
+
+bool Waves::QueueDisturb(const Disturbance& d)
+{
+	return mDisturbQueue.Push(d);
 }
 
+void Waves::ApplyDisturbances()
+{
+	std::uint64_t version = mVersion + 1;
+	bool applied = false;
+
+	Disturbance d;
+	while (mDisturbQueue.Pop(d))
+	{
+		// Footprint, clipped to the interior.
+		int ci = (int)floorf(d.Row + 0.5f);
+		int cj = (int)floorf(d.Col + 0.5f);
+		float radius = std::max(d.Radius, 0.0f);
+		int i0, i1, j0, j1;
+		if (d.Kernel == Brush::Cross)
+		{
+			i0 = std::max(ci - 1, 1);
+			i1 = std::min(ci + 1, mNumRows - 2);
+			j0 = std::max(cj - 1, 1);
+			j1 = std::min(cj + 1, mNumCols - 2);
+		}
+		else
+		{
+			i0 = std::max((int)ceilf(d.Row - radius), 1);
+			i1 = std::min((int)floorf(d.Row + radius), mNumRows - 2);
+			j0 = std::max((int)ceilf(d.Col - radius), 1);
+			j1 = std::min((int)floorf(d.Col + radius), mNumCols - 2);
+		}
+		if (i0 > i1 || j0 > j1)
+			continue;
+
+		float radiusSq = radius * radius;
+		float invTwoSigmaSq = radius > 0.0f ? 4.5f / radiusSq : 0.0f;
+		for (int i = i0; i <= i1; ++i)
+		{
+			int k = i * mNumCols;
+			float di = i - d.Row;
+			for (int j = j0; j <= j1; ++j)
+			{
+				float dj = j - d.Col;
+				float distSq = di * di + dj * dj;
+				switch (d.Kernel)
+				{
+				case Brush::Cross:
+					if (i == ci && j == cj)
+						AddHeight(k + j, d.Magnitude);
+					else if (i == ci || j == cj)
+						AddHeight(k + j, 0.5f * d.Magnitude);
+					break;
+				case Brush::Disk:
+					if (distSq <= radiusSq)
+						AddHeight(k + j, d.Magnitude);
+					break;
+				case Brush::Gaussian:
+					if (distSq <= radiusSq)
+						AddHeight(k + j, d.Magnitude * expf(-distSq * invTwoSigmaSq));
+					break;
+				}
+			}
+		}
+
+		// Wake the tiles it touched.
+		for (int ti = i0 / TileSize; ti <= i1 / TileSize; ++ti)
+		{
+			for (int tj = j0 / TileSize; tj <= j1 / TileSize; ++tj)
+			{
+				mTileActive[ti * mTileCols + tj] = 1;
+				mTileVersion[ti * mTileCols + tj] = version;
+			}
+		}
+		applied = true;
+	}
+
+	if (applied)
+		mVersion = version;
+}
@@ -0,0 +1,112 @@
+//
+//  DualQuaternion.cpp
+//
+
+#include "DualQuaternion.h"
+
+DualQuaternion::DualQuaternion( const Quaternion& rotation, const Vector3& translation )
+	: real(rotation)
+{
+	Quaternion t(translation.x, translation.y, translation.z, 0.0f);
+	dual = t * real * 0.5f;
+}
+
+void DualQuaternion::fromMatrix( const Matrix& m )
+{
+	fromMatrix(m.m);
+}
+
+void DualQuaternion::fromMatrix( const float* m )
+{
+	Vector3 T, S;
+	Matrix(m).Decompose(T, real, S);
+
+	Quaternion t(T.x, T.y, T.z, 0.0f);
+	dual = t * real * 0.5f;
+}
+
+void DualQuaternion::toMatrix( Matrix& m ) const
+{
+	Quaternion r = real;
+	r.toMatrix(m);
+	Vector3 t = getTranslation();
+	m._41 = t.x;
+	m._42 = t.y;
+	m._43 = t.z;
+}
+
+Vector3 DualQuaternion::getTranslation() const
+{
+	//	t = 2 * dual * conjugate(real)
+	Quaternion c(-real.x, -real.y, -real.z, real.w);
+	Quaternion t = dual * c;
+	return Vector3(t.x * 2.0f, t.y * 2.0f, t.z * 2.0f);
+}
+
+void DualQuaternion::normalize()
+{
+	float l = sqrtf(real.x*real.x + real.y*real.y + real.z*real.z + real.w*real.w);
+	if (l == 0.0f) return;
+	float s = 1.0f / l;
+	real *= s;
+	dual *= s;
+
+	//	Keep dual orthogonal to real so the result stays a rigid transform.
+	float d = real.x*dual.x + real.y*dual.y + real.z*dual.z + real.w*dual.w;
+	dual -= real * d;
+}
+
+Vector3 DualQuaternion::transformPoint( const Vector3& v ) const
+{
+	Vector3 p = transformNormal(v);
+	Vector3 t = getTranslation();
+	return Vector3(p.x + t.x, p.y + t.y, p.z + t.z);
+}
+
+Vector3 DualQuaternion::transformNormal( const Vector3& v ) const
+{
+	//	v + 2 * r.xyz x (r.xyz x v + r.w * v)
+	float cx = real.y*v.z - real.z*v.y + real.w*v.x;
+	float cy = real.z*v.x - real.x*v.z + real.w*v.y;
+	float cz = real.x*v.y - real.y*v.x + real.w*v.z;
+	return Vector3(
+		v.x + 2.0f * (real.y*cz - real.z*cy),
+		v.y + 2.0f * (real.z*cx - real.x*cz),
+		v.z + 2.0f * (real.x*cy - real.y*cx));
+}
+
+//*****************************************************************************
+//	Batch operations
+//*****************************************************************************
+void DualQuaternion::NormalizeArray( DualQuaternion* dq, int count )
+{
+	for (int i = 0; i < count; i++) dq[i].normalize();
+}
+
+void DualQuaternion::Blend( DualQuaternion& out, const DualQuaternion* palette,
+	const int* indices, const float* weights, int influences )
+{
+	const Quaternion& pivot = palette[indices[0]].real;
+	float r[4] = { 0, 0, 0, 0 };
+	float d[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < influences; i++)
+	{
+		const DualQuaternion& b = palette[indices[i]];
+		float w = weights[i];
+		if (pivot.x*b.real.x + pivot.y*b.real.y + pivot.z*b.real.z + pivot.w*b.real.w < 0.0f) w = -w;
+		r[0] += b.real.x * w; r[1] += b.real.y * w; r[2] += b.real.z * w; r[3] += b.real.w * w;
+		d[0] += b.dual.x * w; d[1] += b.dual.y * w; d[2] += b.dual.z * w; d[3] += b.dual.w * w;
+	}
+	out.real = Quaternion(r[0], r[1], r[2], r[3]);
+	out.dual = Quaternion(d[0], d[1], d[2], d[3]);
+	out.normalize();
+}
+
+void DualQuaternion::BlendArray( DualQuaternion* out, const DualQuaternion* palette,
+	const int* indices, const float* weights, int influences, int count )
+{
+	for (int i = 0; i < count; i++)
+	{
+		Blend(out[i], palette, indices + i * influences, weights + i * influences, influences);
+	}
+}
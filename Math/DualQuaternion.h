@@ -0,0 +1,55 @@
+#pragma once
+#include "Quaternion.h"
+
+//------------------------------------------------------
+//	Dual quaternion (rigid transform: rotation + translation)
+//------------------------------------------------------
+//	real is the rotation, dual = 0.5 * t * real.  Eight floats per bone
+//	instead of sixteen, and blending several of them (DLB) keeps the volume
+//	that linear blend skinning loses around twisting joints.
+class DualQuaternion
+{
+public:
+	Quaternion real;
+	Quaternion dual;
+
+	DualQuaternion() : real(0, 0, 0, 1), dual(0, 0, 0, 0) {}
+	DualQuaternion( const Quaternion& r, const Quaternion& d ) : real(r), dual(d) {}
+	DualQuaternion( const Quaternion& rotation, const Vector3& translation );
+
+	//	Rigid part of a row-vector matrix (translation in _41.._43).
+	//	Any scale is removed from the rotation rows.  The float* overload
+	//	takes 16 row-major floats, e.g. &XMFLOAT4X4::_11.
+	void fromMatrix( const Matrix& m );
+	void fromMatrix( const float* m );
+	void toMatrix( Matrix& m ) const;
+
+	Vector3 getTranslation() const;
+	void normalize();
+
+	Vector3 transformPoint( const Vector3& v ) const;
+	Vector3 transformNormal( const Vector3& v ) const;
+
+	//------------------------------------------------------
+	//	Batch operations
+	//------------------------------------------------------
+	static void NormalizeArray( DualQuaternion* dq, int count );
+
+	//	Dual-quaternion linear blend of influences bones (shortest path to
+	//	the first one), normalized.  indices/weights hold influences entries.
+	static void Blend( DualQuaternion& out, const DualQuaternion* palette,
+		const int* indices, const float* weights, int influences );
+
+	//	Blend for count vertices; indices/weights hold influences entries per
+	//	vertex, stored vertex after vertex.
+	static void BlendArray( DualQuaternion* out, const DualQuaternion* palette,
+		const int* indices, const float* weights, int influences, int count );
+
+	//	Composition: a * b applies b first, then a.
+	inline DualQuaternion operator *( const DualQuaternion& v ) const
+	{
+		return DualQuaternion( real * v.real, real * v.dual + dual * v.real );
+	}
+	inline DualQuaternion operator +( const DualQuaternion& v ) const { return DualQuaternion( real + v.real, dual + v.dual ); }
+	inline DualQuaternion operator *( float v ) const { return DualQuaternion( real * v, dual * v ); }
+};
@@ -0,0 +1,191 @@
+#pragma once
+#include <type_traits>
+
+//*****************************************************************************
+//	Element-wise expression templates for Matrix and Vector3
+//*****************************************************************************
+//	Matrix and Vector3 arithmetic returns values.  For a chained expression
+//	that should not build a temporary per operator, wrap the operands:
+//
+//		o = expr::lerp(a, b, t);
+//		o = expr::lazy(a) * s + expr::lazy(b) * t;
+//
+//	builds a tree of small nodes that is evaluated element by element, in
+//	one loop, when it is assigned to or constructs a Matrix or Vector3.  The
+//	operators below only apply when an operand is already a node.  Nodes
+//	hold sub-expressions by value and leaves by reference, so the operands
+//	must outlive the expression; lazy() refuses temporaries.
+//
+//	Everything is constexpr, so constant matrices can be built at compile
+//	time from other constexpr matrices.
+//
+//	Leaf types opt in by specializing expr::Leaf<T> with Size and get().
+namespace expr
+{
+	template<class T>
+	struct Leaf
+	{
+		static const bool value = false;
+	};
+
+	//	Base of every expression node.
+	struct Node {};
+
+	template<class T>
+	struct IsNode : std::is_base_of<Node, T> {};
+
+	template<class T>
+	struct IsOperand
+	{
+		static const bool value = IsNode<T>::value || Leaf<T>::value;
+	};
+
+	//------------------------------------------------------
+	//	Nodes
+	//------------------------------------------------------
+	template<class T>
+	struct Ref : Node
+	{
+		static const int Size = Leaf<T>::Size;
+		const T& v;
+		constexpr explicit Ref( const T& v ) : v(v) {}
+		constexpr float operator[]( int i ) const { return Leaf<T>::get(v, i); }
+	};
+
+	template<class L, class R>
+	struct Add : Node
+	{
+		static const int Size = L::Size;
+		L l; R r;
+		constexpr Add( const L& l, const R& r ) : l(l), r(r) {}
+		constexpr float operator[]( int i ) const { return l[i] + r[i]; }
+	};
+
+	template<class L, class R>
+	struct Sub : Node
+	{
+		static const int Size = L::Size;
+		L l; R r;
+		constexpr Sub( const L& l, const R& r ) : l(l), r(r) {}
+		constexpr float operator[]( int i ) const { return l[i] - r[i]; }
+	};
+
+	template<class E>
+	struct Scale : Node
+	{
+		static const int Size = E::Size;
+		E e; float s;
+		constexpr Scale( const E& e, float s ) : e(e), s(s) {}
+		constexpr float operator[]( int i ) const { return e[i] * s; }
+	};
+
+	template<class E>
+	struct Div : Node
+	{
+		static const int Size = E::Size;
+		E e; float s;
+		constexpr Div( const E& e, float s ) : e(e), s(s) {}
+		constexpr float operator[]( int i ) const { return e[i] / s; }
+	};
+
+	//------------------------------------------------------
+	//	Operand wrapping: leaves become Ref<T>, nodes pass through
+	//------------------------------------------------------
+	template<class T, bool = IsNode<T>::value>
+	struct Wrap
+	{
+		typedef T type;
+		static constexpr const T& make( const T& t ){ return t; }
+	};
+
+	template<class T>
+	struct Wrap<T, false>
+	{
+		typedef Ref<T> type;
+		static constexpr Ref<T> make( const T& t ){ return Ref<T>(t); }
+	};
+
+	template<class LW, class RW, bool = LW::Size == RW::Size>
+	struct BinaryOps {};
+
+	template<class LW, class RW>
+	struct BinaryOps<LW, RW, true>
+	{
+		typedef Add<LW, RW> AddType;
+		typedef Sub<LW, RW> SubType;
+	};
+
+	template<class L, class R, bool = IsOperand<L>::value && IsOperand<R>::value
+		&& (IsNode<L>::value || IsNode<R>::value)>
+	struct Binary {};
+
+	template<class L, class R>
+	struct Binary<L, R, true> : BinaryOps<typename Wrap<L>::type, typename Wrap<R>::type> {};
+
+	template<class E, bool = IsNode<E>::value>
+	struct Unary {};
+
+	template<class E>
+	struct Unary<E, true>
+	{
+		typedef Scale<typename Wrap<E>::type> ScaleType;
+		typedef Div<typename Wrap<E>::type> DivType;
+	};
+
+	//------------------------------------------------------
+	//	Operators, found by ADL on the node operand
+	//------------------------------------------------------
+	template<class L, class R>
+	constexpr typename Binary<L, R>::AddType operator + ( const L& l, const R& r )
+	{
+		return typename Binary<L, R>::AddType(Wrap<L>::make(l), Wrap<R>::make(r));
+	}
+
+	template<class L, class R>
+	constexpr typename Binary<L, R>::SubType operator - ( const L& l, const R& r )
+	{
+		return typename Binary<L, R>::SubType(Wrap<L>::make(l), Wrap<R>::make(r));
+	}
+
+	template<class E>
+	constexpr typename Unary<E>::ScaleType operator * ( const E& e, float s )
+	{
+		return typename Unary<E>::ScaleType(Wrap<E>::make(e), s);
+	}
+
+	template<class E>
+	constexpr typename Unary<E>::ScaleType operator * ( float s, const E& e )
+	{
+		return typename Unary<E>::ScaleType(Wrap<E>::make(e), s);
+	}
+
+	template<class E>
+	constexpr typename Unary<E>::DivType operator / ( const E& e, float s )
+	{
+		return typename Unary<E>::DivType(Wrap<E>::make(e), s);
+	}
+
+	//------------------------------------------------------
+	//	Explicit lazy forms
+	//------------------------------------------------------
+	template<class T, class = typename std::enable_if<Leaf<T>::value>::type>
+	constexpr Ref<T> lazy( const T& v ){ return Ref<T>(v); }
+
+	template<class T, class = typename std::enable_if<Leaf<T>::value>::type>
+	void lazy( const T&& ) = delete;
+
+	//	a * (1 - t) + b * t, for leaves or nodes.
+	template<class A, class B, class = typename std::enable_if<IsOperand<A>::value && IsOperand<B>::value>::type>
+	constexpr typename Binary<typename Unary<typename Wrap<A>::type>::ScaleType,
+		typename Unary<typename Wrap<B>::type>::ScaleType>::AddType
+	lerp( const A& a, const B& b, float t )
+	{
+		return Wrap<A>::make(a) * (1.0f - t) + Wrap<B>::make(b) * t;
+	}
+
+	template<class A, class B, class = typename std::enable_if<Leaf<A>::value>::type>
+	void lerp( const A&&, const B&, float ) = delete;
+
+	template<class A, class B, class = typename std::enable_if<Leaf<B>::value>::type>
+	void lerp( const A&, const B&&, float ) = delete;
+}
@@ -1,5 +1,6 @@
 #include "Matrix.h"
 #include "Quaternion.h"
+#include "Simd.h"
 
 //*****************************************************************************
 //
@@ -21,6 +22,47 @@ void Matrix::identity()
 //------------------------------------------------------
 void Matrix::multiply(const Matrix & mat1, const Matrix & mat2)
 {
+#if defined(MATH_SIMD_AVX)
+	//	Two rows per iteration; every row of mat2 is read before
+	//	anything is stored, so this may alias mat1 or mat2.
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)&mat2._11);
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)&mat2._21);
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)&mat2._31);
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)&mat2._41);
+
+	__m256 a01 = _mm256_loadu_ps(&mat1._11);
+	__m256 a23 = _mm256_loadu_ps(&mat1._31);
+
+	__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), b2));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), b3));
+
+	__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), b2));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), b3));
+
+	_mm256_storeu_ps(&_11, r01);
+	_mm256_storeu_ps(&_31, r23);
+#elif defined(MATH_SIMD_SSE) || defined(MATH_SIMD_NEON)
+	//	Row i of the result is a linear combination of the rows of mat2.
+	//	Row i of mat1 is consumed before row i is written, and mat2 is
+	//	held in registers, so this may alias mat1 or mat2.
+	simd::float4 b0 = simd::load(&mat2._11);
+	simd::float4 b1 = simd::load(&mat2._21);
+	simd::float4 b2 = simd::load(&mat2._31);
+	simd::float4 b3 = simd::load(&mat2._41);
+
+	for (int i = 0; i < 16; i += 4)
+	{
+		simd::float4 r = simd::mul(simd::splat(mat1.m[i + 0]), b0);
+		r = simd::madd(simd::splat(mat1.m[i + 1]), b1, r);
+		r = simd::madd(simd::splat(mat1.m[i + 2]), b2, r);
+		r = simd::madd(simd::splat(mat1.m[i + 3]), b3, r);
+		simd::store(&m[i], r);
+	}
+#else
 	Matrix work;
 	work._11 = mat1._11*mat2._11 + mat1._12*mat2._21 + mat1._13*mat2._31 + mat1._14*mat2._41;
 	work._12 = mat1._11*mat2._12 + mat1._12*mat2._22 + mat1._13*mat2._32 + mat1._14*mat2._42;
@@ -43,38 +85,132 @@ void Matrix::multiply(const Matrix & mat1, const Matrix & mat2)
 	work._44 = mat1._41*mat2._14 + mat1._42*mat2._24 + mat1._43*mat2._34 + mat1._44*mat2._44;
 
 	memcpy(&_11, &work._11, sizeof(Matrix));
-
+#endif
 }
 
 void Matrix::multiply(float val)
 {
+#if defined(MATH_SIMD_SCALAR)
 	_11 *= val; _12 *= val; _13 *= val; _14 *= val;
 	_21 *= val; _22 *= val; _23 *= val; _24 *= val;
 	_31 *= val; _32 *= val; _33 *= val; _34 *= val;
 	_41 *= val; _42 *= val; _43 *= val; _44 *= val;
+#else
+	simd::float4 s = simd::splat(val);
+	simd::store(&_11, simd::mul(simd::load(&_11), s));
+	simd::store(&_21, simd::mul(simd::load(&_21), s));
+	simd::store(&_31, simd::mul(simd::load(&_31), s));
+	simd::store(&_41, simd::mul(simd::load(&_41), s));
+#endif
 }
 
 void Matrix::inverse()
 {
+#if defined(MATH_SIMD_SSE)
+	//	Cramer's rule on the transposed matrix (Intel AP-928).
+	//	Each "minor" register accumulates one row of the adjugate.
+	__m128 minor0, minor1, minor2, minor3;
+	__m128 row0, row1, row2, row3;
+	__m128 det, tmp1;
+
+	tmp1 = _mm_setzero_ps();
+	row1 = _mm_setzero_ps();
+	row3 = _mm_setzero_ps();
+
+	tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (const __m64*)(m)), (const __m64*)(m + 4));
+	row1 = _mm_loadh_pi(_mm_loadl_pi(row1, (const __m64*)(m + 8)), (const __m64*)(m + 12));
+	row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+	row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+	tmp1 = _mm_loadh_pi(_mm_loadl_pi(tmp1, (const __m64*)(m + 2)), (const __m64*)(m + 6));
+	row3 = _mm_loadh_pi(_mm_loadl_pi(row3, (const __m64*)(m + 10)), (const __m64*)(m + 14));
+	row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+	row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+
+	tmp1 = _mm_mul_ps(row2, row3);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	minor0 = _mm_mul_ps(row1, tmp1);
+	minor1 = _mm_mul_ps(row0, tmp1);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+	minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+	minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+	tmp1 = _mm_mul_ps(row1, row2);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+	minor3 = _mm_mul_ps(row0, tmp1);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+	minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+	minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+	tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+	minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+	minor2 = _mm_mul_ps(row0, tmp1);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+	minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+	minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+	tmp1 = _mm_mul_ps(row0, row1);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+	minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+	minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+
+	tmp1 = _mm_mul_ps(row0, row3);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+	minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+	minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+
+	tmp1 = _mm_mul_ps(row0, row2);
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+	minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+	minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+	tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+	minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+	minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+
+	//	Same reciprocal as the scalar path (a true divide, not rcpps).
+	det = _mm_mul_ps(row0, minor0);
+	det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+	det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+	det = _mm_div_ss(_mm_set_ss(1.0f), det);
+	det = _mm_shuffle_ps(det, det, 0x00);
+
+	_mm_storeu_ps(&_11, _mm_mul_ps(det, minor0));
+	_mm_storeu_ps(&_21, _mm_mul_ps(det, minor1));
+	_mm_storeu_ps(&_31, _mm_mul_ps(det, minor2));
+	_mm_storeu_ps(&_41, _mm_mul_ps(det, minor3));
+#else
+	//	Adjugate by cofactor expansion; entries with odd (row+column)
+	//	carry the checkerboard sign.
 	Matrix b;
 	b._11 = _22 * (_33*_44 - _34*_43) + _23*(_34*_42 - _32*_44) + _24*(_32*_43 - _33*_42);
-	b._12 = _32 * (_43*_14 - _44*_13) + _33*(_44*_12 - _42*_14) + _34*(_42*_13 - _43*_12);
+	b._12 = -(_32 * (_43*_14 - _44*_13) + _33*(_44*_12 - _42*_14) + _34*(_42*_13 - _43*_12));
 	b._13 = _42 * (_13*_24 - _14*_23) + _43*(_14*_22 - _12*_24) + _44*(_12*_23 - _13*_22);
-	b._14 = _12 * (_23*_34 - _24*_33) + _13*(_24*_32 - _22*_34) + _14*(_22*_33 - _23*_32);
+	b._14 = -(_12 * (_23*_34 - _24*_33) + _13*(_24*_32 - _22*_34) + _14*(_22*_33 - _23*_32));
 
-	b._21 = _23 * (_34*_41 - _31*_44) + _24*(_31*_43 - _33*_41) + _21*(_33*_44 - _34*_43);
+	b._21 = -(_23 * (_34*_41 - _31*_44) + _24*(_31*_43 - _33*_41) + _21*(_33*_44 - _34*_43));
 	b._22 = _33 * (_44*_11 - _41*_14) + _34*(_41*_13 - _43*_11) + _31*(_43*_14 - _44*_13);
-	b._23 = _43 * (_14*_21 - _11*_24) + _44*(_11*_23 - _13*_21) + _41*(_13*_24 - _14*_23);
+	b._23 = -(_43 * (_14*_21 - _11*_24) + _44*(_11*_23 - _13*_21) + _41*(_13*_24 - _14*_23));
 	b._24 = _13 * (_24*_31 - _21*_34) + _14*(_21*_33 - _23*_31) + _11*(_23*_34 - _24*_33);
 
 	b._31 = _24 * (_31*_42 - _32*_41) + _21*(_32*_44 - _34*_42) + _22*(_34*_41 - _31*_44);
-	b._32 = _34 * (_41*_12 - _42*_11) + _31*(_42*_14 - _44*_12) + _32*(_44*_11 - _41*_14);
+	b._32 = -(_34 * (_41*_12 - _42*_11) + _31*(_42*_14 - _44*_12) + _32*(_44*_11 - _41*_14));
 	b._33 = _44 * (_11*_22 - _12*_21) + _41*(_12*_24 - _14*_22) + _42*(_14*_21 - _11*_24);
-	b._34 = _14 * (_21*_32 - _22*_31) + _11*(_22*_34 - _24*_32) + _12*(_24*_31 - _21*_34);
+	b._34 = -(_14 * (_21*_32 - _22*_31) + _11*(_22*_34 - _24*_32) + _12*(_24*_31 - _21*_34));
 
-	b._41 = _21 * (_32*_43 - _33*_42) + _22*(_33*_41 - _31*_43) + _23*(_31*_42 - _32*_41);
+	b._41 = -(_21 * (_32*_43 - _33*_42) + _22*(_33*_41 - _31*_43) + _23*(_31*_42 - _32*_41));
 	b._42 = _31 * (_42*_13 - _43*_12) + _32*(_43*_11 - _41*_13) + _33*(_41*_12 - _42*_11);
-	b._43 = _41 * (_12*_23 - _13*_22) + _42*(_13*_21 - _11*_23) + _43*(_11*_22 - _12*_21);
+	b._43 = -(_41 * (_12*_23 - _13*_22) + _42*(_13*_21 - _11*_23) + _43*(_11*_22 - _12*_21));
 	b._44 = _11 * (_22*_33 - _23*_32) + _12*(_23*_31 - _21*_33) + _13*(_21*_32 - _22*_31);
 
 	float det = 1.0f / (_11*b._11 + _21*b._12 + _31*b._13 + _41*b._14);
@@ -83,12 +219,113 @@ void Matrix::inverse()
 	_21 = b._21 * det;	_22 = b._22 * det;	_23 = b._23 * det;	_24 = b._24 * det;
 	_31 = b._31 * det;	_32 = b._32 * det;	_33 = b._33 * det;	_34 = b._34 * det;
 	_41 = b._41 * det;	_42 = b._42 * det;	_43 = b._43 * det;	_44 = b._44 * det;
+#endif
+}
+
+bool Matrix::isAffine() const
+{
+	return _14 == 0.0f && _24 == 0.0f && _34 == 0.0f && _44 == 1.0f;
+}
+
+void Matrix::inverseAffine()
+{
+	//	Upper 3x3 by cofactors, translation by -T * inv(M3).
+	float c11 = _22*_33 - _23*_32;
+	float c12 = _23*_31 - _21*_33;
+	float c13 = _21*_32 - _22*_31;
+	float det = 1.0f / (_11*c11 + _12*c12 + _13*c13);
+
+	Matrix b;
+	b._11 = c11 * det;
+	b._12 = (_13*_32 - _12*_33) * det;
+	b._13 = (_12*_23 - _13*_22) * det;
+	b._21 = c12 * det;
+	b._22 = (_11*_33 - _13*_31) * det;
+	b._23 = (_13*_21 - _11*_23) * det;
+	b._31 = c13 * det;
+	b._32 = (_12*_31 - _11*_32) * det;
+	b._33 = (_11*_22 - _12*_21) * det;
+
+	b._41 = -(_41*b._11 + _42*b._21 + _43*b._31);
+	b._42 = -(_41*b._12 + _42*b._22 + _43*b._32);
+	b._43 = -(_41*b._13 + _42*b._23 + _43*b._33);
+
+	b._14 = b._24 = b._34 = 0.0f;
+	b._44 = 1.0f;
+	*this = b;
+}
+
+void Matrix::inverseOrthogonal()
+{
+	//	M3 = S * R with R orthonormal, so inv(M3) = R^T * inv(S): the
+	//	transpose with each column divided by that row's squared length.
+	float s1 = 1.0f / (_11*_11 + _12*_12 + _13*_13);
+	float s2 = 1.0f / (_21*_21 + _22*_22 + _23*_23);
+	float s3 = 1.0f / (_31*_31 + _32*_32 + _33*_33);
+
+	Matrix b;
+	b._11 = _11 * s1;	b._12 = _21 * s2;	b._13 = _31 * s3;	b._14 = 0.0f;
+	b._21 = _12 * s1;	b._22 = _22 * s2;	b._23 = _32 * s3;	b._24 = 0.0f;
+	b._31 = _13 * s1;	b._32 = _23 * s2;	b._33 = _33 * s3;	b._34 = 0.0f;
+
+	b._41 = -(_41*b._11 + _42*b._21 + _43*b._31);
+	b._42 = -(_41*b._12 + _42*b._22 + _43*b._32);
+	b._43 = -(_41*b._13 + _42*b._23 + _43*b._33);
+	b._44 = 1.0f;
+	*this = b;
+}
+
+void Matrix::inverseFast()
+{
+	if (!isAffine())
+	{
+		inverse();
+		return;
+	}
+
+	//	Rows count as orthogonal when every |cos| between them is below 1e-5.
+	const float eps2 = 1e-10f;
+	float l1 = _11*_11 + _12*_12 + _13*_13;
+	float l2 = _21*_21 + _22*_22 + _23*_23;
+	float l3 = _31*_31 + _32*_32 + _33*_33;
+	float d12 = _11*_21 + _12*_22 + _13*_23;
+	float d13 = _11*_31 + _12*_32 + _13*_33;
+	float d23 = _21*_31 + _22*_32 + _23*_33;
+	if (d12*d12 <= eps2*l1*l2 && d13*d13 <= eps2*l1*l3 && d23*d23 <= eps2*l2*l3)
+	{
+		inverseOrthogonal();
+	}
+	else
+	{
+		inverseAffine();
+	}
+}
+
+void Matrix::InverseArray(Matrix* out, const Matrix* in, int count)
+{
+	//	out may alias in.
+	for (int i = 0; i < count; i++)
+	{
+		Matrix a = in[i];
+		a.inverseFast();
+		out[i] = a;
+	}
 }
 
 void Matrix::Interporate(Matrix& target, float rate)
 {
-	Matrix A = *this * (1.0f - rate) + target * rate;
-	*this = A;
+#if defined(MATH_SIMD_SCALAR)
+	*this = expr::lerp(*this, target, rate);
+#else
+	//	this * (1 - rate) + target * rate, row by row without temporaries.
+	simd::float4 s0 = simd::splat(1.0f - rate);
+	simd::float4 s1 = simd::splat(rate);
+	for (int i = 0; i < 16; i += 4)
+	{
+		simd::float4 a = simd::mul(simd::load(&m[i]), s0);
+		simd::store(&m[i], simd::madd(simd::load(&target.m[i]), s1, a));
+	}
+#endif
 }
 
 //*****************************************************************************
@@ -207,6 +444,139 @@ void Matrix::TRSdegree(Vector3& T, Vector3& R, Vector3& S)
 	TRS(T, r, S);
 }
 
+void Matrix::Compose(const Vector3& T, const Quaternion& R, const Vector3& S)
+{
+	//	Quaternion::toMatrix with the scale folded into each row.
+	float s = 2.0f / (R.x*R.x + R.y*R.y + R.z*R.z + R.w*R.w);
+	float vx = R.x * s, vy = R.y * s, vz = R.z * s;
+	float wx = vx * R.w, wy = vy * R.w, wz = vz * R.w;
+	float sx = R.x * vx, sy = R.y * vy, sz = R.z * vz;
+	float cx = R.y * vz, cy = R.z * vx, cz = R.x * vy;
+
+	_11 = (1.0f - sy - sz) * S.x;	_12 = (cz + wz) * S.x;	_13 = (cy - wy) * S.x;	_14 = 0.0f;
+	_21 = (cz - wz) * S.y;	_22 = (1.0f - sx - sz) * S.y;	_23 = (cx + wx) * S.y;	_24 = 0.0f;
+	_31 = (cy + wy) * S.z;	_32 = (cx - wx) * S.z;	_33 = (1.0f - sx - sy) * S.z;	_34 = 0.0f;
+	_41 = T.x;	_42 = T.y;	_43 = T.z;	_44 = 1.0f;
+}
+
+bool Matrix::Decompose(Vector3& T, Quaternion& R, Vector3& S) const
+{
+	T = Vector3(_41, _42, _43);
+
+	//	Gram-Schmidt: r0 = row0 / |row0|, r1 = row1 without its r0 part,
+	//	r2 = r0 x r1.  Scale is each row measured along its own axis.
+	Vector3 row0(_11, _12, _13), row1(_21, _22, _23), row2(_31, _32, _33);
+	const float eps = 1e-12f;
+
+	S.x = row0.Length();
+	if (S.x * S.x <= eps){ R = Quaternion(); S = Vector3(0, 0, 0); return false; }
+	Vector3 r0 = row0 / S.x;
+
+	Vector3 r1 = row1 - r0 * Vector3::dot(row1, r0);
+	float l1 = r1.Length();
+	if (l1 * l1 <= eps){ R = Quaternion(); S.y = S.z = 0.0f; return false; }
+	r1 /= l1;
+	S.y = Vector3::dot(row1, r1);
+
+	Vector3 r2;
+	Vector3::cross(r2, r0, r1);
+	S.z = Vector3::dot(row2, r2);
+	if (S.z * S.z <= eps){ R = Quaternion(); return false; }
+
+	Matrix rot;
+	rot._11 = r0.x;	rot._12 = r0.y;	rot._13 = r0.z;
+	rot._21 = r1.x;	rot._22 = r1.y;	rot._23 = r1.z;
+	rot._31 = r2.x;	rot._32 = r2.y;	rot._33 = r2.z;
+	R.fromMatrix(rot);
+	return true;
+}
+
+namespace
+{
+	//	Four TRS poses -> four matrices.  SoA lanes are turned into matrix
+	//	rows with one 4x4 transpose per row.
+	void compose4(Matrix* out, const TRSSoA& in, int i)
+	{
+		using namespace simd;
+		float4 qx = load(in.qx + i), qy = load(in.qy + i), qz = load(in.qz + i), qw = load(in.qw + i);
+		float4 one = splat(1.0f);
+
+		float4 s = div(splat(2.0f), madd(qw, qw, madd(qz, qz, madd(qy, qy, mul(qx, qx)))));
+		float4 vx = mul(qx, s), vy = mul(qy, s), vz = mul(qz, s);
+		float4 wx = mul(vx, qw), wy = mul(vy, qw), wz = mul(vz, qw);
+		float4 sx = mul(qx, vx), sy = mul(qy, vy), sz = mul(qz, vz);
+		float4 cx = mul(qy, vz), cy = mul(qz, vx), cz = mul(qx, vy);
+
+		float4 scale[3] = { load(in.sx + i), load(in.sy + i), load(in.sz + i) };
+		float4 rows[3][3] =
+		{
+			{ sub(sub(one, sy), sz), add(cz, wz), sub(cy, wy) },
+			{ sub(cz, wz), sub(sub(one, sx), sz), add(cx, wx) },
+			{ add(cy, wy), sub(cx, wx), sub(sub(one, sx), sy) },
+		};
+
+		float4 zero = splat(0.0f);
+		for (int r = 0; r < 3; r++)
+		{
+			float4 a = mul(rows[r][0], scale[r]);
+			float4 b = mul(rows[r][1], scale[r]);
+			float4 c = mul(rows[r][2], scale[r]);
+			float4 d = zero;
+			transpose4(a, b, c, d);
+			store(&out[0].m[r * 4], a);
+			store(&out[1].m[r * 4], b);
+			store(&out[2].m[r * 4], c);
+			store(&out[3].m[r * 4], d);
+		}
+
+		float4 a = load(in.tx + i), b = load(in.ty + i), c = load(in.tz + i), d = one;
+		transpose4(a, b, c, d);
+		store(&out[0].m[12], a);
+		store(&out[1].m[12], b);
+		store(&out[2].m[12], c);
+		store(&out[3].m[12], d);
+	}
+}
+
+void Matrix::ComposeArray(Matrix* out, const TRSSoA& in, int count)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		compose4(out + i, in, i);
+	}
+	if (i == count) return;
+
+	//	Remainder goes through the same kernel via a padded identity pose.
+	float buf[10][4];
+	float* src[10] = { in.tx, in.ty, in.tz, in.qx, in.qy, in.qz, in.qw, in.sx, in.sy, in.sz };
+	const float pad[10] = { 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 };
+	int n = count - i;
+	for (int c = 0; c < 10; c++)
+		for (int k = 0; k < 4; k++)
+			buf[c][k] = k < n ? src[c][i + k] : pad[c];
+
+	TRSSoA tail = { buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7], buf[8], buf[9] };
+	Matrix tmp[4];
+	compose4(tmp, tail, 0);
+	for (int k = 0; k < n; k++) out[i + k] = tmp[k];
+}
+
+bool Matrix::DecomposeArray(const TRSSoA& out, const Matrix* in, int count)
+{
+	bool ok = true;
+	for (int i = 0; i < count; i++)
+	{
+		Vector3 T, S;
+		Quaternion R;
+		ok &= in[i].Decompose(T, R, S);
+		out.tx[i] = T.x;	out.ty[i] = T.y;	out.tz[i] = T.z;
+		out.qx[i] = R.x;	out.qy[i] = R.y;	out.qz[i] = R.z;	out.qw[i] = R.w;
+		out.sx[i] = S.x;	out.sy[i] = S.y;	out.sz[i] = S.z;
+	}
+	return ok;
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
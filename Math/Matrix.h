@@ -5,6 +5,16 @@
 #include <string.h>
 
 class Quaternion;
+
+//------------------------------------------------------
+//	Structure-of-arrays TRS pose: translation, rotation quaternion, scale
+//------------------------------------------------------
+struct TRSSoA
+{
+	float* tx; float* ty; float* tz;
+	float* qx; float* qy; float* qz; float* qw;
+	float* sx; float* sy; float* sz;
+};
 //*****************************************************************************
 //
 //
@@ -31,19 +41,45 @@ public:
 	void multiply(const Matrix& mat1, const Matrix& mat2);
 	void multiply(float val);
 	void inverse();
+
+	//	Cheaper inverses for affine matrices (_14 = _24 = _34 = 0, _44 = 1).
+	//	inverseOrthogonal also requires mutually orthogonal rows, which holds
+	//	for rigid transforms and for TRS() with any scale.  inverseFast checks
+	//	the matrix and takes the cheapest valid path.
+	bool isAffine() const;
+	void inverseAffine();
+	void inverseOrthogonal();
+	void inverseFast();
+	static void InverseArray( Matrix* out, const Matrix* in, int count );
 	void Interporate(Matrix& target, float rate);
 
     Matrix() {};
 	Matrix( const float* p ){ memcpy( &_11, p, sizeof(float)*16); }
-    Matrix( float f11, float f12, float f13, float f14,
+    constexpr Matrix( float f11, float f12, float f13, float f14,
            float f21, float f22, float f23, float f24,
            float f31, float f32, float f33, float f34,
            float f41, float f42, float f43, float f44 )
+		: m{ f11, f12, f13, f14,
+		     f21, f22, f23, f24,
+		     f31, f32, f33, f34,
+		     f41, f42, f43, f44 }
 	{
-		_11 = f11; _12 = f12; _13 = f13; _14 = f14;
-		_21 = f21; _22 = f22; _23 = f23; _24 = f24;
-		_31 = f31; _32 = f32; _33 = f33; _34 = f34;
-		_41 = f41; _42 = f42; _43 = f43; _44 = f44;
+	}
+
+	//	Evaluate an element-wise expression (see Expression.h) in one pass.
+	template<class E, class = typename std::enable_if<expr::IsNode<E>::value>::type>
+	constexpr Matrix( const E& e ) : m()
+	{
+		static_assert(E::Size == 16, "not a Matrix expression");
+		for (int i = 0; i < 16; i++) m[i] = e[i];
+	}
+
+	template<class E, class = typename std::enable_if<expr::IsNode<E>::value>::type>
+	Matrix& operator = ( const E& e )
+	{
+		static_assert(E::Size == 16, "not a Matrix expression");
+		for (int i = 0; i < 16; i++) m[i] = e[i];
+		return *this;
 	}
           
     Matrix& operator *= ( const Matrix& mat )
@@ -85,6 +121,36 @@ public:
 	void TRS(Vector3& T, Vector3& R, Vector3& S);
 	void TRSdegree(Vector3& T, Vector3& R, Vector3& S);
 
+	//	Same layout as TRS() with a quaternion rotation: scale rows, rotate, translate.
+	void Compose(const Vector3& T, const Quaternion& R, const Vector3& S);
+
+	//	Inverse of Compose() for affine matrices.  Rotation rows are
+	//	orthonormalized (Gram-Schmidt), so shear is dropped; a mirrored
+	//	matrix gets a negative S.z.  Returns false if an axis is degenerate.
+	bool Decompose(Vector3& T, Quaternion& R, Vector3& S) const;
+
+	//	Batch versions over SoA poses; ComposeArray runs 4 matrices per step.
+	static void ComposeArray(Matrix* out, const TRSSoA& in, int count);
+	static bool DecomposeArray(const TRSSoA& out, const Matrix* in, int count);
+
 	void RotationZXY(float x, float y, float z);
 
 };
+
+namespace expr
+{
+	template<>
+	struct Leaf<Matrix>
+	{
+		static const bool value = true;
+		static const int Size = 16;
+		static constexpr float get( const Matrix& a, int i ){ return a.m[i]; }
+	};
+
+	//	Matrix product with an expression on the left evaluates it first.
+	template<class E, class = typename std::enable_if<IsNode<E>::value>::type>
+	inline Matrix operator * ( const E& e, const Matrix& mat )
+	{
+		return Matrix(e) * mat;
+	}
+}
@@ -7,6 +7,7 @@
 //
 
 #include "Quaternion.h"
+#include "Simd.h"
 
 void Quaternion::toMatrix( Matrix& m)
 {
@@ -83,53 +84,198 @@ void Quaternion::slerp( Quaternion& q, Quaternion& r, float t )
 }
 
 
+//*****************************************************************************
+//	Batch interpolation
+//*****************************************************************************
+namespace
+{
+	enum InterpMode { kSlerp, kNlerp, kFastSlerp };
+
+	//	sin(x) on [0, pi/2], Taylor series to x^11.
+	inline simd::floatw sinPoly( simd::floatw x )
+	{
+		simd::floatw x2 = simd::mul(x, x);
+		simd::floatw p = simd::splatw(-2.5052108e-8f);
+		p = simd::madd(p, x2, simd::splatw( 2.7557319e-6f));
+		p = simd::madd(p, x2, simd::splatw(-1.9841270e-4f));
+		p = simd::madd(p, x2, simd::splatw( 8.3333333e-3f));
+		p = simd::madd(p, x2, simd::splatw(-1.6666667e-1f));
+		p = simd::madd(p, x2, simd::splatw(1.0f));
+		return simd::mul(p, x);
+	}
+
+	//	acos(x) on [0, 1], Abramowitz & Stegun 4.4.46.
+	inline simd::floatw acosPoly( simd::floatw x )
+	{
+		simd::floatw p = simd::splatw(-0.0012624911f);
+		p = simd::madd(p, x, simd::splatw( 0.0066700901f));
+		p = simd::madd(p, x, simd::splatw(-0.0170881256f));
+		p = simd::madd(p, x, simd::splatw( 0.0308918810f));
+		p = simd::madd(p, x, simd::splatw(-0.0501743046f));
+		p = simd::madd(p, x, simd::splatw( 0.0889789874f));
+		p = simd::madd(p, x, simd::splatw(-0.2145988016f));
+		p = simd::madd(p, x, simd::splatw( 1.5707963050f));
+		return simd::mul(simd::sqrt(simd::sub(simd::splatw(1.0f), x)), p);
+	}
+
+	void interpolateBlock( float* ox, float* oy, float* oz, float* ow,
+		const float* qx, const float* qy, const float* qz, const float* qw,
+		const float* rx, const float* ry, const float* rz, const float* rw,
+		const float* tp, InterpMode mode )
+	{
+		simd::floatw one = simd::splatw(1.0f);
+		simd::floatw Qx = simd::loadw(qx), Qy = simd::loadw(qy), Qz = simd::loadw(qz), Qw = simd::loadw(qw);
+		simd::floatw Rx = simd::loadw(rx), Ry = simd::loadw(ry), Rz = simd::loadw(rz), Rw = simd::loadw(rw);
+		simd::floatw t = simd::loadw(tp);
+
+		//	Shortest path: flip r when the quaternions are in opposite hemispheres.
+		simd::floatw d = simd::madd(Qw, Rw, simd::madd(Qz, Rz, simd::madd(Qy, Ry, simd::mul(Qx, Rx))));
+		simd::floatw sign = simd::select(simd::cmplt(d, simd::splatw(0.0f)), simd::splatw(-1.0f), one);
+		Rx = simd::mul(Rx, sign); Ry = simd::mul(Ry, sign); Rz = simd::mul(Rz, sign); Rw = simd::mul(Rw, sign);
+		d = simd::min(simd::abs(d), one);
+
+		simd::floatw s0, s1;
+		if (mode == kSlerp)
+		{
+			//	Nearly parallel inputs fall back to lerp, like the scalar slerp.
+			simd::floatw theta = acosPoly(d);
+			simd::floatw sinTheta = simd::sqrt(simd::max(simd::sub(one, simd::mul(d, d)), simd::splatw(0.0f)));
+			simd::floatw parallel = simd::cmplt(sinTheta, simd::splatw(1e-4f));
+			simd::floatw invSin = simd::div(one, simd::select(parallel, one, sinTheta));
+			simd::floatw a = simd::mul(sinPoly(simd::mul(simd::sub(one, t), theta)), invSin);
+			simd::floatw b = simd::mul(sinPoly(simd::mul(t, theta)), invSin);
+			s0 = simd::select(parallel, simd::sub(one, t), a);
+			s1 = simd::select(parallel, t, b);
+		}
+		else
+		{
+			if (mode == kFastSlerp)
+			{
+				//	Reshape t so nlerp tracks slerp's constant angular velocity
+				//	(fit by A. Kapoulkine, "Approximating slerp").
+				simd::floatw A = simd::madd(d, simd::splatw(-1.43519f), simd::splatw(3.55645f));
+				A = simd::madd(d, A, simd::splatw(-3.2452f));
+				A = simd::madd(d, A, simd::splatw(1.0904f));
+				simd::floatw B = simd::madd(d, simd::splatw(0.215638f), simd::splatw(-1.06021f));
+				B = simd::madd(d, B, simd::splatw(0.848013f));
+				simd::floatw th = simd::sub(t, simd::splatw(0.5f));
+				simd::floatw k = simd::madd(simd::mul(A, th), th, B);
+				simd::floatw tt = simd::mul(simd::mul(t, th), simd::sub(t, one));
+				t = simd::madd(tt, k, t);
+			}
+			s0 = simd::sub(one, t);
+			s1 = t;
+		}
+
+		simd::floatw x = simd::madd(Rx, s1, simd::mul(Qx, s0));
+		simd::floatw y = simd::madd(Ry, s1, simd::mul(Qy, s0));
+		simd::floatw z = simd::madd(Rz, s1, simd::mul(Qz, s0));
+		simd::floatw w = simd::madd(Rw, s1, simd::mul(Qw, s0));
+
+		simd::floatw len = simd::sqrt(simd::madd(w, w, simd::madd(z, z, simd::madd(y, y, simd::mul(x, x)))));
+		simd::floatw invLen = simd::div(one, len);
+		simd::storew(ox, simd::mul(x, invLen));
+		simd::storew(oy, simd::mul(y, invLen));
+		simd::storew(oz, simd::mul(z, invLen));
+		simd::storew(ow, simd::mul(w, invLen));
+	}
+
+	void interpolateSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r,
+		const float* t, int count, InterpMode mode )
+	{
+		const int W = simd::kWidth;
+		int i = 0;
+		for (; i + W <= count; i += W)
+		{
+			interpolateBlock(out.x + i, out.y + i, out.z + i, out.w + i,
+				q.x + i, q.y + i, q.z + i, q.w + i,
+				r.x + i, r.y + i, r.z + i, r.w + i, t + i, mode);
+		}
+		if (i == count) return;
+
+		//	Remainder goes through the same kernel via a padded block.
+		float buf[13][simd::kWidth];
+		int n = count - i;
+		for (int k = 0; k < W; k++)
+		{
+			bool live = k < n;
+			buf[0][k] = live ? q.x[i + k] : 0.0f;
+			buf[1][k] = live ? q.y[i + k] : 0.0f;
+			buf[2][k] = live ? q.z[i + k] : 0.0f;
+			buf[3][k] = live ? q.w[i + k] : 1.0f;
+			buf[4][k] = live ? r.x[i + k] : 0.0f;
+			buf[5][k] = live ? r.y[i + k] : 0.0f;
+			buf[6][k] = live ? r.z[i + k] : 0.0f;
+			buf[7][k] = live ? r.w[i + k] : 1.0f;
+			buf[8][k] = live ? t[i + k] : 0.0f;
+		}
+		interpolateBlock(buf[9], buf[10], buf[11], buf[12],
+			buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7], buf[8], mode);
+		for (int k = 0; k < n; k++)
+		{
+			out.x[i + k] = buf[9][k];
+			out.y[i + k] = buf[10][k];
+			out.z[i + k] = buf[11][k];
+			out.w[i + k] = buf[12][k];
+		}
+	}
+}
+
+void Quaternion::SlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count )
+{
+	interpolateSoA(out, q, r, t, count, kSlerp);
+}
+
+void Quaternion::NlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count )
+{
+	interpolateSoA(out, q, r, t, count, kNlerp);
+}
+
+void Quaternion::FastSlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count )
+{
+	interpolateSoA(out, q, r, t, count, kFastSlerp);
+}
+
 //------------------------------------------------------
 //		s񂩂쐬
 //------------------------------------------------------
-void Quaternion::fromMatrix( Matrix& mat )
+void Quaternion::fromMatrix( const Matrix& m )
 {
-	// ő听
-    float elem[ 4 ]; // 0:x, 1:y, 2:z, 3:w
-    elem[ 0 ] = mat._11 - mat._22 - mat._33 + 1.0f;
-    elem[ 1 ] = -mat._11 + mat._22 - mat._33 + 1.0f;
-    elem[ 2 ] = -mat._11 - mat._22 + mat._33 + 1.0f;
-    elem[ 3 ] = mat._11 + mat._22 + mat._33 + 1.0f;
-	
-    unsigned biggestIndex = 0;
-    for ( int i = 1; i < 4; i++ ) {
-        if ( elem[i] > elem[biggestIndex] )
-            biggestIndex = i;
-    }
-	
-    if ( elem[biggestIndex] < 0.0f ) return;
-	
-    // ővf̒lZo
-    float *q[4] = {&x, &y, &z, &w};
-    float v = sqrtf( elem[biggestIndex] ) * 0.5f;
-    *q[biggestIndex] = v;
-    float mult = 0.25f / v;
-	
-    switch ( biggestIndex ) {
-		case 0: // x
-			*q[1] = (mat._12 + mat._21) * mult;
-			*q[2] = (mat._31 + mat._13) * mult;
-			*q[3] = (mat._23 - mat._32) * mult;
-			break;
-		case 1: // y
-			*q[0] = (mat._12 + mat._21) * mult;
-			*q[2] = (mat._23 + mat._32) * mult;
-			*q[3] = (mat._31 - mat._13) * mult;
-			break;
-		case 2: // z
-			*q[0] = (mat._31 + mat._13) * mult;
-			*q[1] = (mat._23 + mat._32) * mult;
-			*q[3] = (mat._12 - mat._21) * mult;
-			break;
-		case 3: // w
-			*q[0] = (mat._23 - mat._32) * mult;
-			*q[1] = (mat._31 - mat._13) * mult;
-			*q[2] = (mat._12 - mat._21) * mult;
-			break;
-    }
+	//	Inverse of toMatrix(), branching on the largest diagonal term to
+	//	stay well conditioned.
+	float trace = m._11 + m._22 + m._33;
+	if (trace > 0.0f)
+	{
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		w = 0.25f * s;
+		x = (m._23 - m._32) / s;
+		y = (m._31 - m._13) / s;
+		z = (m._12 - m._21) / s;
+	}
+	else if (m._11 > m._22 && m._11 > m._33)
+	{
+		float s = sqrtf(1.0f + m._11 - m._22 - m._33) * 2.0f;
+		w = (m._23 - m._32) / s;
+		x = 0.25f * s;
+		y = (m._21 + m._12) / s;
+		z = (m._31 + m._13) / s;
+	}
+	else if (m._22 > m._33)
+	{
+		float s = sqrtf(1.0f + m._22 - m._11 - m._33) * 2.0f;
+		w = (m._31 - m._13) / s;
+		x = (m._21 + m._12) / s;
+		y = 0.25f * s;
+		z = (m._32 + m._23) / s;
+	}
+	else
+	{
+		float s = sqrtf(1.0f + m._33 - m._11 - m._22) * 2.0f;
+		w = (m._12 - m._21) / s;
+		x = (m._31 + m._13) / s;
+		y = (m._32 + m._23) / s;
+		z = 0.25f * s;
+	}
+	normalize();
 }
 
@@ -3,6 +3,17 @@
 #include	<math.h>
 #include	"Matrix.h"
 
+//------------------------------------------------------
+//	Structure-of-arrays view of count quaternions
+//------------------------------------------------------
+struct QuaternionSoA
+{
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+};
+
 class Quaternion {
 public:
 	float x, y, z, w;
@@ -11,8 +22,23 @@ public:
 	Quaternion( Vector3& v, float t ){ v.Normalize(); x = v.x*sinf(t*0.5f); y = v.y*sinf(t*0.5f); z = v.z*sinf(t*0.5f); w = cosf(t*0.5f); }
 
 	void toMatrix( Matrix& m);
+	void fromMatrix( const Matrix& m );	//	rotation rows must be orthonormal
 	void slerp( Quaternion& q, Quaternion& r, float t );	
 
+	//------------------------------------------------------
+	//	Batch interpolation over SoA arrays
+	//------------------------------------------------------
+	//	out[i] = interp(q[i], r[i], t[i]) for count quaternions, kWidth
+	//	(4 or 8) lanes per instruction.  All three take the shortest
+	//	path and return unit quaternions.  out may alias q or r.
+	//
+	//	SlerpSoA       : exact slerp (polynomial acos/sin), |err| < 1e-6 per component
+	//	NlerpSoA       : normalized lerp
+	//	FastSlerpSoA   : nlerp with a corrected t, |err| < 2e-3 rad
+	static void SlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count );
+	static void NlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count );
+	static void FastSlerpSoA( const QuaternionSoA& out, const QuaternionSoA& q, const QuaternionSoA& r, const float* t, int count );
+
 
 	//------------------------------------------------------
 	//	
@@ -32,7 +58,6 @@ public:
 	//	擾
 	//------------------------------------------------------
 	inline float getLength() const{ return sqrtf( x*x + y*y + z*z + w*w); }
-	void fromMatrix( Matrix& mat );
 	
 	//------------------------------------------------------
 	//	Iy[^[
@@ -46,10 +71,11 @@ public:
 	inline Quaternion& operator -=(const Quaternion& v){ x-=v.x; y-=v.y; z-=v.z; w-=v.w; return *this; }
 	inline Quaternion& operator *=(const Quaternion& v)
 	{
-		x = y * v.z - z * v.y + x * v.w + w * v.x;
-		y = z * v.x - x * v.z + y * v.w + w * v.y;
-		z = x * v.y - y * v.x + z * v.w + w * v.z;
-		w = w * v.w - x * v.x - y * v.y - z * v.z;
+		float qx = y * v.z - z * v.y + x * v.w + w * v.x;
+		float qy = z * v.x - x * v.z + y * v.w + w * v.y;
+		float qz = x * v.y - y * v.x + z * v.w + w * v.z;
+		float qw = w * v.w - x * v.x - y * v.y - z * v.z;
+		x = qx; y = qy; z = qz; w = qw;
 		return *this;
     }
 	
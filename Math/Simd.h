@@ -0,0 +1,221 @@
+#pragma once
+
+//------------------------------------------------------
+//	SIMD backend selection
+//------------------------------------------------------
+//	One backend is chosen at compile time from the target flags.
+//	Define MATH_SIMD_SCALAR to force the portable scalar path,
+//	or MATH_SIMD_NO_AVX to keep an AVX build on 128-bit kernels.
+#if !defined(MATH_SIMD_SCALAR) && !defined(MATH_SIMD_SSE) && !defined(MATH_SIMD_NEON)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define MATH_SIMD_SSE
+	#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		#define MATH_SIMD_NEON
+	#else
+		#define MATH_SIMD_SCALAR
+	#endif
+#endif
+
+#if defined(MATH_SIMD_SSE) && defined(__AVX__) && !defined(MATH_SIMD_NO_AVX)
+	#define MATH_SIMD_AVX
+#endif
+
+#if defined(MATH_SIMD_AVX)
+	#include <immintrin.h>
+	#define MATH_SIMD_BACKEND_NAME "avx"
+#elif defined(MATH_SIMD_SSE)
+	#include <emmintrin.h>
+	#define MATH_SIMD_BACKEND_NAME "sse"
+#elif defined(MATH_SIMD_NEON)
+	#include <arm_neon.h>
+	#define MATH_SIMD_BACKEND_NAME "neon"
+#else
+	#define MATH_SIMD_BACKEND_NAME "scalar"
+	#include <math.h>
+#endif
+
+//------------------------------------------------------
+//	4-wide float helpers shared by the Math kernels
+//------------------------------------------------------
+//	All loads and stores are unaligned; Matrix and Vector3 carry
+//	no alignment requirement.  madd is a separate multiply and add
+//	(never fused) so results match the scalar code bit for bit, except
+//	where a backend notes otherwise.
+namespace simd
+{
+#if defined(MATH_SIMD_SSE)
+	typedef __m128 float4;
+
+	inline float4 load( const float* p ){ return _mm_loadu_ps(p); }
+	inline void store( float* p, float4 v ){ _mm_storeu_ps(p, v); }
+	inline float4 splat( float f ){ return _mm_set1_ps(f); }
+	inline float4 add( float4 a, float4 b ){ return _mm_add_ps(a, b); }
+	inline float4 sub( float4 a, float4 b ){ return _mm_sub_ps(a, b); }
+	inline float4 mul( float4 a, float4 b ){ return _mm_mul_ps(a, b); }
+	inline float4 madd( float4 a, float4 b, float4 c ){ return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline float4 div( float4 a, float4 b ){ return _mm_div_ps(a, b); }
+	inline float4 sqrt( float4 a ){ return _mm_sqrt_ps(a); }
+	inline float4 min( float4 a, float4 b ){ return _mm_min_ps(a, b); }
+	inline float4 max( float4 a, float4 b ){ return _mm_max_ps(a, b); }
+	inline float4 abs( float4 a ){ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline float4 cmplt( float4 a, float4 b ){ return _mm_cmplt_ps(a, b); }
+	inline float4 select( float4 mask, float4 a, float4 b ){ return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	//	Four packed xyz points <-> x, y, z registers (12 floats).
+	inline void loadXYZ4( const float* p, float4& x, float4& y, float4& z )
+	{
+		__m128 a = _mm_loadu_ps(p);			//	x0 y0 z0 x1
+		__m128 b = _mm_loadu_ps(p + 4);		//	y1 z1 x2 y2
+		__m128 c = _mm_loadu_ps(p + 8);		//	z2 x3 y3 z3
+		__m128 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2));
+		x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+		__m128 v = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+		y = _mm_shuffle_ps(u, v, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 w = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+		z = _mm_shuffle_ps(w, c, _MM_SHUFFLE(3, 0, 2, 0));
+	}
+	inline void storeXYZ4( float* p, float4 x, float4 y, float4 z )
+	{
+		__m128 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		_mm_storeu_ps(p, a);
+		_mm_storeu_ps(p + 4, b);
+		_mm_storeu_ps(p + 8, c);
+	}
+
+	//	In-place 4x4 transpose: lane j of register i <-> lane i of register j.
+	inline void transpose4( float4& a, float4& b, float4& c, float4& d ){ _MM_TRANSPOSE4_PS(a, b, c, d); }
+#elif defined(MATH_SIMD_NEON)
+	typedef float32x4_t float4;
+
+	inline float4 load( const float* p ){ return vld1q_f32(p); }
+	inline void store( float* p, float4 v ){ vst1q_f32(p, v); }
+	inline float4 splat( float f ){ return vdupq_n_f32(f); }
+	inline float4 add( float4 a, float4 b ){ return vaddq_f32(a, b); }
+	inline float4 sub( float4 a, float4 b ){ return vsubq_f32(a, b); }
+	inline float4 mul( float4 a, float4 b ){ return vmulq_f32(a, b); }
+	inline float4 madd( float4 a, float4 b, float4 c ){ return vaddq_f32(vmulq_f32(a, b), c); }
+#if defined(__aarch64__) || defined(_M_ARM64)
+	inline float4 div( float4 a, float4 b ){ return vdivq_f32(a, b); }
+	inline float4 sqrt( float4 a ){ return vsqrtq_f32(a); }
+#else
+	//	ARMv7 NEON has no vector divide or square root: these refine the
+	//	estimates with two Newton steps, which leaves them a few ULPs off
+	//	the scalar result, so the Coord transforms are not bit-identical.
+	inline float4 div( float4 a, float4 b )
+	{
+		float32x4_t r = vrecpeq_f32(b);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		r = vmulq_f32(vrecpsq_f32(b, r), r);
+		return vmulq_f32(a, r);
+	}
+	inline float4 sqrt( float4 a )
+	{
+		float32x4_t r = vrsqrteq_f32(a);
+		r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, r), r), r);
+		r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, r), r), r);
+		uint32x4_t zero = vceqq_f32(a, vdupq_n_f32(0.0f));
+		return vbslq_f32(zero, a, vmulq_f32(a, r));
+	}
+#endif
+	inline float4 min( float4 a, float4 b ){ return vminq_f32(a, b); }
+	inline float4 max( float4 a, float4 b ){ return vmaxq_f32(a, b); }
+	inline float4 abs( float4 a ){ return vabsq_f32(a); }
+	inline float4 cmplt( float4 a, float4 b ){ return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	inline float4 select( float4 mask, float4 a, float4 b ){ return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+
+	inline void loadXYZ4( const float* p, float4& x, float4& y, float4& z )
+	{
+		float32x4x3_t v = vld3q_f32(p);
+		x = v.val[0]; y = v.val[1]; z = v.val[2];
+	}
+	inline void storeXYZ4( float* p, float4 x, float4 y, float4 z )
+	{
+		float32x4x3_t v;
+		v.val[0] = x; v.val[1] = y; v.val[2] = z;
+		vst3q_f32(p, v);
+	}
+
+	inline void transpose4( float4& a, float4& b, float4& c, float4& d )
+	{
+		float32x4x2_t ab = vtrnq_f32(a, b);		//	a0 b0 a2 b2 | a1 b1 a3 b3
+		float32x4x2_t cd = vtrnq_f32(c, d);
+		a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+		b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+		c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+		d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+	}
+#else
+	struct float4 { float v[4]; };
+
+	inline float4 load( const float* p ){ float4 r = {{ p[0], p[1], p[2], p[3] }}; return r; }
+	inline void store( float* p, float4 v ){ p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+	inline float4 splat( float f ){ float4 r = {{ f, f, f, f }}; return r; }
+	inline float4 add( float4 a, float4 b ){ float4 r = {{ a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3] }}; return r; }
+	inline float4 sub( float4 a, float4 b ){ float4 r = {{ a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3] }}; return r; }
+	inline float4 mul( float4 a, float4 b ){ float4 r = {{ a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3] }}; return r; }
+	inline float4 madd( float4 a, float4 b, float4 c ){ return add(mul(a, b), c); }
+	inline float4 div( float4 a, float4 b ){ float4 r = {{ a.v[0]/b.v[0], a.v[1]/b.v[1], a.v[2]/b.v[2], a.v[3]/b.v[3] }}; return r; }
+	inline float4 sqrt( float4 a ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+	inline float4 min( float4 a, float4 b ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+	inline float4 max( float4 a, float4 b ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+	inline float4 abs( float4 a ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = fabsf(a.v[i]); return r; }
+	//	Scalar masks are 1.0f / 0.0f per lane; only select() reads them.
+	inline float4 cmplt( float4 a, float4 b ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return r; }
+	inline float4 select( float4 mask, float4 a, float4 b ){ float4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; return r; }
+
+	inline void loadXYZ4( const float* p, float4& x, float4& y, float4& z )
+	{
+		for (int i = 0; i < 4; i++){ x.v[i] = p[i*3]; y.v[i] = p[i*3 + 1]; z.v[i] = p[i*3 + 2]; }
+	}
+	inline void storeXYZ4( float* p, float4 x, float4 y, float4 z )
+	{
+		for (int i = 0; i < 4; i++){ p[i*3] = x.v[i]; p[i*3 + 1] = y.v[i]; p[i*3 + 2] = z.v[i]; }
+	}
+
+	inline void transpose4( float4& a, float4& b, float4& c, float4& d )
+	{
+		float4* r[4] = { &a, &b, &c, &d };
+		for (int i = 0; i < 4; i++)
+			for (int j = i + 1; j < 4; j++)
+			{
+				float t = r[i]->v[j]; r[i]->v[j] = r[j]->v[i]; r[j]->v[i] = t;
+			}
+	}
+#endif
+
+	//------------------------------------------------------
+	//	Widest native vector, for SoA kernels
+	//------------------------------------------------------
+	//	floatw is 8 lanes on AVX and float4 everywhere else.  The
+	//	arithmetic helpers above are overloaded for it; only the
+	//	memory and broadcast helpers need their own names.
+#if defined(MATH_SIMD_AVX)
+	typedef __m256 floatw;
+	const int kWidth = 8;
+
+	inline floatw loadw( const float* p ){ return _mm256_loadu_ps(p); }
+	inline void storew( float* p, floatw v ){ _mm256_storeu_ps(p, v); }
+	inline floatw splatw( float f ){ return _mm256_set1_ps(f); }
+	inline floatw add( floatw a, floatw b ){ return _mm256_add_ps(a, b); }
+	inline floatw sub( floatw a, floatw b ){ return _mm256_sub_ps(a, b); }
+	inline floatw mul( floatw a, floatw b ){ return _mm256_mul_ps(a, b); }
+	inline floatw madd( floatw a, floatw b, floatw c ){ return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+	inline floatw div( floatw a, floatw b ){ return _mm256_div_ps(a, b); }
+	inline floatw sqrt( floatw a ){ return _mm256_sqrt_ps(a); }
+	inline floatw min( floatw a, floatw b ){ return _mm256_min_ps(a, b); }
+	inline floatw max( floatw a, floatw b ){ return _mm256_max_ps(a, b); }
+	inline floatw abs( floatw a ){ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline floatw cmplt( floatw a, floatw b ){ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline floatw select( floatw mask, floatw a, floatw b ){ return _mm256_blendv_ps(b, a, mask); }
+#else
+	typedef float4 floatw;
+	const int kWidth = 4;
+
+	inline floatw loadw( const float* p ){ return load(p); }
+	inline void storew( float* p, floatw v ){ store(p, v); }
+	inline floatw splatw( float f ){ return splat(f); }
+#endif
+}
@@ -8,27 +8,148 @@
 
 #include "Vector3.h"
 #include "Matrix.h"
+#include "Simd.h"
 
-void Vector3::Transform( Vector3& vec, Matrix& mat )
+void Vector3::Transform( const Vector3& vec, const Matrix& mat )
 {
-	x = vec.x * mat._11 + vec.y * mat._21 + vec.z * mat._31 + mat._41;
-	y = vec.x * mat._12 + vec.y * mat._22 + vec.z * mat._32 + mat._42;
-	z = vec.x * mat._13 + vec.y * mat._23 + vec.z * mat._33 + mat._43;
+	float vx = vec.x, vy = vec.y, vz = vec.z;
+	x = vx * mat._11 + vy * mat._21 + vz * mat._31 + mat._41;
+	y = vx * mat._12 + vy * mat._22 + vz * mat._32 + mat._42;
+	z = vx * mat._13 + vy * mat._23 + vz * mat._33 + mat._43;
 }
 
-void Vector3::TransformCoord( Vector3& vec, Matrix& mat )
+void Vector3::TransformCoord( const Vector3& vec, const Matrix& mat )
 {
-	float w = vec.x * mat._14 + vec.y * mat._24 + vec.z * mat._34 + mat._44;
-	x = (vec.x * mat._11 + vec.y * mat._21 + vec.z * mat._31 + mat._41) / w;
-	y = (vec.x * mat._12 + vec.y * mat._22 + vec.z * mat._32 + mat._42) / w;
-	z = (vec.x * mat._13 + vec.y * mat._23 + vec.z * mat._33 + mat._43) / w;
+	float vx = vec.x, vy = vec.y, vz = vec.z;
+	float w = vx * mat._14 + vy * mat._24 + vz * mat._34 + mat._44;
+	x = (vx * mat._11 + vy * mat._21 + vz * mat._31 + mat._41) / w;
+	y = (vx * mat._12 + vy * mat._22 + vz * mat._32 + mat._42) / w;
+	z = (vx * mat._13 + vy * mat._23 + vz * mat._33 + mat._43) / w;
 }
 
-void Vector3::Transform3x3( Vector3& vec, Matrix& mat )
+void Vector3::Transform3x3( const Vector3& vec, const Matrix& mat )
 {
-	x = vec.x * mat._11 + vec.y * mat._21 + vec.z * mat._31;
-	y = vec.x * mat._12 + vec.y * mat._22 + vec.z * mat._32;
-	z = vec.x * mat._13 + vec.y * mat._23 + vec.z * mat._33;
+	float vx = vec.x, vy = vec.y, vz = vec.z;
+	x = vx * mat._11 + vy * mat._21 + vz * mat._31;
+	y = vx * mat._12 + vy * mat._22 + vz * mat._32;
+	z = vx * mat._13 + vy * mat._23 + vz * mat._33;
+}
+
+//*****************************************************************************
+//	Batch transforms
+//*****************************************************************************
+//	The kernels work on four points at a time in x/y/z registers; the
+//	array versions transpose packed Vector3s in and out of that form.
+//	Operation order matches the single-point functions above.
+static_assert(sizeof(Vector3) == sizeof(float) * 3, "Vector3 must be tightly packed");
+
+namespace
+{
+	enum TransformMode { kPoint, kCoord, kNormal };
+
+	struct MatrixSplat
+	{
+		simd::float4 m[16];
+		explicit MatrixSplat( const Matrix& mat ){ for (int i = 0; i < 16; i++) m[i] = simd::splat(mat.m[i]); }
+	};
+
+	inline void transform4( const MatrixSplat& M, TransformMode mode,
+		simd::float4 x, simd::float4 y, simd::float4 z,
+		simd::float4& ox, simd::float4& oy, simd::float4& oz )
+	{
+		simd::float4 rx = simd::madd(z, M.m[8],  simd::madd(y, M.m[4], simd::mul(x, M.m[0])));
+		simd::float4 ry = simd::madd(z, M.m[9],  simd::madd(y, M.m[5], simd::mul(x, M.m[1])));
+		simd::float4 rz = simd::madd(z, M.m[10], simd::madd(y, M.m[6], simd::mul(x, M.m[2])));
+		if (mode != kNormal)
+		{
+			rx = simd::add(rx, M.m[12]);
+			ry = simd::add(ry, M.m[13]);
+			rz = simd::add(rz, M.m[14]);
+		}
+		if (mode == kCoord)
+		{
+			simd::float4 w = simd::add(simd::madd(z, M.m[11], simd::madd(y, M.m[7], simd::mul(x, M.m[3]))), M.m[15]);
+			rx = simd::div(rx, w);
+			ry = simd::div(ry, w);
+			rz = simd::div(rz, w);
+		}
+		ox = rx; oy = ry; oz = rz;
+	}
+
+	inline void transformOne( Vector3& out, const Vector3& in, const Matrix& mat, TransformMode mode )
+	{
+		if (mode == kPoint) out.Transform(in, mat);
+		else if (mode == kCoord) out.TransformCoord(in, mat);
+		else out.Transform3x3(in, mat);
+	}
+
+	void transformArray( Vector3* out, const Vector3* in, int count, const Matrix& mat, TransformMode mode )
+	{
+		MatrixSplat M(mat);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			simd::float4 x, y, z;
+			simd::loadXYZ4(&in[i].x, x, y, z);
+			transform4(M, mode, x, y, z, x, y, z);
+			simd::storeXYZ4(&out[i].x, x, y, z);
+		}
+		for (; i < count; i++) transformOne(out[i], in[i], mat, mode);
+	}
+
+	void transformSoA( float* outX, float* outY, float* outZ,
+		const float* x, const float* y, const float* z, int count, const Matrix& mat, TransformMode mode )
+	{
+		MatrixSplat M(mat);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			simd::float4 rx, ry, rz;
+			transform4(M, mode, simd::load(x + i), simd::load(y + i), simd::load(z + i), rx, ry, rz);
+			simd::store(outX + i, rx);
+			simd::store(outY + i, ry);
+			simd::store(outZ + i, rz);
+		}
+		for (; i < count; i++)
+		{
+			Vector3 v;
+			transformOne(v, Vector3(x[i], y[i], z[i]), mat, mode);
+			outX[i] = v.x; outY[i] = v.y; outZ[i] = v.z;
+		}
+	}
+}
+
+void Vector3::TransformArray( Vector3* out, const Vector3* in, int count, const Matrix& mat )
+{
+	transformArray(out, in, count, mat, kPoint);
+}
+
+void Vector3::TransformCoordArray( Vector3* out, const Vector3* in, int count, const Matrix& mat )
+{
+	transformArray(out, in, count, mat, kCoord);
+}
+
+void Vector3::Transform3x3Array( Vector3* out, const Vector3* in, int count, const Matrix& mat )
+{
+	transformArray(out, in, count, mat, kNormal);
+}
+
+void Vector3::TransformSoA( float* outX, float* outY, float* outZ,
+	const float* x, const float* y, const float* z, int count, const Matrix& mat )
+{
+	transformSoA(outX, outY, outZ, x, y, z, count, mat, kPoint);
+}
+
+void Vector3::TransformCoordSoA( float* outX, float* outY, float* outZ,
+	const float* x, const float* y, const float* z, int count, const Matrix& mat )
+{
+	transformSoA(outX, outY, outZ, x, y, z, count, mat, kCoord);
+}
+
+void Vector3::Transform3x3SoA( float* outX, float* outY, float* outZ,
+	const float* x, const float* y, const float* z, int count, const Matrix& mat )
+{
+	transformSoA(outX, outY, outZ, x, y, z, count, mat, kNormal);
 }
 
 float Vector3::dot( const Vector3& v1, const Vector3& v2 )
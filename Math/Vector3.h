@@ -1,5 +1,6 @@
 #pragma once
 #include <math.h>
+#include "Expression.h"
 
 class Matrix;
 
@@ -12,9 +13,25 @@ public:
     float x, y, z;
 
 	//	RXgN^
-	Vector3(){ x=0; y=0; z=0; }
-	inline Vector3( float x, float y, float z ){ this->x=x, this->y=y, this->z=z; }
-	inline Vector3( const Vector3& v ){ this->x=v.x, this->y=v.y, this->z=v.z; }
+	constexpr Vector3() : x(0), y(0), z(0) {}
+	constexpr Vector3( float x, float y, float z ) : x(x), y(y), z(z) {}
+	constexpr Vector3( const Vector3& v ) : x(v.x), y(v.y), z(v.z) {}
+
+	//	Evaluate an element-wise expression (see Expression.h).
+	template<class E, class = typename std::enable_if<expr::IsNode<E>::value>::type>
+	constexpr Vector3( const E& e ) : x(e[0]), y(e[1]), z(e[2])
+	{
+		static_assert(E::Size == 3, "not a Vector3 expression");
+	}
+
+	template<class E, class = typename std::enable_if<expr::IsNode<E>::value>::type>
+	Vector3& operator = ( const E& e )
+	{
+		static_assert(E::Size == 3, "not a Vector3 expression");
+		float ex = e[0], ey = e[1], ez = e[2];
+		x = ex; y = ey; z = ez;
+		return *this;
+	}
     
 	//	vZ
 	inline float Length(){ return sqrtf(x*x + y*y + z*z); }
@@ -31,9 +48,25 @@ public:
 	void sub( Vector3 val ){ x-=val.x; y-=val.y; z-=val.z; }
 	void mul( float val ){ x*=val; y*=val; z*=val; }
 	
-	void Transform( Vector3& vec, Matrix& mat );
-	void TransformCoord( Vector3& vec, Matrix& mat );
-	void Transform3x3( Vector3& vec, Matrix& mat );
+	void Transform( const Vector3& vec, const Matrix& mat );
+	void TransformCoord( const Vector3& vec, const Matrix& mat );
+	void Transform3x3( const Vector3& vec, const Matrix& mat );
+
+	//	Batch transforms of count points by one matrix (out may equal in).
+	//	Array: packed Vector3[], SoA: separate x/y/z float arrays.
+	//	Coord variants perform the homogeneous divide by w.  Results match
+	//	the single-point functions bit for bit, except for the Coord
+	//	variants on ARMv7 NEON (see simd::div).
+	static void TransformArray( Vector3* out, const Vector3* in, int count, const Matrix& mat );
+	static void TransformCoordArray( Vector3* out, const Vector3* in, int count, const Matrix& mat );
+	static void Transform3x3Array( Vector3* out, const Vector3* in, int count, const Matrix& mat );
+
+	static void TransformSoA( float* outX, float* outY, float* outZ,
+		const float* x, const float* y, const float* z, int count, const Matrix& mat );
+	static void TransformCoordSoA( float* outX, float* outY, float* outZ,
+		const float* x, const float* y, const float* z, int count, const Matrix& mat );
+	static void Transform3x3SoA( float* outX, float* outY, float* outZ,
+		const float* x, const float* y, const float* z, int count, const Matrix& mat );
 	
 	static float dot( const Vector3& v1, const Vector3& v2 );
 	static Vector3 cross( Vector3& out, const Vector3& v1, const Vector3& v2 );
@@ -59,3 +92,14 @@ public:
     
 };
 
+namespace expr
+{
+	template<>
+	struct Leaf<Vector3>
+	{
+		static const bool value = true;
+		static const int Size = 3;
+		static constexpr float get( const Vector3& v, int i ){ return i == 0 ? v.x : (i == 1 ? v.y : v.z); }
+	};
+}
+
@@ -4,4 +4,5 @@
 #include "Vector3.h"
 #include "Matrix.h"
 #include "Quaternion.h"
+#include "DualQuaternion.h"
 